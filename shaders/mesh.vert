@@ -0,0 +1,52 @@
+#version 450
+
+layout(set = 0, binding = 0) uniform Frame {
+    vec2 extent;
+    float time;
+    float delta_time;
+} frame;
+
+struct Object {
+    vec4 tint;
+    vec4 position_scale;
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer Objects {
+    Object objects[];
+} objects;
+
+layout(push_constant) uniform Push_Constants {
+    vec2 offset;
+    float scale;
+    uint object;
+    uint texture_index;
+    uint sampler_index;
+} push_constants;
+
+/* These match `Mesh_Vertex`; the vertex formats normalize them. */
+layout(location = 0) in vec4 position;
+layout(location = 1) in vec2 normal;
+layout(location = 2) in vec2 uv;
+
+layout(location = 0) out vec3 frag_normal;
+layout(location = 1) out vec2 frag_uv;
+
+vec3 decode_octahedral(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+void main() {
+    float c = cos(frame.time);
+    float s = sin(frame.time);
+    /* This turns the mesh about its vertical axis. */
+    mat3 rotation = mat3(c, 0.0, -s, 0.0, 1.0, 0.0, s, 0.0, c);
+    vec3 p = rotation * (position.xyz * objects.objects[push_constants.object].position_scale.xyz) * push_constants.scale;
+    p.x *= frame.extent.y / frame.extent.x;
+    /* Meshes are Y-up and face +Z; clip space is Y-down, and nearer is lower depth. */
+    gl_Position = vec4(p.x + push_constants.offset.x, -p.y + push_constants.offset.y, 0.5 - 0.5 * p.z, 1.0);
+    frag_normal = rotation * decode_octahedral(normal);
+    frag_uv = uv;
+}
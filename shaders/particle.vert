@@ -0,0 +1,61 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+struct Particle {
+    vec4 position_life;
+    vec4 velocity_lifetime;
+};
+
+/* These match `Particle_System`, and are only read here; the blocks alias the `Bindless::STORAGE_BUFFERS` binding, and are indexed with handles from the push constants. */
+layout(std430, set = 0, binding = 2) readonly buffer Particles {
+    Particle particles[];
+} particle_buffers[];
+
+layout(std430, set = 0, binding = 2) readonly buffer Keys {
+    uvec2 keys[];
+} key_buffers[];
+
+layout(std430, set = 0, binding = 2) readonly buffer State {
+    uint simulate_groups[3];
+    uint sort_groups[3];
+    uint draw[4];
+    uint counts[2];
+    uint padded;
+} states[];
+
+layout(push_constant) uniform Push_Constants {
+    uint source_particles;
+    uint destination_particles;
+    uint keys;
+    uint state;
+    uint source_index;
+    uint capacity;
+    uint emit_count;
+    float delta_time;
+    float time;
+    float aspect;
+    uint sort_mode;
+    uint sort_k;
+    uint sort_j;
+} push_constants;
+
+layout(location = 0) out vec4 frag_color;
+layout(location = 1) out vec2 frag_corner;
+
+/* The half-size of a billboard, as a fraction of the view's height */
+const float SIZE = 0.006;
+
+void main() {
+    /* Instances are drawn in sorted order, and the key says which particle each one is. */
+    uint index = key_buffers[push_constants.keys].keys[gl_InstanceIndex].y;
+    Particle particle = particle_buffers[push_constants.destination_particles].particles[index];
+    /* The corners of a triangle strip */
+    vec2 corner = vec2(gl_VertexIndex & 1, gl_VertexIndex >> 1) * 2.0 - 1.0;
+    vec3 p = particle.position_life.xyz;
+    /* The same mapping as `mesh.vert`: Y-up, and nearer is lower depth */
+    gl_Position = vec4(p.x * push_constants.aspect + corner.x * SIZE * push_constants.aspect, -p.y + corner.y * SIZE, 0.5 - 0.5 * p.z, 1.0);
+    float age = 1.0 - particle.position_life.w / particle.velocity_lifetime.w;
+    /* Hot and bright when new, cooling to red, and fading out at the end */
+    frag_color = vec4(mix(vec3(1.0, 0.85, 0.4), vec3(0.9, 0.15, 0.05), age), 0.8 * (1.0 - age) * min(age * 20.0, 1.0));
+    frag_corner = corner;
+}
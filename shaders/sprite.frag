@@ -0,0 +1,20 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+/* These match `Bindless::Binding`; the sprite pipelines have the bindless set alone, as `set = 0`. */
+layout(set = 0, binding = 0) uniform texture2D textures[];
+layout(set = 0, binding = 1) uniform sampler samplers[];
+
+const uint INVALID = 0xFFFFFFFFu;
+
+layout(location = 0) in vec4 frag_color;
+layout(location = 1) in vec2 frag_uv;
+layout(location = 2) flat in uvec2 frag_texture_sampler;
+
+layout(location = 0) out vec4 out_color;
+
+void main() {
+    out_color = frag_color;
+    /* Sprites of one draw use different textures, so the index is not uniform. */
+    if (frag_texture_sampler.x != INVALID) out_color *= texture(sampler2D(textures[nonuniformEXT(frag_texture_sampler.x)], samplers[nonuniformEXT(frag_texture_sampler.y)]), frag_uv);
+}
@@ -0,0 +1,26 @@
+#version 450
+
+layout(push_constant) uniform Push_Constants {
+    vec2 extent;
+} push_constants;
+
+/* These match `Sprite_Batch::Instance`; every vertex of a quad reads the same instance. */
+layout(location = 0) in vec4 rect;
+layout(location = 1) in vec4 uv_rect;
+layout(location = 2) in vec4 color;
+layout(location = 3) in uvec2 texture_sampler;
+
+layout(location = 0) out vec4 frag_color;
+layout(location = 1) out vec2 frag_uv;
+layout(location = 2) flat out uvec2 frag_texture_sampler;
+
+void main() {
+    /* The corners of a triangle strip: top left, top right, bottom left, bottom right */
+    vec2 corner = vec2(gl_VertexIndex & 1, gl_VertexIndex >> 1);
+    vec2 position = rect.xy + corner * rect.zw;
+    /* Pixels from the top left, to clip space, whose y points down in Vulkan */
+    gl_Position = vec4(position / push_constants.extent * 2.0 - 1.0, 0.0, 1.0);
+    frag_color = color;
+    frag_uv = mix(uv_rect.xy, uv_rect.zw, corner);
+    frag_texture_sampler = texture_sampler;
+}
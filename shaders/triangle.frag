@@ -1,9 +1,39 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(push_constant) uniform Push_Constants {
+    vec2 offset;
+    float scale;
+    uint object;
+    uint texture_index;
+    uint sampler_index;
+} push_constants;
+
+struct Object {
+    vec4 tint;
+    vec4 position_scale;
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer Objects {
+    Object objects[];
+} objects;
+
+/* These match `Bindless::Binding`. */
+layout(set = 1, binding = 0) uniform texture2D textures[];
+layout(set = 1, binding = 1) uniform sampler samplers[];
+
+const uint INVALID = 0xFFFFFFFFu;
+
+/* Variants that draw without a texture turn this off, so that they never read one; with it on, the handle is checked as it draws. */
+layout(constant_id = 0) const bool TEXTURED = true;
 
 layout(location = 0) in vec3 frag_color;
+layout(location = 1) in vec2 frag_uv;
 
 layout(location = 0) out vec4 out_color;
 
 void main() {
-    out_color = vec4(frag_color, 1.0);
+    out_color = vec4(frag_color, 1.0) * objects.objects[push_constants.object].tint;
+    /* The arrays are partially bound, so only elements that have been written may be read. */
+    if (TEXTURED && push_constants.texture_index != INVALID && push_constants.sampler_index != INVALID) out_color *= texture(sampler2D(textures[nonuniformEXT(push_constants.texture_index)], samplers[nonuniformEXT(push_constants.sampler_index)]), frag_uv);
 }
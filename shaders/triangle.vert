@@ -1,6 +1,21 @@
 #version 450
 
+layout(set = 0, binding = 0) uniform Frame {
+    vec2 extent;
+    float time;
+    float delta_time;
+} frame;
+
+layout(push_constant) uniform Push_Constants {
+    vec2 offset;
+    float scale;
+    uint object;
+    uint texture_index;
+    uint sampler_index;
+} push_constants;
+
 layout(location = 0) out vec3 frag_color;
+layout(location = 1) out vec2 frag_uv;
 
 vec2 positions[3] = vec2[](
         vec2(0.0, -0.5),
@@ -15,6 +30,12 @@ vec3 colors[3] = vec3[](
     );
 
 void main() {
-    gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
+    float c = cos(frame.time);
+    float s = sin(frame.time);
+    vec2 position = mat2(c, s, -s, c) * positions[gl_VertexIndex] * push_constants.scale;
+    /* Keep the triangle's proportions independent of the window's. */
+    position.x *= frame.extent.y / frame.extent.x;
+    gl_Position = vec4(position + push_constants.offset, 0.0, 1.0);
     frag_color = colors[gl_VertexIndex];
+    frag_uv = positions[gl_VertexIndex] + 0.5;
 }
@@ -0,0 +1,150 @@
+#include "arena.hpp"
+
+#ifdef COUNT_ALLOCATIONS
+/*
+    - `std::aligned_alloc` [[.](https://en.cppreference.com/w/cpp/memory/c/aligned_alloc.html)]
+    - `std::free` [[.](https://en.cppreference.com/w/cpp/memory/c/free.html)]
+    - `std::malloc` [[.](https://en.cppreference.com/w/cpp/memory/c/malloc.html)]
+*/
+#include <cstdlib>
+/*
+    - `std::bad_alloc` [[.](https://en.cppreference.com/w/cpp/memory/new/bad_alloc.html)]
+    - `std::align_val_t` [[.](https://en.cppreference.com/w/cpp/memory/new/align_val_t.html)]
+*/
+#include <new>
+
+#ifdef _MSC_VER
+/*
+    - `_aligned_malloc` [[.](https://learn.microsoft.com/en-us/cpp/c-runtime-library/reference/aligned-malloc)]
+    - `_aligned_free` [[.](https://learn.microsoft.com/en-us/cpp/c-runtime-library/reference/aligned-free)]
+*/
+#include <malloc.h>
+#endif
+
+namespace
+{
+    std::atomic<uint64_t> heap_allocation_count{0};
+
+    /* MSVC's C runtime has no `std::aligned_alloc`, and what `_aligned_malloc` returns is freed with `_aligned_free`. */
+    void *aligned_allocate(size_t size, size_t alignment)
+    {
+#ifdef _MSC_VER
+        return _aligned_malloc(std::max(size, size_t{1}), alignment);
+#else
+        /* `std::aligned_alloc` takes sizes in multiples of the alignment. */
+        return std::aligned_alloc(alignment, (std::max(size, size_t{1}) + alignment - 1) / alignment * alignment);
+#endif
+    }
+
+    void aligned_free(void *p)
+    {
+#ifdef _MSC_VER
+        _aligned_free(p);
+#else
+        std::free(p);
+#endif
+    }
+}
+
+uint64_t heap_allocations()
+{
+    return heap_allocation_count.load(std::memory_order_relaxed);
+}
+
+/* The array and `std::nothrow` forms call these, so they are counted too. */
+void *operator new(size_t size)
+{
+    heap_allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void *p{std::malloc(size == 0 ? 1 : size)}) return p;
+    throw std::bad_alloc{};
+}
+
+void *operator new(size_t size, std::align_val_t alignment)
+{
+    heap_allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void *p{aligned_allocate(size, static_cast<size_t>(alignment))}) return p;
+    throw std::bad_alloc{};
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept
+{
+    aligned_free(p);
+}
+
+void operator delete(void *p, size_t, std::align_val_t) noexcept
+{
+    aligned_free(p);
+}
+#else
+uint64_t heap_allocations()
+{
+    return 0;
+}
+#endif
+
+void Arena::reset()
+{
+    peak_used = peak();
+
+    /* One block of the total size serves the next frame without growing. */
+    if (blocks.size() > 1)
+    {
+        size_t total{0};
+        for (const auto &block : blocks) total += block.size;
+        blocks.clear();
+        add_block(total);
+    }
+
+    head = 0;
+    full = 0;
+}
+
+void *Arena::do_allocate(size_t size, size_t alignment)
+{
+    auto aligned_offset{[&]() {
+        uintptr_t begin{reinterpret_cast<uintptr_t>(blocks.back().p_data.get())};
+        return ((begin + head + alignment - 1) & ~(uintptr_t{alignment} - 1)) - begin;
+    }};
+
+    if (blocks.empty() || aligned_offset() + size > blocks.back().size)
+    {
+        full += blocks.empty() ? 0 : head;
+        add_block(std::max(blocks.empty() ? initial_size : blocks.back().size * 2, size + alignment));
+    }
+
+    size_t offset{aligned_offset()};
+    head = offset + size;
+    return blocks.back().p_data.get() + offset;
+}
+
+void Arena::add_block(size_t size)
+{
+    blocks.push_back({std::unique_ptr<std::byte[]>(new std::byte[size]), size});
+    head = 0;
+}
+
+Arena &Frame_Arena::get()
+{
+    thread_local Arena arenas[FRAME_COUNT];
+    thread_local uint64_t arena_frames[FRAME_COUNT]{};
+    uint64_t frame{current_frame.load(std::memory_order_relaxed)};
+    uint32_t index{static_cast<uint32_t>(frame % FRAME_COUNT)};
+
+    if (arena_frames[index] != frame)
+    {
+        arenas[index].reset();
+        arena_frames[index] = frame;
+    }
+
+    return arenas[index];
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+/*
+    - `std::max` [[.](https://en.cppreference.com/w/cpp/algorithm/max.html)]
+*/
+#include <algorithm>
+/*
+    - `std::atomic` [[.](https://en.cppreference.com/w/cpp/atomic/atomic.html)]
+*/
+#include <atomic>
+/*
+    - `uint64_t` [[.](https://en.cppreference.com/w/cpp/types/integer.html)]
+*/
+#include <cstdint>
+/*
+    - `std::unique_ptr` [[.](https://en.cppreference.com/w/cpp/memory/unique_ptr.html)]
+*/
+#include <memory>
+/*
+    - `std::pmr::memory_resource` [[.](https://en.cppreference.com/w/cpp/memory/memory_resource.html)]
+*/
+#include <memory_resource>
+/*
+    - `std::vector` [[.](https://en.cppreference.com/w/cpp/container/vector.html)]
+*/
+#include <vector>
+
+/*
+    A bump allocator for scratch memory that is all freed at once. Deallocation does nothing, and `reset` makes the whole arena free again without returning its memory, so an arena that has grown to what a frame needs allocates nothing from then on. When an allocation does not fit, a larger block is added, and the blocks are merged into one on the next reset.
+
+    Containers use it through `std::pmr::polymorphic_allocator`. Destructors of what is allocated here are never run by the arena, so it only holds what owns no other memory, or what is destroyed before the reset.
+*/
+class Arena : public std::pmr::memory_resource
+{
+    public:
+    explicit Arena(size_t initial_size = 64 * 1024) : initial_size{initial_size} {}
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    void reset();
+    /* Bytes allocated since the last reset, and the most of those since the arena was made */
+    size_t used() const { return full + head; }
+    size_t peak() const { return std::max(peak_used, used()); }
+
+    private:
+    struct Block
+    {
+        std::unique_ptr<std::byte[]> p_data;
+        size_t size;
+    };
+
+    void *do_allocate(size_t size, size_t alignment) override;
+    void do_deallocate(void *, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+    void add_block(size_t size);
+
+    size_t initial_size;
+    std::vector<Block> blocks;
+    /* The offset into the last block, and the bytes used of the blocks before it */
+    size_t head{0};
+    size_t full{0};
+    size_t peak_used{0};
+};
+
+/*
+    Each thread's scratch memory for the current frame, in one arena per frame in flight. A thread's arena is reset by that thread when it first asks for it in a new frame, so worker threads never share or reset one another's arenas, and nothing is locked.
+
+    Memory from `get` stays valid until the same thread asks again `FRAME_COUNT` frames later, so a job may keep it across one frame boundary but no further.
+*/
+class Frame_Arena
+{
+    public:
+    static constexpr uint32_t FRAME_COUNT{2};
+
+    /* This is called on the main thread before anything of the frame is allocated. */
+    static void begin_frame(uint64_t frame) { current_frame.store(frame, std::memory_order_relaxed); }
+    static Arena &get();
+    static std::pmr::memory_resource *resource() { return &get(); }
+
+    private:
+    static inline std::atomic<uint64_t> current_frame{0};
+};
+
+/* With the `COUNT_ALLOCATIONS` build option, every global `operator new` is counted, so a loop can be checked for heap allocations. Otherwise the global operators are the standard library's, and this is always `0`. */
+#ifdef COUNT_ALLOCATIONS
+inline constexpr bool HEAP_ALLOCATIONS_COUNTED{true};
+#else
+inline constexpr bool HEAP_ALLOCATIONS_COUNTED{false};
+#endif
+uint64_t heap_allocations();
@@ -0,0 +1,242 @@
+#include "atlas.hpp"
+
+/*
+    - `std::max` [[.](https://en.cppreference.com/w/cpp/algorithm/max.html)]
+    - `std::min` [[.](https://en.cppreference.com/w/cpp/algorithm/min.html)]
+*/
+#include <algorithm>
+/*
+    - `std::memcpy` [[.](https://en.cppreference.com/w/cpp/string/byte/memcpy.html)]
+*/
+#include <cstring>
+/*
+    - `std::runtime_error` [[.](https://en.cppreference.com/w/cpp/error/runtime_error.html)]
+*/
+#include <stdexcept>
+
+#include "buffer.hpp"
+
+void Atlas_Packer::create(uint32_t width, uint32_t height)
+{
+    this->width = width;
+    this->height = height;
+    used = 0;
+    skyline = {{0, 0, width}};
+}
+
+std::optional<uint32_t> Atlas_Packer::fit(size_t index, uint32_t width, uint32_t height) const
+{
+    if (skyline[index].x + width > this->width) return {};
+    uint32_t top{0};
+    uint32_t remaining{width};
+
+    /* The rectangle rests on the highest segment under it. */
+    for (size_t i{index}; remaining > 0; i++)
+    {
+        top = std::max(top, skyline[i].y);
+        if (top + height > this->height) return {};
+        remaining -= std::min(remaining, skyline[i].width);
+    }
+
+    return top;
+}
+
+std::optional<Atlas_Packer::Rect> Atlas_Packer::pack(uint32_t width, uint32_t height)
+{
+    size_t best_index{skyline.size()};
+    uint32_t best_bottom{~0u};
+    uint32_t best_width{~0u};
+    uint32_t best_top{0};
+
+    for (size_t i{0}; i < skyline.size(); i++)
+    {
+        std::optional<uint32_t> top{fit(i, width, height)};
+        if (!top) continue;
+        uint32_t bottom{*top + height};
+
+        if (bottom < best_bottom || (bottom == best_bottom && skyline[i].width < best_width))
+        {
+            best_index = i;
+            best_bottom = bottom;
+            best_width = skyline[i].width;
+            best_top = *top;
+        }
+    }
+
+    if (best_index == skyline.size()) return {};
+    Rect rect{skyline[best_index].x, best_top, width, height};
+    skyline.insert(skyline.begin() + static_cast<ptrdiff_t>(best_index), {rect.x, best_bottom, width});
+
+    /* The segments that the rectangle now covers are shortened or removed. */
+    for (size_t i{best_index + 1}; i < skyline.size();)
+    {
+        Segment &segment{skyline[i]};
+        uint32_t end{rect.x + width};
+        if (segment.x >= end) break;
+        uint32_t overlap{std::min(end - segment.x, segment.width)};
+        segment.x += overlap;
+        segment.width -= overlap;
+
+        if (segment.width > 0) break;
+        skyline.erase(skyline.begin() + static_cast<ptrdiff_t>(i));
+    }
+
+    /* Neighbours at the same height become one segment. */
+    for (size_t i{1}; i < skyline.size();)
+    {
+        if (skyline[i - 1].y != skyline[i].y)
+        {
+            i++;
+            continue;
+        }
+
+        skyline[i - 1].width += skyline[i].width;
+        skyline.erase(skyline.begin() + static_cast<ptrdiff_t>(i));
+    }
+
+    used += uint64_t{width} * height;
+    return rect;
+}
+
+void Atlas::create(VkPhysicalDevice physical_device, VkDevice device, Bindless *p_bindless, uint32_t size, VkDeviceSize staging_size, uint32_t frame_count)
+{
+    this->device = device;
+    this->p_bindless = p_bindless;
+    this->size = size;
+    cleared = false;
+    packer.create(size, size);
+    staging.create(physical_device, device, staging_size, frame_count, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 0);
+
+    VkImageCreateInfo create_info{
+        .sType{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO},
+        // .pNext{},
+        // .flags{},
+        .imageType{VK_IMAGE_TYPE_2D},
+        .format{VK_FORMAT_R8G8B8A8_UNORM},
+        .extent{size, size, 1},
+        .mipLevels{1},
+        .arrayLayers{1},
+        .samples{VK_SAMPLE_COUNT_1_BIT},
+        .tiling{VK_IMAGE_TILING_OPTIMAL},
+        .usage{VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT},
+        .sharingMode{VK_SHARING_MODE_EXCLUSIVE},
+        // .queueFamilyIndexCount{},
+        // .pQueueFamilyIndices{},
+        .initialLayout{VK_IMAGE_LAYOUT_UNDEFINED},
+    };
+
+    CHECK(vkCreateImage(device, &create_info, nullptr, &image));
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(device, image, &requirements);
+
+    VkMemoryAllocateInfo allocate_info{
+        .sType{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO},
+        // .pNext{},
+        .allocationSize{requirements.size},
+        .memoryTypeIndex{find_memory_type(physical_device, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)},
+    };
+
+    CHECK(vkAllocateMemory(device, &allocate_info, nullptr, &memory));
+    CHECK(vkBindImageMemory(device, image, memory, 0));
+
+    VkImageViewCreateInfo view_create_info{
+        .sType{VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO},
+        // .pNext{},
+        // .flags{},
+        .image{image},
+        .viewType{VK_IMAGE_VIEW_TYPE_2D},
+        .format{VK_FORMAT_R8G8B8A8_UNORM},
+        .components{
+            .r{VK_COMPONENT_SWIZZLE_IDENTITY},
+            .g{VK_COMPONENT_SWIZZLE_IDENTITY},
+            .b{VK_COMPONENT_SWIZZLE_IDENTITY},
+            .a{VK_COMPONENT_SWIZZLE_IDENTITY},
+        },
+        .subresourceRange{VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1},
+    };
+
+    CHECK(vkCreateImageView(device, &view_create_info, nullptr, &view));
+    image_handle = p_bindless->add_image(device, view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+}
+
+void Atlas::destroy()
+{
+    p_bindless->remove_image(image_handle);
+    vkDestroyImageView(device, view, nullptr);
+    vkDestroyImage(device, image, nullptr);
+    vkFreeMemory(device, memory, nullptr);
+    staging.destroy(device);
+    uploads.clear();
+}
+
+std::optional<Atlas::Region> Atlas::add(uint32_t width, uint32_t height, const uint8_t *p_texels)
+{
+    size_t bytes{static_cast<size_t>(width) * height * 4};
+    if (!staging.fits(bytes)) throw std::runtime_error("The image is larger than the atlas's staging ring.\n");
+    std::optional<Atlas_Packer::Rect> padded{packer.pack(width + 2, height + 2)};
+    if (!padded) return {};
+    Atlas_Packer::Rect rect{padded->x + 1, padded->y + 1, width, height};
+    uploads.push_back({rect, std::vector<uint8_t>(p_texels, p_texels + bytes)});
+    float texel{1.0f / static_cast<float>(size)};
+    return Region{{static_cast<float>(rect.x) * texel, static_cast<float>(rect.y) * texel, static_cast<float>(rect.x + width) * texel, static_cast<float>(rect.y + height) * texel}};
+}
+
+/* Uploads keep the order in which images were added. Regions that are not written yet read as transparent, since the image is cleared first and the borders are never written. */
+void Atlas::update(VkCommandBuffer command_buffer, uint32_t frame)
+{
+    staging.begin_frame(frame);
+    if (cleared && uploads.empty()) return;
+
+    VkImageMemoryBarrier barrier{
+        .sType{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER},
+        // .pNext{},
+        /* Earlier frames only read the atlas, so this is just an execution dependency. */
+        .srcAccessMask{0},
+        .dstAccessMask{VK_ACCESS_TRANSFER_WRITE_BIT},
+        .oldLayout{cleared ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED},
+        .newLayout{VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL},
+        .srcQueueFamilyIndex{VK_QUEUE_FAMILY_IGNORED},
+        .dstQueueFamilyIndex{VK_QUEUE_FAMILY_IGNORED},
+        .image{image},
+        .subresourceRange{VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1},
+    };
+
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    if (!cleared)
+    {
+        VkClearColorValue transparent{};
+        VkImageSubresourceRange range{VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        vkCmdClearColorImage(command_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &transparent, 1, &range);
+        cleared = true;
+        VkMemoryBarrier clear_barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_WRITE_BIT};
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &clear_barrier, 0, nullptr, 0, nullptr);
+    }
+
+    /* Packed regions never overlap, so the copies need no barriers between them. */
+    while (!uploads.empty() && staging.fits(uploads.front().texels.size()))
+    {
+        const Upload &upload{uploads.front()};
+        Frame_Ring::Allocation allocation{staging.allocate(upload.texels.size())};
+        std::memcpy(allocation.p_data, upload.texels.data(), upload.texels.size());
+
+        VkBufferImageCopy copy{
+            .bufferOffset{allocation.offset},
+            /* Tightly packed */
+            .bufferRowLength{0},
+            .bufferImageHeight{0},
+            .imageSubresource{VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+            .imageOffset{static_cast<int32_t>(upload.rect.x), static_cast<int32_t>(upload.rect.y), 0},
+            .imageExtent{upload.rect.width, upload.rect.height, 1},
+        };
+
+        vkCmdCopyBufferToImage(command_buffer, staging.buffer(), image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy);
+        uploads.pop_front();
+    }
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+/*
+    - `std::deque` [[.](https://en.cppreference.com/w/cpp/container/deque.html)]
+*/
+#include <deque>
+/*
+    - `std::optional` [[.](https://en.cppreference.com/w/cpp/utility/optional.html)]
+*/
+#include <optional>
+/*
+    - `std::vector` [[.](https://en.cppreference.com/w/cpp/container/vector.html)]
+*/
+#include <vector>
+
+#include "bindless.hpp"
+#include "common.hpp"
+#include "frame_ring.hpp"
+
+/*
+    Rectangles placed into a fixed area by the skyline bottom-left rule: the area's filled part is kept as its top outline, a list of horizontal segments, and each rectangle goes where its bottom edge would be lowest, on the narrowest such segment. Space under an overhang is given up, which keeps packing linear in the number of segments.
+*/
+class Atlas_Packer
+{
+    public:
+    struct Rect
+    {
+        uint32_t x;
+        uint32_t y;
+        uint32_t width;
+        uint32_t height;
+    };
+
+    void create(uint32_t width, uint32_t height);
+    /* This returns nothing once the rectangle does not fit anywhere. */
+    std::optional<Rect> pack(uint32_t width, uint32_t height);
+    /* The fraction of the area covered by rectangles */
+    float occupancy() const { return static_cast<float>(static_cast<double>(used) / (static_cast<double>(width) * height)); }
+
+    private:
+    struct Segment
+    {
+        uint32_t x;
+        uint32_t y;
+        uint32_t width;
+    };
+
+    /* The top of a rectangle placed at segment `index`, or nothing if it would leave the area */
+    std::optional<uint32_t> fit(size_t index, uint32_t width, uint32_t height) const;
+
+    uint32_t width{0};
+    uint32_t height{0};
+    uint64_t used{0};
+    std::vector<Segment> skyline;
+};
+
+/*
+    One RGBA8 image of many small ones, which is sampled through a single bindless handle with each image's region of it. Images are packed when they are added and copied to the GPU by `update`, as many per frame as fit in the staging ring; the rest wait for later frames, so a region may show as transparent at first.
+
+    Each image has a transparent border of one texel, so that filtering at its edges does not reach into its neighbours.
+*/
+class Atlas
+{
+    public:
+    struct Region
+    {
+        /* `u0`, `v0`, `u1` and `v1`, as for a `Sprite_Batch::Sprite` */
+        float uv[4];
+    };
+
+    void create(VkPhysicalDevice, VkDevice, Bindless *, uint32_t size, VkDeviceSize staging_size, uint32_t frame_count);
+    void destroy();
+    /* `p_texels` is tightly packed RGBA8, and is copied. This returns nothing when the atlas is full. */
+    std::optional<Region> add(uint32_t width, uint32_t height, const uint8_t *p_texels);
+    /* This must be recorded outside of a render pass, before any draw that samples the atlas. */
+    void update(VkCommandBuffer, uint32_t frame);
+    uint32_t handle() const { return image_handle; }
+    float occupancy() const { return packer.occupancy(); }
+
+    private:
+    struct Upload
+    {
+        Atlas_Packer::Rect rect;
+        std::vector<uint8_t> texels;
+    };
+
+    VkDevice device{VK_NULL_HANDLE};
+    Bindless *p_bindless{nullptr};
+    uint32_t size{0};
+    VkImage image{VK_NULL_HANDLE};
+    VkDeviceMemory memory{VK_NULL_HANDLE};
+    VkImageView view{VK_NULL_HANDLE};
+    uint32_t image_handle{Bindless::INVALID};
+    /* The image is cleared before its first upload, since its layout starts undefined. */
+    bool cleared{false};
+    Atlas_Packer packer;
+    Frame_Ring staging;
+    std::deque<Upload> uploads;
+};
@@ -0,0 +1,240 @@
+#include "bindless.hpp"
+
+/*
+    - `std::max` [[.](https://en.cppreference.com/w/cpp/algorithm/max.html)]
+    - `std::min` [[.](https://en.cppreference.com/w/cpp/algorithm/min.html)]
+*/
+#include <algorithm>
+/*
+    - `std::runtime_error` [[.](https://en.cppreference.com/w/cpp/error/runtime_error.html)]
+*/
+#include <stdexcept>
+/*
+    - `std::string` [[.](https://en.cppreference.com/w/cpp/string/basic_string.html)]
+*/
+#include <string>
+
+void Bindless::create(VkPhysicalDevice physical_device, VkDevice device)
+{
+    VkPhysicalDeviceDescriptorIndexingProperties indexing_properties{
+        .sType{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES},
+    };
+
+    VkPhysicalDeviceProperties2 properties{
+        .sType{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2},
+        .pNext{&indexing_properties},
+    };
+
+    vkGetPhysicalDeviceProperties2(physical_device, &properties);
+    /* These are generous; they are clamped to what the device allows for update-after-bind descriptors. */
+    uint32_t counts[]{
+        std::min({16384u, indexing_properties.maxDescriptorSetUpdateAfterBindSampledImages, indexing_properties.maxPerStageDescriptorUpdateAfterBindSampledImages}),
+        std::min({64u, indexing_properties.maxDescriptorSetUpdateAfterBindSamplers, indexing_properties.maxPerStageDescriptorUpdateAfterBindSamplers}),
+        std::min({16384u, indexing_properties.maxDescriptorSetUpdateAfterBindStorageBuffers, indexing_properties.maxPerStageDescriptorUpdateAfterBindStorageBuffers}),
+    };
+
+    /* Every stage sees every binding, and the total that one stage sees is limited too, so the counts are scaled down together to fit, with room for the per-frame set and the color attachments. */
+    uint64_t total{uint64_t{counts[0]} + counts[1] + counts[2]};
+    uint32_t per_stage{indexing_properties.maxPerStageUpdateAfterBindResources};
+    uint32_t budget{per_stage > RESERVED_RESOURCES ? per_stage - RESERVED_RESOURCES : 0};
+
+    if (total > budget)
+        for (uint32_t &count : counts) count = std::max(1u, static_cast<uint32_t>(count * uint64_t{budget} / total));
+
+    images.reset(counts[0]);
+    samplers.reset(counts[1]);
+    buffers.reset(counts[2]);
+
+    VkDescriptorSetLayoutBinding bindings[]{
+        {
+            .binding{SAMPLED_IMAGES},
+            .descriptorType{VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE},
+            .descriptorCount{images.capacity()},
+            .stageFlags{VK_SHADER_STAGE_ALL},
+            /* This is optional. */ .pImmutableSamplers{nullptr},
+        },
+        {
+            .binding{SAMPLERS},
+            .descriptorType{VK_DESCRIPTOR_TYPE_SAMPLER},
+            .descriptorCount{samplers.capacity()},
+            .stageFlags{VK_SHADER_STAGE_ALL},
+            /* This is optional. */ .pImmutableSamplers{nullptr},
+        },
+        {
+            .binding{STORAGE_BUFFERS},
+            .descriptorType{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER},
+            .descriptorCount{buffers.capacity()},
+            .stageFlags{VK_SHADER_STAGE_ALL},
+            /* This is optional. */ .pImmutableSamplers{nullptr},
+        },
+    };
+
+    /* Unused array elements may be left unwritten, and elements that no pending command buffer uses may be rewritten while the set is bound. */
+    VkDescriptorBindingFlags flag{VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT};
+    VkDescriptorBindingFlags binding_flags[]{flag, flag, flag};
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo binding_flags_create_info{
+        .sType{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO},
+        // .pNext{},
+        .bindingCount{3},
+        .pBindingFlags{binding_flags},
+    };
+
+    VkDescriptorSetLayoutCreateInfo layout_create_info{
+        .sType{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO},
+        .pNext{&binding_flags_create_info},
+        .flags{VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT},
+        .bindingCount{3},
+        .pBindings{bindings},
+    };
+
+    CHECK(vkCreateDescriptorSetLayout(device, &layout_create_info, nullptr, &set_layout));
+
+    VkDescriptorPoolSize pool_sizes[]{
+        {
+            .type{VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE},
+            .descriptorCount{images.capacity()},
+        },
+        {
+            .type{VK_DESCRIPTOR_TYPE_SAMPLER},
+            .descriptorCount{samplers.capacity()},
+        },
+        {
+            .type{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER},
+            .descriptorCount{buffers.capacity()},
+        },
+    };
+
+    VkDescriptorPoolCreateInfo pool_create_info{
+        .sType{VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO},
+        // .pNext{},
+        .flags{VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT},
+        .maxSets{1},
+        .poolSizeCount{3},
+        .pPoolSizes{pool_sizes},
+    };
+
+    CHECK(vkCreateDescriptorPool(device, &pool_create_info, nullptr, &pool));
+
+    VkDescriptorSetAllocateInfo allocate_info{
+        .sType{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO},
+        // .pNext{},
+        .descriptorPool{pool},
+        .descriptorSetCount{1},
+        .pSetLayouts{&set_layout},
+    };
+
+    CHECK(vkAllocateDescriptorSets(device, &allocate_info, &descriptor_set));
+}
+
+void Bindless::destroy(VkDevice device)
+{
+    /* The set is freed with its pool. */
+    vkDestroyDescriptorPool(device, pool, nullptr);
+    vkDestroyDescriptorSetLayout(device, set_layout, nullptr);
+}
+
+void Bindless::begin_frame(uint32_t frame)
+{
+    current_frame = frame % MAX_FRAMES;
+    images.begin_frame(current_frame);
+    samplers.begin_frame(current_frame);
+    buffers.begin_frame(current_frame);
+}
+
+uint32_t Bindless::add_image(VkDevice device, VkImageView image_view, VkImageLayout layout)
+{
+    uint32_t handle{images.allocate()};
+
+    VkDescriptorImageInfo info{
+        // .sampler{},
+        .imageView{image_view},
+        .imageLayout{layout},
+    };
+
+    write(device, SAMPLED_IMAGES, handle, &info, nullptr);
+    return handle;
+}
+
+uint32_t Bindless::add_sampler(VkDevice device, VkSampler sampler)
+{
+    uint32_t handle{samplers.allocate()};
+    VkDescriptorImageInfo info{.sampler{sampler}};
+    write(device, SAMPLERS, handle, &info, nullptr);
+    return handle;
+}
+
+uint32_t Bindless::add_buffer(VkDevice device, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+    uint32_t handle{buffers.allocate()};
+    VkDescriptorBufferInfo info{buffer, offset, range};
+    write(device, STORAGE_BUFFERS, handle, nullptr, &info);
+    return handle;
+}
+
+void Bindless::remove_image(uint32_t handle)
+{
+    images.free(handle, current_frame);
+}
+
+void Bindless::remove_sampler(uint32_t handle)
+{
+    samplers.free(handle, current_frame);
+}
+
+void Bindless::remove_buffer(uint32_t handle)
+{
+    buffers.free(handle, current_frame);
+}
+
+void Bindless::write(VkDevice device, Binding binding, uint32_t handle, const VkDescriptorImageInfo *p_image_info, const VkDescriptorBufferInfo *p_buffer_info)
+{
+    VkDescriptorType types[]{VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, VK_DESCRIPTOR_TYPE_SAMPLER, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER};
+
+    VkWriteDescriptorSet write{
+        .sType{VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET},
+        // .pNext{},
+        .dstSet{descriptor_set},
+        .dstBinding{binding},
+        .dstArrayElement{handle},
+        .descriptorCount{1},
+        .descriptorType{types[binding]},
+        .pImageInfo{p_image_info},
+        .pBufferInfo{p_buffer_info},
+        // .pTexelBufferView{},
+    };
+
+    vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+}
+
+void Bindless::Handle_Allocator::reset(uint32_t capacity)
+{
+    limit = capacity;
+    next = 0;
+    free_list.clear();
+    for (auto &list : retired) list.clear();
+}
+
+uint32_t Bindless::Handle_Allocator::allocate()
+{
+    if (!free_list.empty())
+    {
+        uint32_t handle{free_list.back()};
+        free_list.pop_back();
+        return handle;
+    }
+
+    if (next == limit) throw std::runtime_error("The bindless descriptor array is full (" + std::to_string(limit) + " elements).\n");
+    return next++;
+}
+
+void Bindless::Handle_Allocator::free(uint32_t handle, uint32_t frame)
+{
+    if (handle != INVALID) retired[frame].push_back(handle);
+}
+
+void Bindless::Handle_Allocator::begin_frame(uint32_t frame)
+{
+    free_list.insert(free_list.end(), retired[frame].begin(), retired[frame].end());
+    retired[frame].clear();
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+/*
+    - `std::vector` [[.](https://en.cppreference.com/w/cpp/container/vector.html)]
+*/
+#include <vector>
+
+#include "common.hpp"
+
+/*
+    A single global descriptor set of large, partially bound, update-after-bind arrays. Resources are referred to by the integer handle returned when they are added, and shaders index the arrays with that handle, so changing which resources a draw uses never changes which descriptor sets are bound.
+
+    A handle's descriptor is written once, when it is added. To replace a resource, add the new one and remove the old one, since a descriptor must not change while a pending command buffer may use it.
+
+    The binding numbers and `GL_EXT_nonuniform_qualifier` declarations in the shaders must match `Binding`.
+*/
+class Bindless
+{
+    public:
+    static constexpr uint32_t INVALID{~0u};
+
+    enum Binding : uint32_t
+    {
+        SAMPLED_IMAGES = 0,
+        SAMPLERS = 1,
+        STORAGE_BUFFERS = 2,
+    };
+
+    void create(VkPhysicalDevice, VkDevice);
+    void destroy(VkDevice);
+    /* Handles freed during a frame are only reused once that frame slot comes around again, after its fence has been waited on. */
+    void begin_frame(uint32_t frame);
+
+    uint32_t add_image(VkDevice, VkImageView, VkImageLayout);
+    uint32_t add_sampler(VkDevice, VkSampler);
+    uint32_t add_buffer(VkDevice, VkBuffer, VkDeviceSize offset, VkDeviceSize range);
+    void remove_image(uint32_t);
+    void remove_sampler(uint32_t);
+    void remove_buffer(uint32_t);
+
+    VkDescriptorSetLayout layout() const { return set_layout; }
+    VkDescriptorSet set() const { return descriptor_set; }
+
+    private:
+    static constexpr uint32_t MAX_FRAMES{4};
+    /* Resources that a stage sees besides this set's, out of `maxPerStageUpdateAfterBindResources` */
+    static constexpr uint32_t RESERVED_RESOURCES{16};
+
+    class Handle_Allocator
+    {
+        public:
+        void reset(uint32_t capacity);
+        uint32_t allocate();
+        void free(uint32_t handle, uint32_t frame);
+        void begin_frame(uint32_t frame);
+        uint32_t capacity() const { return limit; }
+
+        private:
+        uint32_t limit{0};
+        uint32_t next{0};
+        std::vector<uint32_t> free_list;
+        std::vector<uint32_t> retired[MAX_FRAMES];
+    };
+
+    void write(VkDevice, Binding, uint32_t, const VkDescriptorImageInfo *, const VkDescriptorBufferInfo *);
+
+    VkDescriptorSetLayout set_layout;
+    VkDescriptorPool pool;
+    VkDescriptorSet descriptor_set;
+    Handle_Allocator images;
+    Handle_Allocator samplers;
+    Handle_Allocator buffers;
+    uint32_t current_frame{0};
+};
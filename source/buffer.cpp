@@ -0,0 +1,55 @@
+#include "buffer.hpp"
+
+uint32_t find_memory_type(VkPhysicalDevice physical_device, uint32_t type_filter, VkMemoryPropertyFlags properties)
+{
+    VkPhysicalDeviceMemoryProperties memory_properties;
+    vkGetPhysicalDeviceMemoryProperties(physical_device, &memory_properties);
+
+    for (uint32_t i{0}; i < memory_properties.memoryTypeCount; i++)
+    {
+        if ((type_filter & (1 << i)) && (memory_properties.memoryTypes[i].propertyFlags & properties) == properties) return i;
+    }
+
+    throw std::runtime_error("A suitable memory type could not be found.\n");
+}
+
+Buffer create_buffer(VkPhysicalDevice physical_device, VkDevice device, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties)
+{
+    Buffer buffer{.size{size}};
+
+    VkBufferCreateInfo create_info{
+        .sType{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO},
+        // .pNext{},
+        // .flags{},
+        .size{size},
+        .usage{usage},
+        .sharingMode{VK_SHARING_MODE_EXCLUSIVE},
+        // .queueFamilyIndexCount{},
+        // .pQueueFamilyIndices{},
+    };
+
+    CHECK(vkCreateBuffer(device, &create_info, nullptr, &buffer.buffer));
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(device, buffer.buffer, &requirements);
+
+    VkMemoryAllocateInfo allocate_info{
+        .sType{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO},
+        // .pNext{},
+        .allocationSize{requirements.size},
+        .memoryTypeIndex{find_memory_type(physical_device, requirements.memoryTypeBits, properties)},
+    };
+
+    CHECK(vkAllocateMemory(device, &allocate_info, nullptr, &buffer.memory));
+    CHECK(vkBindBufferMemory(device, buffer.buffer, buffer.memory, 0));
+    /* Host-visible buffers are mapped once and stay mapped; there is no benefit to unmapping them between writes. */
+    if (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) CHECK(vkMapMemory(device, buffer.memory, 0, VK_WHOLE_SIZE, 0, &buffer.p_mapped));
+    return buffer;
+}
+
+void destroy_buffer(VkDevice device, Buffer &buffer)
+{
+    /* Freeing the memory implicitly unmaps it. */
+    vkDestroyBuffer(device, buffer.buffer, nullptr);
+    vkFreeMemory(device, buffer.memory, nullptr);
+    buffer = {};
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+/*
+    - `std::runtime_error` [[.](https://en.cppreference.com/w/cpp/error/runtime_error.html)]
+*/
+#include <stdexcept>
+/*
+    - `std::string` [[.](https://en.cppreference.com/w/cpp/string/basic_string.html)]
+*/
+#include <string>
+
+#include "common.hpp"
+
+/* A buffer and the memory bound to it. `p_mapped` is only set for host-visible buffers, which stay mapped for their whole lifetime. */
+struct Buffer
+{
+    VkBuffer buffer{VK_NULL_HANDLE};
+    VkDeviceMemory memory{VK_NULL_HANDLE};
+    VkDeviceSize size{0};
+    void *p_mapped{nullptr};
+};
+
+uint32_t find_memory_type(VkPhysicalDevice, uint32_t, VkMemoryPropertyFlags);
+Buffer create_buffer(VkPhysicalDevice, VkDevice, VkDeviceSize, VkBufferUsageFlags, VkMemoryPropertyFlags);
+void destroy_buffer(VkDevice, Buffer &);
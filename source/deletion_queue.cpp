@@ -0,0 +1,33 @@
+#include "deletion_queue.hpp"
+
+void Deletion_Queue::begin_frame(uint64_t frame)
+{
+    current_frame = frame;
+    if (frame < frame_count) return;
+    /* Every frame up to this one has completed. */
+    uint64_t completed{frame - frame_count};
+
+    /* Entries are pushed in frame order, so the completed ones are at the front. */
+    while (!entries.empty() && entries.front().frame <= completed)
+    {
+        /* The entry is removed first, in case destroying it pushes more. */
+        std::function<void()> destroy{std::move(entries.front().destroy)};
+        entries.pop_front();
+        destroy();
+    }
+}
+
+void Deletion_Queue::push(std::function<void()> destroy)
+{
+    entries.push_back({current_frame, std::move(destroy)});
+}
+
+void Deletion_Queue::flush()
+{
+    while (!entries.empty())
+    {
+        std::function<void()> destroy{std::move(entries.front().destroy)};
+        entries.pop_front();
+        destroy();
+    }
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+/*
+    - `std::deque` [[.](https://en.cppreference.com/w/cpp/container/deque.html)]
+*/
+#include <deque>
+/*
+    - `std::function` [[.](https://en.cppreference.com/w/cpp/utility/functional/function.html)]
+*/
+#include <functional>
+/*
+    - `std::exchange` [[.](https://en.cppreference.com/w/cpp/utility/exchange.html)]
+*/
+#include <utility>
+
+#include "common.hpp"
+
+/*
+    Destruction that waits for the GPU instead of for the device to go idle. Work pushed while frame `n` is current runs once frame `n` has completed, which is known when its fence is waited on again `frame_count` frames later, so anything a frame in flight may use can be replaced at any time. Work runs in the order that it was pushed.
+
+    Frames are counted from `0` and never wrap, unlike the frame slots that `Frame_Ring` and `Bindless` take.
+*/
+class Deletion_Queue
+{
+    public:
+    void create(uint32_t frame_count) { this->frame_count = frame_count; }
+    /* This is called after the fence for `frame`'s slot has been waited on. */
+    void begin_frame(uint64_t frame);
+    void push(std::function<void()> destroy);
+    /* This runs everything that is left, so the device must be idle. */
+    void flush();
+
+    private:
+    struct Entry
+    {
+        uint64_t frame;
+        std::function<void()> destroy;
+    };
+
+    uint32_t frame_count{1};
+    uint64_t current_frame{0};
+    std::deque<Entry> entries;
+};
+
+/*
+    Sole ownership of a Vulkan handle that is destroyed with `DESTROY`, through a `Deletion_Queue` when there is one, so that replacing or dropping a handle never has to wait for frames in flight. This works for every handle whose `vkDestroy( ... )` takes the device, the handle and the allocator.
+*/
+template <typename T, auto DESTROY>
+class Unique_Handle
+{
+    public:
+    Unique_Handle() = default;
+    Unique_Handle(VkDevice device, T handle, Deletion_Queue *p_deletion_queue = nullptr) : device{device}, handle{handle}, p_deletion_queue{p_deletion_queue} {}
+    Unique_Handle(const Unique_Handle &) = delete;
+    Unique_Handle &operator=(const Unique_Handle &) = delete;
+    Unique_Handle(Unique_Handle &&other) noexcept : device{other.device}, handle{std::exchange(other.handle, VK_NULL_HANDLE)}, p_deletion_queue{other.p_deletion_queue} {}
+
+    Unique_Handle &operator=(Unique_Handle &&other) noexcept
+    {
+        if (this == &other) return *this;
+        reset();
+        device = other.device;
+        handle = std::exchange(other.handle, VK_NULL_HANDLE);
+        p_deletion_queue = other.p_deletion_queue;
+        return *this;
+    }
+
+    ~Unique_Handle() { reset(); }
+    T get() const { return handle; }
+    /* The handle is no longer owned, and is returned to be owned by something else. */
+    T release() { return std::exchange(handle, VK_NULL_HANDLE); }
+    operator T() const { return handle; }
+
+    void reset()
+    {
+        if (handle == VK_NULL_HANDLE) return;
+
+        if (p_deletion_queue == nullptr)
+        {
+            DESTROY(device, handle, nullptr);
+        }
+        else
+        {
+            p_deletion_queue->push([device = device, handle = handle] { DESTROY(device, handle, nullptr); });
+        }
+
+        handle = VK_NULL_HANDLE;
+    }
+
+    private:
+    VkDevice device{VK_NULL_HANDLE};
+    T handle{VK_NULL_HANDLE};
+    Deletion_Queue *p_deletion_queue{nullptr};
+};
+
+using Unique_Swapchain = Unique_Handle<VkSwapchainKHR, vkDestroySwapchainKHR>;
+using Unique_Image_View = Unique_Handle<VkImageView, vkDestroyImageView>;
+using Unique_Semaphore = Unique_Handle<VkSemaphore, vkDestroySemaphore>;
+using Unique_Pipeline = Unique_Handle<VkPipeline, vkDestroyPipeline>;
+using Unique_Pipeline_Layout = Unique_Handle<VkPipelineLayout, vkDestroyPipelineLayout>;
+using Unique_Shader_Module = Unique_Handle<VkShaderModule, vkDestroyShaderModule>;
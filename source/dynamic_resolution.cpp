@@ -0,0 +1,44 @@
+#include "dynamic_resolution.hpp"
+
+/*
+    - `std::clamp` [[.](https://en.cppreference.com/w/cpp/algorithm/clamp.html)]
+*/
+#include <algorithm>
+/*
+    - `std::sqrt` [[.](https://en.cppreference.com/w/cpp/numeric/math/sqrt.html)]
+    - `std::abs` [[.](https://en.cppreference.com/w/cpp/numeric/math/fabs.html)]
+*/
+#include <cmath>
+
+void Dynamic_Resolution::create(int64_t target_frame_time, float min_scale, uint32_t latency)
+{
+    target = target_frame_time;
+    this->min_scale = std::clamp(min_scale, 0.1f, 1.0f);
+    this->latency = latency;
+    current_scale = 1.0f;
+    average = 0.0;
+    settling = 0;
+}
+
+float Dynamic_Resolution::update(int64_t frame_time)
+{
+    if (frame_time <= 0) return current_scale;
+
+    if (settling > 0)
+    {
+        settling--;
+        return current_scale;
+    }
+
+    average = average == 0.0 ? static_cast<double>(frame_time) : average + (static_cast<double>(frame_time) - average) * SMOOTHING;
+    if (average <= target && average >= target * RAISE_BELOW) return current_scale;
+    double wanted{current_scale * std::sqrt(target * AIM / average)};
+    wanted = std::clamp(wanted, current_scale * MAX_FALL, current_scale * MAX_RISE);
+    float scale{std::clamp(static_cast<float>(wanted), min_scale, 1.0f)};
+    if (std::abs(scale - current_scale) < MIN_CHANGE) return current_scale;
+    current_scale = scale;
+    /* The average so far measured the old scale. */
+    average = 0.0;
+    settling = latency;
+    return current_scale;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+/*
+    - `uint32_t` [[.](https://en.cppreference.com/w/cpp/types/integer.html)]
+*/
+#include <cstdint>
+
+/*
+    The scale of the render resolution, chosen each frame from the measured GPU frame time. GPU time is taken to grow with the number of pixels, that is with the square of the scale, so one step aims for the middle of a band below the target.
+
+    The band is the hysteresis: the scale only drops above the target, only rises well below it, and holds in between. After a change, measurements are ignored until frames rendered at the new scale have been measured, so the controller does not react to its own lag.
+*/
+class Dynamic_Resolution
+{
+    public:
+    /* `latency` is how many frames pass before a frame's GPU time is known. */
+    void create(int64_t target_frame_time, float min_scale, uint32_t latency);
+    /* `frame_time` is in nanoseconds, or `0` when there is no measurement yet. This returns the scale for the next frame. */
+    float update(int64_t frame_time);
+    float scale() const { return current_scale; }
+
+    private:
+    /* The band, as fractions of the target */
+    static constexpr double RAISE_BELOW{0.8};
+    static constexpr double AIM{0.9};
+    /* Weight of each new measurement in the average */
+    static constexpr double SMOOTHING{0.1};
+    /* Rising is slower than falling, since a missed frame is worse than a blurry one. */
+    static constexpr double MAX_RISE{1.1};
+    static constexpr double MAX_FALL{0.75};
+    /* Smaller changes are not worth the settling time. */
+    static constexpr float MIN_CHANGE{0.02f};
+
+    int64_t target{0};
+    float min_scale{1.0f};
+    uint32_t latency{0};
+    float current_scale{1.0f};
+    double average{0.0};
+    uint32_t settling{0};
+};
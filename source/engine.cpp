@@ -1,34 +1,96 @@
 #include "engine.hpp"
 
-void Engine::initialize()
-{
-    create_window();
-    create_instance();
-    create_debug_utils_messenger();
-    create_surface();
-    choose_physical_device();
-    create_logical_device();
-    create_swapchain();
-    create_image_views();
-    create_render_pass();
-    create_graphics_pipeline();
-    create_framebuffers();
-    create_command_pool();
-    create_command_buffer();
-    create_sync_object();
+/*
+    - `std::abs` [[.](https://en.cppreference.com/w/cpp/numeric/math/fabs.html)]
+    - `std::sin` [[.](https://en.cppreference.com/w/cpp/numeric/math/sin.html)]
+    - `std::sqrt` [[.](https://en.cppreference.com/w/cpp/numeric/math/sqrt.html)]
+*/
+#include <cmath>
+/*
+    - `std::memcpy` [[.](https://en.cppreference.com/w/cpp/string/byte/memcpy.html)]
+*/
+#include <cstring>
+/*
+    - `std::filesystem::last_write_time` [[.](https://en.cppreference.com/w/cpp/filesystem/last_write_time.html)]
+*/
+#include <filesystem>
+
+#include "image_file.hpp"
+#include "mesh_import.hpp"
+
+void Engine::initialize(const Options &options)
+{
+    initialize_begin = Profiler::now();
+    Profiler::name_thread("main");
+    PROFILE_FUNCTION();
+    this->options = options;
+    if (options.meshes.size() + 1 > STORAGE_RANGE / sizeof(Object)) throw std::runtime_error("There are more meshes than fit in one frame's objects.\n");
+    /* The pool runs the other steps, so it comes first. */
+    create_thread_pool();
+    /* Each step starts once the steps that it needs are done, and independent steps run in parallel. SDL's window and surface calls stay on this thread. */
+    Task_Graph graph;
+    using Task = Task_Graph::Task;
+    Task window_step{graph.add([this]() { create_window(); }, {}, true)};
+    Task layers_step{graph.add([this]() { validation_layers_supported = query_validation_layer_support(); })};
+    Task shaders_step{graph.add([this]() { read_shaders(); })};
+    Task cache_file_step{graph.add([this]() { read_pipeline_cache(); })};
+    /* Meshes are read, or imported, long before there is a device to upload them to. */
+    std::vector<Task> mesh_steps;
+    mesh_data.resize(options.meshes.size());
+    for (size_t i{0}; i < options.meshes.size(); i++) mesh_steps.push_back(graph.add([this, i]() { mesh_data[i] = load_mesh_data(this->options.meshes[i]); }));
+    Task instance_step{graph.add([this]() { create_instance(); }, {window_step, layers_step}, true)};
+    graph.add([this]() { create_debug_utils_messenger(); }, {instance_step});
+    Task surface_step{graph.add([this]() { create_surface(); }, {window_step, instance_step}, true)};
+    Task physical_step{graph.add([this]() { choose_physical_device(); }, {surface_step})};
+    Task device_step{graph.add([this]() { create_logical_device(); }, {physical_step})};
+    Task deletion_step{graph.add([this]() { create_deletion_queue(); }, {device_step})};
+    graph.add([this]() { create_gpu_profiler(); }, {device_step});
+    Task swapchain_step{graph.add([this]() { create_swapchain(); }, {deletion_step})};
+    graph.add([this]() { create_image_views(); }, {swapchain_step});
+    Task render_graph_step{graph.add([this]() { create_render_graph(); }, {deletion_step})};
+    Task set_layout_step{graph.add([this]() { create_descriptor_set_layout(); }, {device_step})};
+    Task bindless_step{graph.add([this]() { create_bindless(); }, {device_step})};
+    Task cache_step{graph.add([this]() { create_pipeline_cache(); }, {device_step, cache_file_step})};
+    Task texture_step{graph.add([this]() { create_texture_streamer(); }, {bindless_step, deletion_step})};
+    Task sprite_step{graph.add([this]() { create_sprite_batch(); }, {texture_step})};
+    /* `Bindless` is not thread-safe, so the steps that add to it run one after another. */
+    Task particle_step{graph.add([this]() { create_particle_system(); }, {sprite_step, deletion_step})};
+    Task library_step{graph.add([this]() { create_pipeline_library(); }, {render_graph_step, cache_step})};
+    graph.add([this]() { create_graphics_pipeline(); }, {swapchain_step, render_graph_step, set_layout_step, bindless_step, shaders_step, cache_step, sprite_step, particle_step, library_step});
+    Task command_pool_step{graph.add([this]() { create_command_pool(); }, {device_step})};
+    Task frame_ring_step{graph.add([this]() { create_frame_ring(); }, {device_step})};
+    Task descriptor_pool_step{graph.add([this]() { create_descriptor_pool(); }, {device_step})};
+    graph.add([this]() { create_descriptor_set(); }, {descriptor_pool_step, set_layout_step, frame_ring_step});
+    mesh_steps.push_back(command_pool_step);
+    Task meshes_step{graph.add([this]() { create_meshes(); }, mesh_steps)};
+    /* The command pool is not thread-safe, and the mesh uploads allocate from it too. */
+    graph.add([this]() { create_command_buffers(); }, {meshes_step});
+    graph.add([this]() { create_sync_objects(); }, {swapchain_step});
+    graph.add([this]() { create_readback(); }, {device_step});
+    graph.add([this]() { create_dynamic_resolution(); });
+    graph.run(thread_pool);
+    initialize_end = Profiler::now();
+}
+
+void Engine::create_thread_pool()
+{
+    PROFILE_FUNCTION();
+    thread_pool.start();
 }
 
 void Engine::create_window()
 {
+    PROFILE_FUNCTION();
     SDL_Init(SDL_INIT_VIDEO);
-    SDL_WindowFlags flags{SDL_WINDOW_VULKAN};
+    SDL_WindowFlags flags{SDL_WINDOW_VULKAN | SDL_WINDOW_RESIZABLE};
     p_window = SDL_CreateWindow("Hello, world.", window_extent.width, window_extent.height, flags);
     if (p_window == nullptr) throw std::runtime_error("The window could not be created.\n" + std::string(SDL_GetError()) + "\n");
 }
 
 void Engine::create_instance()
 {
-    if (validation_layers_enabled && !query_validation_layer_support()) throw std::runtime_error("The requested validation layers are not supported.\n");
+    PROFILE_FUNCTION();
+    if (validation_layers_enabled && !validation_layers_supported) throw std::runtime_error("The requested validation layers are not supported.\n");
 
     VkApplicationInfo application_info{
         .sType{VK_STRUCTURE_TYPE_APPLICATION_INFO},
@@ -37,7 +99,8 @@ void Engine::create_instance()
         .applicationVersion{VK_MAKE_VERSION(0, 0, 0)},
         // .pEngineName{},
         // .engineVersion{},
-        .apiVersion{VK_API_VERSION_1_0},
+        /* Descriptor indexing is core in 1.2. */
+        .apiVersion{VK_API_VERSION_1_2},
     };
 
     VkInstanceCreateFlags flags{};
@@ -88,6 +151,7 @@ void Engine::create_instance()
 
 bool Engine::query_validation_layer_support()
 {
+    PROFILE_FUNCTION();
     uint32_t count;
     vkEnumerateInstanceLayerProperties(&count, nullptr);
     std::vector<VkLayerProperties> properties(count);
@@ -115,16 +179,19 @@ bool Engine::query_validation_layer_support()
 
 void Engine::create_debug_utils_messenger()
 {
+    PROFILE_FUNCTION();
 }
 
 void Engine::create_surface()
 {
+    PROFILE_FUNCTION();
     /* [[.](https://wiki.libsdl.org/SDL3/SDL_Vulkan_CreateSurface)] */
     if (!SDL_Vulkan_CreateSurface(p_window, instance, nullptr, &surface)) throw std::runtime_error("The window surface could not be created.\n");
 }
 
 void Engine::choose_physical_device()
 {
+    PROFILE_FUNCTION();
     uint32_t count{0};
     vkEnumeratePhysicalDevices(instance, &count, nullptr);
     if (count == 0) throw std::runtime_error("No physical device with Vulkan support could be found.\n");
@@ -147,6 +214,7 @@ bool Engine::physical_device_suitable(VkPhysicalDevice physical_device)
 {
     Queue_Family_Index indices{find_queue_families(physical_device)};
     bool extensions_supported{query_extension_support(physical_device)};
+    bool features_supported{query_feature_support(physical_device)};
     bool swapchain_adequate{false};
 
     if (extensions_supported)
@@ -155,7 +223,7 @@ bool Engine::physical_device_suitable(VkPhysicalDevice physical_device)
         swapchain_adequate = !support.surface_formats.empty() && !support.present_modes.empty();
     }
 
-    return indices.completed() && extensions_supported && swapchain_adequate;
+    return indices.completed() && extensions_supported && features_supported && swapchain_adequate;
 }
 
 Engine::Queue_Family_Index Engine::find_queue_families(VkPhysicalDevice physical_device)
@@ -207,6 +275,23 @@ bool Engine::query_extension_support(VkPhysicalDevice physical_device)
     return all_supported;
 }
 
+bool Engine::query_feature_support(VkPhysicalDevice physical_device)
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physical_device, &properties);
+    if (properties.apiVersion < VK_API_VERSION_1_2) return false;
+    VkPhysicalDeviceVulkan12Features vulkan_12_features{.sType{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES}};
+
+    VkPhysicalDeviceFeatures2 features{
+        .sType{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2},
+        .pNext{&vulkan_12_features},
+    };
+
+    vkGetPhysicalDeviceFeatures2(physical_device, &features);
+    /* These are what `Bindless` needs; they are enabled in `create_logical_device`. */
+    return vulkan_12_features.descriptorIndexing && vulkan_12_features.runtimeDescriptorArray && vulkan_12_features.descriptorBindingPartiallyBound && vulkan_12_features.descriptorBindingUpdateUnusedWhilePending && vulkan_12_features.descriptorBindingSampledImageUpdateAfterBind && vulkan_12_features.descriptorBindingStorageBufferUpdateAfterBind && vulkan_12_features.shaderSampledImageArrayNonUniformIndexing && vulkan_12_features.shaderStorageBufferArrayNonUniformIndexing;
+}
+
 Engine::Swapchain_Support Engine::query_swapchain_support(VkPhysicalDevice physical_device)
 {
     Swapchain_Support support;
@@ -234,6 +319,7 @@ Engine::Swapchain_Support Engine::query_swapchain_support(VkPhysicalDevice physi
 
 void Engine::create_logical_device()
 {
+    PROFILE_FUNCTION();
     Queue_Family_Index indices{find_queue_families(physical_device)};
     std::vector<VkDeviceQueueCreateInfo> queue_create_infos;
     std::set<uint32_t> queue_family_indices{indices.graphics_family.value(), indices.present_family.value()};
@@ -259,11 +345,73 @@ void Engine::create_logical_device()
 #define VK_KHR_PORTABILITY_SUBSET_EXTENSION_NAME "VK_KHR_portability_subset"
     device_extensions.push_back(VK_KHR_PORTABILITY_SUBSET_EXTENSION_NAME);
 #endif /* __APPLE__ */
-    VkPhysicalDeviceFeatures enabled_features{};
+    uint32_t extension_count;
+    vkEnumerateDeviceExtensionProperties(physical_device, nullptr, &extension_count, nullptr);
+    std::vector<VkExtensionProperties> extension_properties(extension_count);
+    vkEnumerateDeviceExtensionProperties(physical_device, nullptr, &extension_count, extension_properties.data());
+
+    /* GPU zones are placed on the CPU timeline more exactly with calibrated timestamps, which are optional. */
+    for (const auto &property : extension_properties)
+    {
+        if (strcmp(property.extensionName, VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME) != 0) continue;
+        device_extensions.push_back(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME);
+        calibrated_timestamps_enabled = true;
+        break;
+    }
+
+    VkPhysicalDeviceFeatures supported_features;
+    vkGetPhysicalDeviceFeatures(physical_device, &supported_features);
+
+    VkPhysicalDeviceFeatures enabled_features{
+        /* Block-compressed textures are used when the device supports them. */
+        .textureCompressionBC{supported_features.textureCompressionBC},
+    };
+
+    VkPhysicalDeviceVulkan12Features vulkan_12_features{
+        .sType{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES},
+        // .pNext{},
+        .descriptorIndexing{VK_TRUE},
+        .shaderSampledImageArrayNonUniformIndexing{VK_TRUE},
+        .shaderStorageBufferArrayNonUniformIndexing{VK_TRUE},
+        .descriptorBindingSampledImageUpdateAfterBind{VK_TRUE},
+        .descriptorBindingStorageBufferUpdateAfterBind{VK_TRUE},
+        .descriptorBindingUpdateUnusedWhilePending{VK_TRUE},
+        .descriptorBindingPartiallyBound{VK_TRUE},
+        .runtimeDescriptorArray{VK_TRUE},
+    };
+
+    /* Low latency waits for presents to reach the display, which takes both extensions. Without them, it waits for the GPU instead. */
+    VkPhysicalDevicePresentWaitFeaturesKHR present_wait_features{.sType{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR}};
+    VkPhysicalDevicePresentIdFeaturesKHR present_id_features{.sType{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR}, .pNext{&present_wait_features}};
+    uint32_t present_extension_count{0};
+
+    for (const auto &property : extension_properties)
+    {
+        if (strcmp(property.extensionName, VK_KHR_PRESENT_ID_EXTENSION_NAME) == 0 || strcmp(property.extensionName, VK_KHR_PRESENT_WAIT_EXTENSION_NAME) == 0) present_extension_count++;
+    }
+
+    if (options.present_mode == "low-latency" && present_extension_count == 2)
+    {
+        VkPhysicalDeviceFeatures2 features{
+            .sType{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2},
+            .pNext{&present_id_features},
+        };
+
+        vkGetPhysicalDeviceFeatures2(physical_device, &features);
+
+        if (present_id_features.presentId && present_wait_features.presentWait)
+        {
+            device_extensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+            device_extensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+            /* The queried features are enabled as they are. */
+            vulkan_12_features.pNext = &present_id_features;
+            present_wait_enabled = true;
+        }
+    }
 
     VkDeviceCreateInfo create_info{
         .sType{VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO},
-        // .pNext{},
+        .pNext{&vulkan_12_features},
         // .flags{},
         .queueCreateInfoCount{static_cast<uint32_t>(queue_create_infos.size())},
         .pQueueCreateInfos{queue_create_infos.data()},
@@ -286,17 +434,48 @@ void Engine::create_logical_device()
     CHECK(vkCreateDevice(physical_device, &create_info, nullptr, &device));
     vkGetDeviceQueue(device, indices.graphics_family.value(), 0, &graphics_queue);
     vkGetDeviceQueue(device, indices.present_family.value(), 0, &present_queue);
+    if (present_wait_enabled) p_wait_for_present = reinterpret_cast<PFN_vkWaitForPresentKHR>(vkGetDeviceProcAddr(device, "vkWaitForPresentKHR"));
+}
+
+void Engine::create_deletion_queue()
+{
+    PROFILE_FUNCTION();
+    deletion_queue.create(MAX_FRAMES_IN_FLIGHT);
+}
+
+void Engine::create_gpu_profiler()
+{
+    PROFILE_FUNCTION();
+    gpu_profiler.create(instance, physical_device, device, find_queue_families(physical_device).graphics_family.value(), calibrated_timestamps_enabled, MAX_FRAMES_IN_FLIGHT);
 }
 
 void Engine::create_swapchain()
 {
+    PROFILE_FUNCTION();
     Swapchain_Support support{query_swapchain_support(physical_device)};
     VkSurfaceFormatKHR surface_format{choose_swapchain_surface_format(support.surface_formats)};
     VkPresentModeKHR present_mode{choose_swapchain_present_mode(support.present_modes)};
     VkExtent2D extent{choose_swapchain_extent(support.surface_capabilities)};
-    /* We request one more image than the minimum. */
-    uint32_t image_count{support.surface_capabilities.minImageCount + 1};
+    /* By default, we request one more image than the minimum, so that the CPU need not wait for an image; low latency takes the minimum, so that fewer frames queue up. */
+    uint32_t image_count{support.surface_capabilities.minImageCount + (options.present_mode == "low-latency" ? 0 : 1)};
+    if (options.swapchain_images != 0) image_count = std::max(options.swapchain_images, support.surface_capabilities.minImageCount);
     if (image_count > support.surface_capabilities.maxImageCount && support.surface_capabilities.maxImageCount > 0) image_count = support.surface_capabilities.maxImageCount;
+    /* Captures copy from the swapchain images, which only some surfaces allow. */
+    swapchain_capturable = (support.surface_capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT) && Readback::texel_size(surface_format.format) != 0;
+    if (!swapchain_capturable && (!options.capture.empty() || !options.golden.empty())) throw std::runtime_error("The swapchain images cannot be captured.\n");
+    VkImageUsageFlags usage{VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT};
+    if (swapchain_capturable) usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+
+    /* With dynamic resolution, the scene is blitted onto the swapchain images. */
+    if (options.target_frame_time > 0.0)
+    {
+        VkFormatProperties format_properties;
+        vkGetPhysicalDeviceFormatProperties(physical_device, surface_format.format, &format_properties);
+        constexpr VkFormatFeatureFlags BLIT{VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT};
+        if (!(support.surface_capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT) || (format_properties.optimalTilingFeatures & BLIT) != BLIT) throw std::runtime_error("The swapchain images cannot be blitted to, which dynamic resolution needs.\n");
+        usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        upscale_filter = format_properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+    }
 
     VkSwapchainCreateInfoKHR create_info{
         .sType{VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR},
@@ -308,7 +487,7 @@ void Engine::create_swapchain()
         .imageColorSpace{surface_format.colorSpace},
         .imageExtent{extent},
         .imageArrayLayers{1},
-        .imageUsage{VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT},
+        .imageUsage{usage},
         // .imageSharingMode{},
         // .queueFamilyIndexCount{},
         // .pQueueFamilyIndices{},
@@ -316,7 +495,8 @@ void Engine::create_swapchain()
         .compositeAlpha{VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR},
         .presentMode{present_mode},
         .clipped{VK_TRUE},
-        .oldSwapchain{VK_NULL_HANDLE},
+        /* This is `VK_NULL_HANDLE` the first time. */
+        .oldSwapchain{swapchain},
     };
 
     Queue_Family_Index indices{find_queue_families(physical_device)};
@@ -333,7 +513,10 @@ void Engine::create_swapchain()
         create_info.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
     }
 
-    CHECK(vkCreateSwapchainKHR(device, &create_info, nullptr, &swapchain));
+    VkSwapchainKHR new_swapchain;
+    CHECK(vkCreateSwapchainKHR(device, &create_info, nullptr, &new_swapchain));
+    /* The old swapchain is retired, since frames in flight may still present to it. */
+    swapchain = Unique_Swapchain{device, new_swapchain, &deletion_queue};
     vkGetSwapchainImagesKHR(device, swapchain, &image_count, nullptr);
     swapchain_images.resize(image_count);
     vkGetSwapchainImagesKHR(device, swapchain, &image_count, swapchain_images.data());
@@ -341,7 +524,7 @@ void Engine::create_swapchain()
     swapchain_extent = extent;
 }
 
-VkSurfaceFormatKHR Engine::choose_swapchain_surface_format(const std::vector<VkSurfaceFormatKHR> &surface_formats)
+VkSurfaceFormatKHR Engine::choose_swapchain_surface_format(std::span<const VkSurfaceFormatKHR> surface_formats)
 {
     for (const auto &surface_format : surface_formats)
     {
@@ -352,12 +535,16 @@ VkSurfaceFormatKHR Engine::choose_swapchain_surface_format(const std::vector<VkS
     return surface_formats[0];
 }
 
-VkPresentModeKHR Engine::choose_swapchain_present_mode(const std::vector<VkPresentModeKHR> &present_modes)
+VkPresentModeKHR Engine::choose_swapchain_present_mode(std::span<const VkPresentModeKHR> present_modes)
 {
+    /* FIFO saves the most energy, and low latency paces itself on FIFO's vertical blanks. IMMEDIATE tears, but never waits, which suits benchmarks. */
+    VkPresentModeKHR wanted{VK_PRESENT_MODE_FIFO_KHR};
+    if (options.present_mode == "mailbox") wanted = VK_PRESENT_MODE_MAILBOX_KHR;
+    else if (options.present_mode == "immediate") wanted = VK_PRESENT_MODE_IMMEDIATE_KHR;
+
     for (const auto &present_mode : present_modes)
     {
-        if (present_mode == VK_PRESENT_MODE_MAILBOX_KHR) return present_mode;
-        /* On mobile devices, where energy usage is more important, we may prefer to use `VK_PRESENT_MODE_FIFO_KHR`. */
+        if (present_mode == wanted) return present_mode;
     }
 
     /* Only `VK_PRESENT_MODE_FIFO_KHR` is guaranteed to be available. */
@@ -386,7 +573,8 @@ VkExtent2D Engine::choose_swapchain_extent(const VkSurfaceCapabilitiesKHR &surfa
 
 void Engine::create_image_views()
 {
-    swapchain_image_views.resize(swapchain_images.size());
+    PROFILE_FUNCTION();
+    swapchain_image_views.clear();
 
     for (size_t i{0}; i < swapchain_images.size(); i++)
     {
@@ -412,223 +600,205 @@ void Engine::create_image_views()
             },
         };
 
-        CHECK(vkCreateImageView(device, &create_info, nullptr, &swapchain_image_views[i]));
+        VkImageView image_view;
+        CHECK(vkCreateImageView(device, &create_info, nullptr, &image_view));
+        swapchain_image_views.emplace_back(device, image_view, &deletion_queue);
     }
 }
 
-void Engine::create_render_pass()
+void Engine::create_render_graph()
 {
-    VkAttachmentDescription attachment{
-        // .flags{},
-        .format{swapchain_image_format},
-        .samples{VK_SAMPLE_COUNT_1_BIT},
-        .loadOp{VK_ATTACHMENT_LOAD_OP_CLEAR},
-        .storeOp{VK_ATTACHMENT_STORE_OP_STORE},
-        .stencilLoadOp{VK_ATTACHMENT_LOAD_OP_DONT_CARE},
-        .stencilStoreOp{VK_ATTACHMENT_STORE_OP_DONT_CARE},
-        .initialLayout{VK_IMAGE_LAYOUT_UNDEFINED},
-        .finalLayout{VK_IMAGE_LAYOUT_PRESENT_SRC_KHR},
-    };
-
-    VkAttachmentReference color_attachment{
-        .attachment{0},
-        .layout{VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL},
-    };
+    PROFILE_FUNCTION();
+    render_graph.create(physical_device, device, &deletion_queue);
+    depth_format = find_depth_format();
+}
 
-    VkSubpassDescription subpass{
-        // .flags{},
-        .pipelineBindPoint{VK_PIPELINE_BIND_POINT_GRAPHICS},
-        // .inputAttachmentCount{},
-        // .pInputAttachments{},
-        .colorAttachmentCount{1},
-        .pColorAttachments{&color_attachment},
-        // .pResolveAttachments{},
-        // .pDepthStencilAttachment{},
-        // .preserveAttachmentCount{},
-        // .pPreserveAttachments{},
-    };
-
-    VkSubpassDependency dependency{
-        .srcSubpass{VK_SUBPASS_EXTERNAL},
-        .dstSubpass{0},
-        .srcStageMask{VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT},
-        .dstStageMask{VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT},
-        .srcAccessMask{0},
-        .dstAccessMask{VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT},
-        // .dependencyFlags{},
-    };
-
-    VkRenderPassCreateInfo create_info{
-        .sType{VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO},
-        // .pNext{},
-        // .flags{},
-        .attachmentCount{1},
-        .pAttachments{&attachment},
-        .subpassCount{1},
-        .pSubpasses{&subpass},
-        .dependencyCount{1},
-        .pDependencies{&dependency},
-    };
+VkFormat Engine::find_depth_format()
+{
+    /* At least one of `VK_FORMAT_D32_SFLOAT` and `VK_FORMAT_D24_UNORM_S8_UINT` must be supported. */
+    for (VkFormat format : {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT})
+    {
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(physical_device, format, &properties);
+        if (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT) return format;
+    }
 
-    CHECK(vkCreateRenderPass(device, &create_info, nullptr, &render_pass));
+    throw std::runtime_error("No depth format is supported.\n");
 }
 
-void Engine::create_graphics_pipeline()
+void Engine::create_descriptor_set_layout()
 {
-    VkShaderModule vert_shader_module{create_shader_module(read_file("bin/triangle.vert.spv"))};
-    VkShaderModule frag_shader_module{create_shader_module(read_file("bin/triangle.frag.spv"))};
-
-    VkPipelineShaderStageCreateInfo stages[]{
+    PROFILE_FUNCTION();
+    VkDescriptorSetLayoutBinding bindings[]{
         {
-            .sType{VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO},
-            // .pNext{},
-            // .flags{},
-            .stage{VK_SHADER_STAGE_VERTEX_BIT},
-            .module{vert_shader_module},
-            .pName{"main"},
-            // .pSpecializationInfo{},
+            .binding{0},
+            .descriptorType{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC},
+            .descriptorCount{1},
+            .stageFlags{VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT},
+            /* This is optional. */ .pImmutableSamplers{nullptr},
         },
         {
-            .sType{VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO},
-            // .pNext{},
-            // .flags{},
-            .stage{VK_SHADER_STAGE_FRAGMENT_BIT},
-            .module{frag_shader_module},
-            .pName{"main"},
-            // .pSpecializationInfo{},
+            .binding{1},
+            .descriptorType{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC},
+            .descriptorCount{1},
+            .stageFlags{VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT},
+            /* This is optional. */ .pImmutableSamplers{nullptr},
         },
     };
 
-    VkPipelineVertexInputStateCreateInfo vertex_input_state{
-        .sType{VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO},
+    VkDescriptorSetLayoutCreateInfo create_info{
+        .sType{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO},
         // .pNext{},
         // .flags{},
-        /* This is optional. */ .vertexBindingDescriptionCount{0},
-        /* This is optional. */ .pVertexBindingDescriptions{nullptr},
-        /* This is optional. */ .vertexAttributeDescriptionCount{0},
-        /* This is optional. */ .pVertexAttributeDescriptions{nullptr},
+        .bindingCount{2},
+        .pBindings{bindings},
     };
 
-    VkPipelineInputAssemblyStateCreateInfo input_assembly_state{
-        .sType{VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO},
-        // .pNext{},
-        // .flags{},
-        .topology{VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST},
-        .primitiveRestartEnable{VK_FALSE},
-    };
-
-    VkPipelineViewportStateCreateInfo viewport_state{
-        .sType{VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO},
-        // .pNext{},
-        // .flags{},
-        .viewportCount{1},
-        // .pViewports{},
-        .scissorCount{1},
-        // .pScissors{},
-    };
+    CHECK(vkCreateDescriptorSetLayout(device, &create_info, nullptr, &descriptor_set_layout));
+}
 
-    VkPipelineRasterizationStateCreateInfo rasterization_state{
-        .sType{VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO},
-        // .pNext{},
-        // .flags{},
-        .depthClampEnable{VK_FALSE},
-        .rasterizerDiscardEnable{VK_FALSE},
-        .polygonMode{VK_POLYGON_MODE_FILL},
-        .cullMode{VK_CULL_MODE_BACK_BIT},
-        .frontFace{VK_FRONT_FACE_CLOCKWISE},
-        .depthBiasEnable{VK_FALSE},
-        /* This is optional. */ .depthBiasConstantFactor{0.0f},
-        /* This is optional. */ .depthBiasClamp{0.0f},
-        /* This is optional. */ .depthBiasSlopeFactor{0.0f},
-        .lineWidth{1.0f},
-    };
-
-    VkPipelineMultisampleStateCreateInfo multisample_state{
-        .sType{VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO},
-        // .pNext{},
-        // .flags{},
-        .rasterizationSamples{VK_SAMPLE_COUNT_1_BIT},
-        .sampleShadingEnable{VK_FALSE},
-        /* This is optional. */ .minSampleShading{1.0f},
-        /* This is optional. */ .pSampleMask{nullptr},
-        /* This is optional. */ .alphaToCoverageEnable{VK_FALSE},
-        /* This is optional. */ .alphaToOneEnable{VK_FALSE},
-    };
-
-    VkPipelineColorBlendAttachmentState attachment{
-        .blendEnable{VK_FALSE},
-        /* This is optional. */ .srcColorBlendFactor{VK_BLEND_FACTOR_ONE},
-        /* This is optional. */ .dstColorBlendFactor{VK_BLEND_FACTOR_ZERO},
-        /* This is optional. */ .colorBlendOp{VK_BLEND_OP_ADD},
-        /* This is optional. */ .srcAlphaBlendFactor{VK_BLEND_FACTOR_ONE},
-        /* This is optional. */ .dstAlphaBlendFactor{VK_BLEND_FACTOR_ZERO},
-        /* This is optional. */ .alphaBlendOp{VK_BLEND_OP_ADD},
-        .colorWriteMask{VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT},
-    };
-
-    VkPipelineColorBlendStateCreateInfo color_blend_state{
-        .sType{VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO},
-        // .pNext{},
-        // .flags{},
-        .logicOpEnable{VK_FALSE},
-        /* This is optional. */ .logicOp{VK_LOGIC_OP_COPY},
-        .attachmentCount{1},
-        .pAttachments{&attachment},
-        .blendConstants{
-            /* This is optional. */ 0.0f,
-            /* This is optional. */ 0.0f,
-            /* This is optional. */ 0.0f,
-            /* This is optional. */ 0.0f,
-        },
-    };
+void Engine::create_bindless()
+{
+    PROFILE_FUNCTION();
+    bindless.create(physical_device, device);
+}
 
-    std::vector<VkDynamicState> dynamic_states{VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+void Engine::create_pipeline_library()
+{
+    PROFILE_FUNCTION();
+    pipeline_library.create(device, &deletion_queue, &thread_pool, &render_graph, pipeline_cache);
+}
 
-    VkPipelineDynamicStateCreateInfo dynamic_state{
-        .sType{VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO},
-        // .pNext{},
-        // .flags{},
-        .dynamicStateCount{static_cast<uint32_t>(dynamic_states.size())},
-        .pDynamicStates{dynamic_states.data()},
+void Engine::create_graphics_pipeline()
+{
+    PROFILE_FUNCTION();
+    /* These are destroyed when this returns or throws, by which time no job refers to them. */
+    Unique_Shader_Module sprite_vert_shader_module{device, create_shader_module(shader_code.at("sprite.vert"))};
+    Unique_Shader_Module sprite_frag_shader_module{device, create_shader_module(shader_code.at("sprite.frag"))};
+    /* In the order of `Particle_System::create_pipelines` */
+    std::vector<Unique_Shader_Module> particle_shader_modules;
+    if (options.particles > 0)
+        for (const char *name : {"particle_emit.comp", "particle_simulate.comp", "particle_finish.comp", "particle_sort.comp", "particle.vert", "particle.frag"}) particle_shader_modules.emplace_back(device, create_shader_module(shader_code.at(name)));
+
+    VkPushConstantRange push_constant_range{
+        .stageFlags{VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT},
+        .offset{0},
+        .size{sizeof(Push_Constants)},
     };
 
+    /* `set = 0` is the per-frame ring and `set = 1` is the global bindless set. */
+    VkDescriptorSetLayout set_layouts[]{descriptor_set_layout, bindless.layout()};
+
     VkPipelineLayoutCreateInfo pipeline_layout_create_info{
         .sType{VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO},
         // .pNext{},
         // .flags{},
-        /* This is optional. */ .setLayoutCount{0},
-        /* This is optional. */ .pSetLayouts{nullptr},
-        /* This is optional. */ .pushConstantRangeCount{0},
-        /* This is optional. */ .pPushConstantRanges{nullptr},
+        .setLayoutCount{2},
+        .pSetLayouts{set_layouts},
+        .pushConstantRangeCount{1},
+        .pPushConstantRanges{&push_constant_range},
     };
 
-    CHECK(vkCreatePipelineLayout(device, &pipeline_layout_create_info, nullptr, &pipeline_layout));
+    VkPipelineLayout layout;
+    CHECK(vkCreatePipelineLayout(device, &pipeline_layout_create_info, nullptr, &layout));
+    Unique_Pipeline_Layout new_pipeline_layout{device, layout, &deletion_queue};
+
+    /* The triangle and mesh pipelines share everything but their shaders, vertex input and depth state. The triangle is drawn first and does not take part in depth testing. Their fragment shaders' `TEXTURED` is on, which draws everything correctly, and is only turned off in variants. */
+    Pipeline_Key new_triangle_key{
+        .layout{layout},
+        .vertex_shader{pipeline_library.shader("triangle.vert")},
+        .fragment_shader{pipeline_library.shader("triangle.frag")},
+        .constant_count{1},
+        .constants{VK_TRUE},
+        .color_format{swapchain_image_format},
+        .depth_format{depth_format},
+    };
 
-    VkGraphicsPipelineCreateInfo create_info{
-        .sType{VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO},
-        // .pNext{},
-        // .flags{},
-        .stageCount{2},
-        .pStages{stages},
-        .pVertexInputState{&vertex_input_state},
-        .pInputAssemblyState{&input_assembly_state},
-        // .pTessellationState{},
-        .pViewportState{&viewport_state},
-        .pRasterizationState{&rasterization_state},
-        .pMultisampleState{&multisample_state},
-        /* This is optional. */ .pDepthStencilState{nullptr},
-        .pColorBlendState{&color_blend_state},
-        .pDynamicState{&dynamic_state},
-        .layout{pipeline_layout},
-        .renderPass{render_pass},
-        .subpass{0},
-        /* This is optional. */ .basePipelineHandle{VK_NULL_HANDLE},
-        /* This is optional. */ .basePipelineIndex{-1},
-    };
-
-    CHECK(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &create_info, nullptr, &graphics_pipeline));
-    vkDestroyShaderModule(device, frag_shader_module, nullptr);
-    vkDestroyShaderModule(device, vert_shader_module, nullptr);
+    Pipeline_Key new_mesh_key{new_triangle_key};
+    new_mesh_key.vertex_shader = pipeline_library.shader("mesh.vert");
+    new_mesh_key.fragment_shader = pipeline_library.shader("mesh.frag");
+    new_mesh_key.vertex_layout = Pipeline_Key::Vertex_Layout::MESH;
+    new_mesh_key.depth_test = VK_TRUE;
+    new_mesh_key.depth_write = VK_TRUE;
+
+    /* The render graph makes the render passes that these are used in, with the same attachment formats. Sprites are drawn over the finished frame, in render passes with the swapchain image alone, and particles over the scene, in render passes with its attachments. */
+    VkRenderPass render_pass{render_graph.compatible_render_pass({swapchain_image_format}, depth_format)};
+    VkRenderPass sprite_render_pass{render_graph.compatible_render_pass({swapchain_image_format}, VK_FORMAT_UNDEFINED)};
+
+    /* Every job returns its pipelines, which are set on this thread once all of them have succeeded, since replacing pipelines retires the old ones to the deletion queue. */
+    Pipeline_Key required[]{new_triangle_key, new_mesh_key};
+    Pipeline_Library::Staged library_pipelines{pipeline_library.compile(shader_code, required)};
+
+    std::future<Sprite_Batch::Pipelines> sprite_future{thread_pool.submit([this, sprite_vert_shader_module = sprite_vert_shader_module.get(), sprite_frag_shader_module = sprite_frag_shader_module.get(), sprite_render_pass]() {
+        PROFILE_ZONE("sprite pipelines");
+        return sprite_batch.create_pipelines(sprite_vert_shader_module, sprite_frag_shader_module, sprite_render_pass, pipeline_cache);
+    })};
+
+    std::optional<std::future<Particle_System::Pipelines>> particle_future;
+
+    if (options.particles > 0)
+    {
+        particle_future = thread_pool.submit([this, &particle_shader_modules, render_pass]() {
+            PROFILE_ZONE("particle pipelines");
+            const auto &m{particle_shader_modules};
+            return particle_system.create_pipelines(m[0], m[1], m[2], m[3], m[4], m[5], render_pass, pipeline_cache);
+        });
+    }
+
+    /* Every job refers to the modules, so all of them finish before anything is thrown. */
+    pipeline_library.wait(library_pipelines);
+    thread_pool.wait(sprite_future);
+    if (particle_future) thread_pool.wait(*particle_future);
+    Sprite_Batch::Pipelines sprite_pipelines;
+    Particle_System::Pipelines particle_pipelines;
+    std::exception_ptr p_exception;
+
+    try
+    {
+        sprite_pipelines = sprite_future.get();
+    }
+    catch (...)
+    {
+        p_exception = std::current_exception();
+    }
+
+    try
+    {
+        if (particle_future) particle_pipelines = particle_future->get();
+    }
+    catch (...)
+    {
+        p_exception = std::current_exception();
+    }
+
+    if (p_exception) std::rethrow_exception(p_exception);
+    /* The library keeps what it had if this throws, and the new pipelines above are dropped, so a failed reload changes nothing. */
+    pipeline_library.commit(std::move(library_pipelines));
+    sprite_batch.set_pipelines(std::move(sprite_pipelines));
+    if (particle_future) particle_system.set_pipelines(std::move(particle_pipelines));
+    /* The library has retired the old pipelines, which frames in flight may still be using, and so does replacing the layout. */
+    triangle_key = new_triangle_key;
+    mesh_key = new_mesh_key;
+    pipeline_layout = std::move(new_pipeline_layout);
+    /* A new pipeline may reuse the handle of a destroyed one, so reused scene command buffers are not told apart by handle alone. */
+    for (auto &recorded_scene : recorded_scenes) recorded_scene.reset();
+}
+
+void Engine::read_shaders()
+{
+    PROFILE_FUNCTION();
+    std::map<std::string, std::vector<char>> code;
+    const char *names[]{"triangle.vert", "triangle.frag", "mesh.vert", "mesh.frag", "sprite.vert", "sprite.frag", "particle_emit.comp", "particle_simulate.comp", "particle_finish.comp", "particle_sort.comp", "particle.vert", "particle.frag"};
+    for (const char *name : names) code[name] = read_file("bin/" + std::string{name} + ".spv");
+    /* A reload that fails keeps the code there was. */
+    shader_code = std::move(code);
+}
+
+void Engine::read_pipeline_cache()
+{
+    PROFILE_FUNCTION();
+    /* There is no cache on the first run. */
+    if (std::filesystem::exists(PIPELINE_CACHE_PATH)) pipeline_cache_data = read_file(PIPELINE_CACHE_PATH);
 }
 
 std::vector<char> Engine::read_file(const std::string &file_name)
@@ -659,32 +829,42 @@ VkShaderModule Engine::create_shader_module(const std::vector<char> &code)
     return shader_module;
 }
 
-void Engine::create_framebuffers()
+void Engine::create_pipeline_cache()
 {
-    swapchain_framebuffers.resize(swapchain_image_views.size());
-
-    for (size_t i{0}; i < swapchain_image_views.size(); i++)
-    {
-        VkImageView attachments[]{swapchain_image_views[i]};
+    PROFILE_FUNCTION();
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physical_device, &properties);
+    VkPipelineCacheHeaderVersionOne header{};
+    if (pipeline_cache_data.size() >= sizeof(header)) std::memcpy(&header, pipeline_cache_data.data(), sizeof(header));
+    /* Drivers should reject a cache from another device or driver version themselves, but not every one does. */
+    bool valid{header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE && header.vendorID == properties.vendorID && header.deviceID == properties.deviceID && std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0};
+
+    VkPipelineCacheCreateInfo create_info{
+        .sType{VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO},
+        // .pNext{},
+        // .flags{},
+        .initialDataSize{valid ? pipeline_cache_data.size() : 0},
+        .pInitialData{valid ? pipeline_cache_data.data() : nullptr},
+    };
 
-        VkFramebufferCreateInfo create_info{
-            .sType{VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO},
-            // .pNext{},
-            // .flags{},
-            .renderPass{render_pass},
-            .attachmentCount{1},
-            .pAttachments{attachments},
-            .width{swapchain_extent.width},
-            .height{swapchain_extent.height},
-            .layers{1},
-        };
+    CHECK(vkCreatePipelineCache(device, &create_info, nullptr, &pipeline_cache));
+    pipeline_cache_data.clear();
+}
 
-        CHECK(vkCreateFramebuffer(device, &create_info, nullptr, &swapchain_framebuffers[i]));
-    }
+void Engine::save_pipeline_cache()
+{
+    size_t size{0};
+    CHECK(vkGetPipelineCacheData(device, pipeline_cache, &size, nullptr));
+    std::vector<char> data(size);
+    CHECK(vkGetPipelineCacheData(device, pipeline_cache, &size, data.data()));
+    std::ofstream file(PIPELINE_CACHE_PATH, std::ios::binary);
+    /* The cache only saves time, so failing to write it is not an error. */
+    if (file.is_open()) file.write(data.data(), static_cast<std::streamsize>(size));
 }
 
 void Engine::create_command_pool()
 {
+    PROFILE_FUNCTION();
     Queue_Family_Index queue_family_index{find_queue_families(physical_device)};
 
     VkCommandPoolCreateInfo create_info{
@@ -697,7 +877,201 @@ void Engine::create_command_pool()
     CHECK(vkCreateCommandPool(device, &create_info, nullptr, &command_pool));
 }
 
-void Engine::create_command_buffer()
+void Engine::create_frame_ring()
+{
+    PROFILE_FUNCTION();
+    /* The tail keeps the fixed descriptor ranges inside the buffer for allocations at the very end of the last region. */
+    frame_ring.create(physical_device, device, FRAME_RING_SIZE, MAX_FRAMES_IN_FLIGHT, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, std::max(UNIFORM_RANGE, STORAGE_RANGE));
+}
+
+void Engine::create_descriptor_pool()
+{
+    PROFILE_FUNCTION();
+    VkDescriptorPoolSize pool_sizes[]{
+        {
+            .type{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC},
+            .descriptorCount{1},
+        },
+        {
+            .type{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC},
+            .descriptorCount{1},
+        },
+    };
+
+    VkDescriptorPoolCreateInfo create_info{
+        .sType{VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO},
+        // .pNext{},
+        // .flags{},
+        .maxSets{1},
+        .poolSizeCount{2},
+        .pPoolSizes{pool_sizes},
+    };
+
+    CHECK(vkCreateDescriptorPool(device, &create_info, nullptr, &descriptor_pool));
+}
+
+void Engine::create_descriptor_set()
+{
+    PROFILE_FUNCTION();
+    VkDescriptorSetAllocateInfo allocate_info{
+        .sType{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO},
+        // .pNext{},
+        .descriptorPool{descriptor_pool},
+        .descriptorSetCount{1},
+        .pSetLayouts{&descriptor_set_layout},
+    };
+
+    CHECK(vkAllocateDescriptorSets(device, &allocate_info, &descriptor_set));
+    /* This is the only time the set is written. Every frame and every draw reuses it with different dynamic offsets. */
+    VkDescriptorBufferInfo uniform_info{frame_ring.buffer(), 0, UNIFORM_RANGE};
+    VkDescriptorBufferInfo storage_info{frame_ring.buffer(), 0, STORAGE_RANGE};
+
+    VkWriteDescriptorSet writes[]{
+        {
+            .sType{VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET},
+            // .pNext{},
+            .dstSet{descriptor_set},
+            .dstBinding{0},
+            .dstArrayElement{0},
+            .descriptorCount{1},
+            .descriptorType{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC},
+            // .pImageInfo{},
+            .pBufferInfo{&uniform_info},
+            // .pTexelBufferView{},
+        },
+        {
+            .sType{VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET},
+            // .pNext{},
+            .dstSet{descriptor_set},
+            .dstBinding{1},
+            .dstArrayElement{0},
+            .descriptorCount{1},
+            .descriptorType{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC},
+            // .pImageInfo{},
+            .pBufferInfo{&storage_info},
+            // .pTexelBufferView{},
+        },
+    };
+
+    vkUpdateDescriptorSets(device, 2, writes, 0, nullptr);
+}
+
+void Engine::create_texture_streamer()
+{
+    PROFILE_FUNCTION();
+    texture_streamer.create(physical_device, device, &bindless, &thread_pool, &deletion_queue, VkDeviceSize{options.texture_budget} * 1024 * 1024, MAX_FRAMES_IN_FLIGHT);
+    sampler_cache.create(device, &bindless);
+    default_sampler = sampler_cache.get({VK_FILTER_LINEAR, VK_SAMPLER_MIPMAP_MODE_LINEAR, VK_SAMPLER_ADDRESS_MODE_REPEAT});
+    for (const auto &path : options.textures) textures.push_back(texture_streamer.load(path));
+}
+
+void Engine::create_sprite_batch()
+{
+    PROFILE_FUNCTION();
+    sprite_batch.create(physical_device, device, &deletion_queue, bindless.layout(), SPRITE_CAPACITY, MAX_FRAMES_IN_FLIGHT);
+    atlas.create(physical_device, device, &bindless, ATLAS_SIZE, ATLAS_STAGING_SIZE, MAX_FRAMES_IN_FLIGHT);
+    /* Regions sit side by side in the atlas, so sampling clamps, and there are no mipmaps to choose from. */
+    atlas_sampler = sampler_cache.get({VK_FILTER_LINEAR, VK_SAMPLER_MIPMAP_MODE_NEAREST, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE});
+    if (options.sprites == 0) return;
+    /* A disc, a ring, a diamond and a square, in white so that a sprite's color tints them, with edges that are smoothed over a texel */
+    constexpr uint32_t SHAPE_SIZE{32};
+    std::vector<uint8_t> texels(SHAPE_SIZE * SHAPE_SIZE * 4);
+
+    for (uint32_t shape{0}; shape < 4; shape++)
+    {
+        for (uint32_t y{0}; y < SHAPE_SIZE; y++)
+        {
+            for (uint32_t x{0}; x < SHAPE_SIZE; x++)
+            {
+                float u{(static_cast<float>(x) + 0.5f) / SHAPE_SIZE * 2.0f - 1.0f};
+                float v{(static_cast<float>(y) + 0.5f) / SHAPE_SIZE * 2.0f - 1.0f};
+                float length{std::sqrt(u * u + v * v)};
+                float distances[]{length, std::abs(length - 0.7f) / 0.3f, std::abs(u) + std::abs(v), std::max(std::abs(u), std::abs(v))};
+                float coverage{std::clamp((1.0f - distances[shape]) * SHAPE_SIZE * 0.5f, 0.0f, 1.0f)};
+                uint8_t *p_texel{&texels[(y * SHAPE_SIZE + x) * 4]};
+                p_texel[0] = p_texel[1] = p_texel[2] = 255;
+                p_texel[3] = static_cast<uint8_t>(coverage * 255.0f + 0.5f);
+            }
+        }
+
+        std::optional<Atlas::Region> region{atlas.add(SHAPE_SIZE, SHAPE_SIZE, texels.data())};
+        if (!region) throw std::runtime_error("The sprite shapes do not fit in the atlas.\n");
+        sprite_shapes.push_back(*region);
+    }
+}
+
+void Engine::create_particle_system()
+{
+    PROFILE_FUNCTION();
+    if (options.particles == 0) return;
+    particle_system.create(physical_device, device, &deletion_queue, &bindless, options.particles);
+}
+
+void Engine::create_meshes()
+{
+    PROFILE_FUNCTION();
+
+    for (const auto &data : mesh_data)
+    {
+        Mesh mesh{
+            .vertex_buffer{create_device_local_buffer(data.vertices.data(), data.vertices.size() * sizeof(Mesh_Vertex), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT)},
+            .index_count{static_cast<uint32_t>(data.indices.size())},
+            .index_type{data.wide_indices() ? VK_INDEX_TYPE_UINT32 : VK_INDEX_TYPE_UINT16},
+        };
+
+        /* 16-bit indices halve the index fetch whenever every vertex can be addressed that way. */
+        if (data.wide_indices())
+        {
+            mesh.index_buffer = create_device_local_buffer(data.indices.data(), data.indices.size() * sizeof(uint32_t), VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+        }
+        else
+        {
+            std::vector<uint16_t> indices(data.indices.begin(), data.indices.end());
+            mesh.index_buffer = create_device_local_buffer(indices.data(), indices.size() * sizeof(uint16_t), VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+        }
+
+        /* Each mesh is scaled uniformly to fit in the unit cube. */
+        float radius{std::max({data.position_scale[0], data.position_scale[1], data.position_scale[2]})};
+        for (uint32_t i{0}; i < 3; i++) mesh.position_scale[i] = data.position_scale[i] / radius;
+        meshes.push_back(mesh);
+    }
+
+    /* Only the device-local copies are kept. */
+    mesh_data.clear();
+}
+
+Mesh_Data Engine::load_mesh_data(const std::string &path)
+{
+    PROFILE_FUNCTION();
+    if (path.ends_with(".mesh")) return Mesh_Data::read(path);
+    /* Imports are cached next to their source, and redone when the source is newer. The settings are part of the name, so a cache is never read back with other settings than it was written with. */
+    std::string cache{path + (options.meshlets ? ".mesh" : ".no-meshlets.mesh")};
+    if (std::filesystem::exists(cache) && std::filesystem::last_write_time(cache) >= std::filesystem::last_write_time(path)) return Mesh_Data::read(cache);
+    Mesh_Data data{import_mesh(path, thread_pool, {.meshlets{options.meshlets}})};
+    data.write(cache);
+    return data;
+}
+
+Buffer Engine::create_device_local_buffer(const void *p_data, VkDeviceSize size, VkBufferUsageFlags usage)
+{
+    Buffer staging{create_buffer(physical_device, device, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)};
+    std::memcpy(staging.p_mapped, p_data, size);
+    Buffer buffer{create_buffer(physical_device, device, size, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)};
+    VkCommandBuffer command_buffer{begin_single_time_commands()};
+
+    VkBufferCopy region{
+        .srcOffset{0},
+        .dstOffset{0},
+        .size{size},
+    };
+
+    vkCmdCopyBuffer(command_buffer, staging.buffer, buffer.buffer, 1, &region);
+    end_single_time_commands(command_buffer);
+    destroy_buffer(device, staging);
+    return buffer;
+}
+
+VkCommandBuffer Engine::begin_single_time_commands()
 {
     VkCommandBufferAllocateInfo allocate_info{
         .sType{VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO},
@@ -707,11 +1081,61 @@ void Engine::create_command_buffer()
         .commandBufferCount{1},
     };
 
+    VkCommandBuffer command_buffer;
     CHECK(vkAllocateCommandBuffers(device, &allocate_info, &command_buffer));
+
+    VkCommandBufferBeginInfo begin_info{
+        .sType{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO},
+        // .pNext{},
+        .flags{VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT},
+        /* This is optional. */ .pInheritanceInfo{nullptr},
+    };
+
+    CHECK(vkBeginCommandBuffer(command_buffer, &begin_info));
+    return command_buffer;
+}
+
+/* This waits for the queue to go idle, which is only acceptable while initializing. */
+void Engine::end_single_time_commands(VkCommandBuffer command_buffer)
+{
+    CHECK(vkEndCommandBuffer(command_buffer));
+
+    VkSubmitInfo submit{
+        .sType{VK_STRUCTURE_TYPE_SUBMIT_INFO},
+        // .pNext{},
+        // .waitSemaphoreCount{},
+        // .pWaitSemaphores{},
+        // .pWaitDstStageMask{},
+        .commandBufferCount{1},
+        .pCommandBuffers{&command_buffer},
+        // .signalSemaphoreCount{},
+        // .pSignalSemaphores{},
+    };
+
+    CHECK(vkQueueSubmit(graphics_queue, 1, &submit, VK_NULL_HANDLE));
+    CHECK(vkQueueWaitIdle(graphics_queue));
+    vkFreeCommandBuffers(device, command_pool, 1, &command_buffer);
+}
+
+void Engine::create_command_buffers()
+{
+    PROFILE_FUNCTION();
+    VkCommandBufferAllocateInfo allocate_info{
+        .sType{VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO},
+        // .pNext{},
+        .commandPool{command_pool},
+        .level{VK_COMMAND_BUFFER_LEVEL_PRIMARY},
+        .commandBufferCount{MAX_FRAMES_IN_FLIGHT},
+    };
+
+    CHECK(vkAllocateCommandBuffers(device, &allocate_info, command_buffers));
+    allocate_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+    CHECK(vkAllocateCommandBuffers(device, &allocate_info, scene_command_buffers));
 }
 
-void Engine::create_sync_object()
+void Engine::create_sync_objects()
 {
+    PROFILE_FUNCTION();
     VkSemaphoreCreateInfo semaphore_create_info{
         .sType{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO},
         // .pNext{},
@@ -724,22 +1148,117 @@ void Engine::create_sync_object()
         .flags{VK_FENCE_CREATE_SIGNALED_BIT},
     };
 
-    CHECK(vkCreateSemaphore(device, &semaphore_create_info, nullptr, &image_available_semaphore));
-    CHECK(vkCreateSemaphore(device, &semaphore_create_info, nullptr, &render_finished_semaphore));
-    CHECK(vkCreateFence(device, &fence_create_info, nullptr, &in_flight_fence));
+    for (uint32_t i{0}; i < MAX_FRAMES_IN_FLIGHT; i++)
+    {
+        CHECK(vkCreateSemaphore(device, &semaphore_create_info, nullptr, &image_available_semaphores[i]));
+        CHECK(vkCreateFence(device, &fence_create_info, nullptr, &in_flight_fences[i]));
+    }
+
+    create_render_finished_semaphores();
+}
+
+void Engine::create_readback()
+{
+    PROFILE_FUNCTION();
+    /* Each frame in flight holds a buffer, and the rest give the writers time to catch up. */
+    readback.create(physical_device, device, &thread_pool, MAX_FRAMES_IN_FLIGHT, MAX_FRAMES_IN_FLIGHT + 2);
+    if (!options.capture.empty()) std::filesystem::create_directories(options.capture);
+}
+
+void Engine::create_dynamic_resolution()
+{
+    PROFILE_FUNCTION();
+    /* A frame's GPU time is read back when its slot is recorded again, and used for the frame after that. */
+    dynamic_resolution.create(static_cast<int64_t>(options.target_frame_time * 1e6), options.min_render_scale, MAX_FRAMES_IN_FLIGHT + 1);
+}
+
+void Engine::create_render_finished_semaphores()
+{
+    PROFILE_FUNCTION();
+    VkSemaphoreCreateInfo create_info{
+        .sType{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO},
+        // .pNext{},
+        // .flags{},
+    };
+
+    render_finished_semaphores.clear();
+
+    for (size_t i{0}; i < swapchain_images.size(); i++)
+    {
+        VkSemaphore semaphore;
+        CHECK(vkCreateSemaphore(device, &create_info, nullptr, &semaphore));
+        render_finished_semaphores.emplace_back(device, semaphore, &deletion_queue);
+    }
 }
 
 void Engine::draw()
 {
-    CHECK(vkWaitForFences(device, 1, &in_flight_fence, VK_TRUE, UINT64_MAX));
-    CHECK(vkResetFences(device, 1, &in_flight_fence));
+    PROFILE_FUNCTION();
+    uint64_t allocations_before{heap_allocations()};
+    int64_t draw_begin{Profiler::now()};
+
+    /* Low latency starts a frame once the previous one is on the display, so the CPU works from the latest input without frames queuing up. The wait is done once per present, even if this frame is tried again. */
+    if (p_wait_for_present != nullptr && last_present_id != 0 && presented_swapchain == swapchain.get())
+    {
+        PROFILE_ZONE("wait for present");
+        VkResult result{p_wait_for_present(device, swapchain, last_present_id, PRESENT_WAIT_TIMEOUT)};
+        if (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR) frame_pacing.presented(last_present_id, Profiler::now());
+        if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) swapchain_out_of_date = true;
+        /* A present that never completes, such as one to a hidden window, does not hold the program up. */
+        else if (result != VK_TIMEOUT) CHECK(result);
+        last_present_id = 0;
+    }
+
+    if (swapchain_out_of_date && !recreate_swapchain()) return;
+    VkCommandBuffer command_buffer{command_buffers[current_frame]};
+
+    {
+        PROFILE_ZONE("wait for fence");
+        CHECK(vkWaitForFences(device, 1, &in_flight_fences[current_frame], VK_TRUE, UINT64_MAX));
+
+        /* Without `VK_KHR_present_wait`, low latency waits for the previous frame's GPU work instead, so that at most one frame is in flight. */
+        if (options.present_mode == "low-latency" && p_wait_for_present == nullptr)
+        {
+            CHECK(vkWaitForFences(device, 1, &in_flight_fences[(current_frame + MAX_FRAMES_IN_FLIGHT - 1) % MAX_FRAMES_IN_FLIGHT], VK_TRUE, UINT64_MAX));
+        }
+    }
+
+    /* Present IDs start at one. */
+    uint64_t present_id{frame_number + 1};
+    frame_pacing.begin_frame(present_id, Profiler::now());
+
+    /* Whatever the frame `MAX_FRAMES_IN_FLIGHT` frames ago retired can be destroyed now. */
+    deletion_queue.begin_frame(frame_number);
+    Frame_Arena::begin_frame(frame_number);
+    readback.begin_frame(frame_number);
+    /* The GPU is done with this frame's region of the ring, so it can be written again. */
+    frame_ring.begin_frame(current_frame);
+    bindless.begin_frame(current_frame);
+    sprite_batch.begin_frame(current_frame);
     uint32_t image_index;
-    CHECK(vkAcquireNextImageKHR(device, swapchain, UINT64_MAX, image_available_semaphore, VK_NULL_HANDLE, &image_index));
+    VkResult result;
+
+    {
+        PROFILE_ZONE("acquire");
+        result = vkAcquireNextImageKHR(device, swapchain, UINT64_MAX, image_available_semaphores[current_frame], VK_NULL_HANDLE, &image_index);
+    }
+
+    /* Nothing has been submitted, so the fence is still signaled, and the frame is tried again with a new swapchain. */
+    if (result == VK_ERROR_OUT_OF_DATE_KHR)
+    {
+        swapchain_out_of_date = true;
+        return;
+    }
+
+    /* A suboptimal swapchain can still be presented to, so it is replaced after this frame. */
+    if (result == VK_SUBOPTIMAL_KHR) swapchain_out_of_date = true;
+    else CHECK(result);
+    CHECK(vkResetFences(device, 1, &in_flight_fences[current_frame]));
     CHECK(vkResetCommandBuffer(command_buffer, 0));
     record_command_buffer(command_buffer, image_index);
-    VkSemaphore wait_semaphores[]{image_available_semaphore};
+    VkSemaphore wait_semaphores[]{image_available_semaphores[current_frame]};
     VkPipelineStageFlags stage_mask[]{VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-    VkSemaphore signal_semaphores[]{render_finished_semaphore};
+    VkSemaphore signal_semaphores[]{render_finished_semaphores[image_index]};
 
     VkSubmitInfo submit{
         .sType{VK_STRUCTURE_TYPE_SUBMIT_INFO},
@@ -753,12 +1272,24 @@ void Engine::draw()
         .pSignalSemaphores{signal_semaphores},
     };
 
-    CHECK(vkQueueSubmit(graphics_queue, 1, &submit, in_flight_fence));
+    {
+        PROFILE_ZONE("submit");
+        gpu_profiler.submit();
+        CHECK(vkQueueSubmit(graphics_queue, 1, &submit, in_flight_fences[current_frame]));
+    }
+
     VkSwapchainKHR swapchains[]{swapchain};
 
+    VkPresentIdKHR present_id_info{
+        .sType{VK_STRUCTURE_TYPE_PRESENT_ID_KHR},
+        // .pNext{},
+        .swapchainCount{1},
+        .pPresentIds{&present_id},
+    };
+
     VkPresentInfoKHR present_info{
         .sType{VK_STRUCTURE_TYPE_PRESENT_INFO_KHR},
-        // .pNext{},
+        .pNext{p_wait_for_present != nullptr ? &present_id_info : nullptr},
         .waitSemaphoreCount{1},
         .pWaitSemaphores{signal_semaphores},
         .swapchainCount{1},
@@ -767,11 +1298,119 @@ void Engine::draw()
         /* This is optional. */ .pResults{nullptr},
     };
 
-    CHECK(vkQueuePresentKHR(present_queue, &present_info));
+    {
+        PROFILE_ZONE("present");
+        result = vkQueuePresentKHR(present_queue, &present_info);
+    }
+
+    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) swapchain_out_of_date = true;
+    else CHECK(result);
+
+    if (p_wait_for_present != nullptr)
+    {
+        last_present_id = present_id;
+        presented_swapchain = swapchain;
+    }
+    else
+    {
+        frame_pacing.presented(present_id, Profiler::now());
+    }
+
+    if (frame_number == 0)
+    {
+        int64_t now{Profiler::now()};
+        fprintf(stdout, "Initializing took %.1f ms, and the first frame was presented after %.1f ms.\n", static_cast<double>(initialize_end - initialize_begin) * 1e-6, static_cast<double>(now - initialize_begin) * 1e-6);
+    }
+
+    current_frame = (current_frame + 1) % MAX_FRAMES_IN_FLIGHT;
+    frame_number++;
+    if (options.benchmark > 0) end_benchmark_frame(allocations_before, draw_begin);
+}
+
+/* Allocations are counted on every thread, so jobs that the frame started count too, in builds with `COUNT_ALLOCATIONS`. */
+void Engine::end_benchmark_frame(uint64_t allocations_before, int64_t begin)
+{
+    if (frame_number <= BENCHMARK_WARMUP) return;
+    benchmark_allocations += heap_allocations() - allocations_before;
+    benchmark_time += Profiler::now() - begin;
+    if (frame_number < BENCHMARK_WARMUP + options.benchmark) return;
+    double frames{static_cast<double>(options.benchmark)};
+    fprintf(stdout, "Over %llu frames, a frame spent %.3f ms in `draw` on average. The frame arena peaked at %zu bytes.\n", static_cast<unsigned long long>(options.benchmark), static_cast<double>(benchmark_time) * 1e-6 / frames, Frame_Arena::get().peak());
+    if (HEAP_ALLOCATIONS_COUNTED) fprintf(stdout, "A frame made %.2f heap allocations on average.\n", static_cast<double>(benchmark_allocations) / frames);
+    else fprintf(stdout, "Heap allocations are only counted in builds with `COUNT_ALLOCATIONS`.\n");
+    app_result = SDL_APP_SUCCESS;
+}
+
+/* Nothing waits for the device here: the old swapchain, its views and semaphores, and the framebuffers made with them are all retired to the `Deletion_Queue`. */
+bool Engine::recreate_swapchain()
+{
+    PROFILE_FUNCTION();
+    VkExtent2D extent{choose_swapchain_extent(query_swapchain_support(physical_device).surface_capabilities)};
+    if (extent.width == 0 || extent.height == 0) return false;
+    VkFormat old_format{swapchain_image_format};
+    /* Reused scene command buffers are recorded again for the new extent. */
+    for (auto &recorded_scene : recorded_scenes) recorded_scene.reset();
+    /* Framebuffers are cached by view, so they go before the views that they refer to. */
+    render_graph.release_framebuffers();
+    swapchain_image_views.clear();
+    create_swapchain();
+    create_image_views();
+    /* The image count may have changed. */
+    create_render_finished_semaphores();
+    /* Pipelines are made against the swapchain format. */
+    if (swapchain_image_format != old_format) create_graphics_pipeline();
+    swapchain_out_of_date = false;
+    return true;
 }
 
 void Engine::record_command_buffer(VkCommandBuffer command_buffer, uint32_t image_index)
 {
+    PROFILE_FUNCTION();
+    Uint64 ticks{SDL_GetTicksNS()};
+    /* A golden image is compared at a given frame, so time advances by a fixed step per frame instead of with the clock. */
+    if (!options.golden.empty()) ticks = frame_number * 1'000'000'000 / 60;
+    if (last_ticks == 0) last_ticks = ticks;
+    /* The scene is rendered into the top left of full-size targets, so that their memory stays the same as the scale changes, and then upscaled to the swapchain. */
+    VkExtent2D render_extent{swapchain_extent};
+
+    if (options.target_frame_time > 0.0)
+    {
+        float scale{dynamic_resolution.update(gpu_profiler.frame_time())};
+        render_extent.width = std::max(1u, static_cast<uint32_t>(static_cast<float>(swapchain_extent.width) * scale + 0.5f));
+        render_extent.height = std::max(1u, static_cast<uint32_t>(static_cast<float>(swapchain_extent.height) * scale + 0.5f));
+    }
+
+    Frame_Uniforms frame_uniforms{
+        .extent{static_cast<float>(render_extent.width), static_cast<float>(render_extent.height)},
+        .time{static_cast<float>(static_cast<double>(ticks) * 1e-9)},
+        .delta_time{static_cast<float>(ticks - last_ticks) * 1e-9f},
+    };
+
+    last_ticks = ticks;
+    /* Per-frame data is written straight into mapped memory; only the offsets below change between frames. */
+    Frame_Ring::Allocation frame_allocation{frame_ring.push(frame_uniforms)};
+    /* Object `0` is the triangle and object `i + 1` is `meshes[i]`. */
+    Frame_Ring::Allocation object_allocation{frame_ring.allocate(sizeof(Object) * (1 + meshes.size()))};
+    Object *p_objects{static_cast<Object *>(object_allocation.p_data)};
+    p_objects[0] = {.tint{1.0f, 1.0f, 1.0f, 1.0f}};
+
+    for (size_t i{0}; i < meshes.size(); i++)
+    {
+        const float *p_scale{meshes[i].position_scale};
+        p_objects[i + 1] = {.tint{1.0f, 1.0f, 1.0f, 1.0f}, .position_scale{p_scale[0], p_scale[1], p_scale[2], 0.0f}};
+    }
+
+    Push_Constants push_constants{
+        .offset{0.0f, 0.0f},
+        .scale{1.0f},
+        .object{0},
+        .texture_index{Bindless::INVALID},
+        .sampler_index{default_sampler},
+    };
+
+    /* The triangle spans about half of the window's height. */
+    if (!textures.empty()) texture_streamer.request(textures[0], 0.5f * push_constants.scale * render_extent.height);
+
     VkCommandBufferBeginInfo begin_info{
         .sType{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO},
         // .pNext{},
@@ -780,75 +1419,457 @@ void Engine::record_command_buffer(VkCommandBuffer command_buffer, uint32_t imag
     };
 
     CHECK(vkBeginCommandBuffer(command_buffer, &begin_info));
+    gpu_profiler.begin_frame(command_buffer, current_frame);
+    gpu_profiler.begin_zone(command_buffer, "frame");
+    render_graph.begin();
+
+    /* The acquire semaphore is waited on at the color attachment output stage, so the first barrier chains to it. */
+    Render_Graph::Resource swapchain_image{render_graph.import_image(
+        "swapchain", swapchain_images[image_index], swapchain_image_views[image_index], swapchain_image_format, swapchain_extent,
+        {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0, VK_IMAGE_LAYOUT_UNDEFINED},
+        {VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR})};
+
+    Render_Graph::Resource depth_image{render_graph.create_image("depth", depth_format, swapchain_extent)};
+    Render_Graph::Resource scene_image{swapchain_image};
+    if (options.target_frame_time > 0.0) scene_image = render_graph.create_image("scene", swapchain_image_format, swapchain_extent);
+
+    /* Uploads and residency changes must happen outside of a render pass, and the streamer makes its own barriers. */
+    Render_Graph::Pass upload_pass{render_graph.add_pass("texture upload", Render_Graph::Queue::GRAPHICS, [&](VkCommandBuffer command_buffer) {
+        texture_streamer.update(command_buffer, current_frame);
+        atlas.update(command_buffer, current_frame);
+        /* Handles change with residency, so they are only read after the update. */
+        if (!textures.empty()) push_constants.texture_index = texture_streamer.handle(textures[0]);
+    })};
+
+    render_graph.keep(upload_pass);
+
+    /* The pipelines depend on the texture too, so they are chosen in the pass. */
+    Scene_State scene{
+        .graphics_pipeline{VK_NULL_HANDLE},
+        .mesh_pipeline{VK_NULL_HANDLE},
+        .render_pass{VK_NULL_HANDLE},
+        .extent{render_extent},
+        .dynamic_offsets{static_cast<uint32_t>(frame_allocation.offset), static_cast<uint32_t>(object_allocation.offset)},
+        .push_constants{},
+    };
 
-    {
-        VkClearValue clear_value{{{
-            0.0f,
-            0.0f,
-            0.0f,
-            1.0f,
-        }}};
+    Render_Graph::Pass scene_pass{render_graph.add_pass("scene", Render_Graph::Queue::GRAPHICS, [&](VkCommandBuffer command_buffer) {
+        /* The texture's handle is only known after the upload pass. */
+        scene.push_constants = push_constants;
+        bool textured{push_constants.texture_index != Bindless::INVALID};
+        scene.graphics_pipeline = scene_pipeline(triangle_key, textured);
+        scene.mesh_pipeline = scene_pipeline(mesh_key, textured);
 
-        VkRenderPassBeginInfo render_pass_begin{
-            .sType{VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO},
-            // .pNext{},
-            .renderPass{render_pass},
-            .framebuffer{swapchain_framebuffers[image_index]},
-            .renderArea{
-                .offset{0, 0},
-                .extent{swapchain_extent},
-            },
-            .clearValueCount{1},
-            .pClearValues{&clear_value},
-        };
+        if (!options.reuse_command_buffers)
+        {
+            record_scene(command_buffer, scene);
+            return;
+        }
 
-        vkCmdBeginRenderPass(command_buffer, &render_pass_begin, VK_SUBPASS_CONTENTS_INLINE);
+        /* Offsets into the ring repeat from frame to frame, since its regions are allocated in the same order every time, so a frame slot's draws rarely change. */
+        scene.render_pass = render_graph.render_pass(scene_pass);
+        VkCommandBuffer scene_command_buffer{scene_command_buffers[current_frame]};
 
+        if (recorded_scenes[current_frame] != scene)
         {
-            vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphics_pipeline);
-
-            VkViewport viewport{
-                .x{0.0f},
-                .y{0.0f},
-                .width{static_cast<float>(swapchain_extent.width)},
-                .height{static_cast<float>(swapchain_extent.height)},
-                .minDepth{0.0f},
-                .maxDepth{1.0f},
+            PROFILE_ZONE("record scene");
+
+            VkCommandBufferInheritanceInfo inheritance_info{
+                .sType{VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO},
+                // .pNext{},
+                .renderPass{scene.render_pass},
+                .subpass{0},
+                /* This is optional. */ .framebuffer{VK_NULL_HANDLE},
+                // .occlusionQueryEnable{},
+                // .queryFlags{},
+                // .pipelineStatistics{},
             };
 
-            vkCmdSetViewport(command_buffer, 0, 1, &viewport);
-
-            VkRect2D scissor{
-                .offset{0, 0},
-                .extent{swapchain_extent},
+            VkCommandBufferBeginInfo begin_info{
+                .sType{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO},
+                // .pNext{},
+                .flags{VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT},
+                .pInheritanceInfo{&inheritance_info},
             };
 
-            vkCmdSetScissor(command_buffer, 0, 1, &scissor);
-            vkCmdDraw(command_buffer, 3, 1, 0, 0);
+            /* The slot's fence has been waited on, so the GPU is done with the old recording. */
+            CHECK(vkBeginCommandBuffer(scene_command_buffer, &begin_info));
+            record_scene(scene_command_buffer, scene);
+            CHECK(vkEndCommandBuffer(scene_command_buffer));
+            recorded_scenes[current_frame] = scene;
         }
 
-        vkCmdEndRenderPass(command_buffer);
+        vkCmdExecuteCommands(command_buffer, 1, &scene_command_buffer);
+    })};
+
+    if (options.reuse_command_buffers) render_graph.use_secondary(scene_pass);
+
+    VkClearValue clear_color{};
+    clear_color.color = {{0.0f, 0.0f, 0.0f, 1.0f}};
+    VkClearValue clear_depth{};
+    clear_depth.depthStencil = {1.0f, 0};
+    render_graph.write(scene_pass, scene_image, Render_Graph::Access::COLOR_ATTACHMENT, clear_color);
+    render_graph.write(scene_pass, depth_image, Render_Graph::Access::DEPTH_ATTACHMENT, clear_depth);
+
+    /* Particles are simulated after the scene is drawn, and drawn over it at the same resolution, tested against its depth. */
+    if (options.particles > 0)
+    {
+        particle_system.begin_frame(frame_uniforms.delta_time, frame_uniforms.time);
+        /* The buffers outlive the frame, and the last frame's passes are what the first barriers wait for. */
+        Render_Graph::State particle_state{VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED};
+        Render_Graph::Resource source{render_graph.import_buffer("particle source", particle_system.source(), particle_state, particle_state)};
+        Render_Graph::Resource destination{render_graph.import_buffer("particle destination", particle_system.destination(), particle_state, particle_state)};
+        Render_Graph::Resource keys{render_graph.import_buffer("particle keys", particle_system.keys(), particle_state, particle_state)};
+        Render_Graph::Resource state{render_graph.import_buffer("particle state", particle_system.state(), particle_state, particle_state)};
+
+        Render_Graph::Pass simulate_pass{render_graph.add_pass("particle simulate", Render_Graph::Queue::COMPUTE, [&](VkCommandBuffer command_buffer) {
+            particle_system.simulate(command_buffer, bindless.set());
+        })};
+
+        render_graph.read(simulate_pass, state, Render_Graph::Access::INDIRECT);
+        render_graph.read(simulate_pass, source, Render_Graph::Access::STORAGE);
+        render_graph.write(simulate_pass, destination, Render_Graph::Access::STORAGE);
+        render_graph.write(simulate_pass, keys, Render_Graph::Access::STORAGE);
+        render_graph.write(simulate_pass, state, Render_Graph::Access::STORAGE);
+
+        Render_Graph::Pass emit_pass{render_graph.add_pass("particle emit", Render_Graph::Queue::COMPUTE, [&](VkCommandBuffer command_buffer) {
+            particle_system.emit(command_buffer, bindless.set());
+        })};
+
+        render_graph.write(emit_pass, destination, Render_Graph::Access::STORAGE);
+        render_graph.write(emit_pass, keys, Render_Graph::Access::STORAGE);
+        render_graph.write(emit_pass, state, Render_Graph::Access::STORAGE);
+
+        Render_Graph::Pass finish_pass{render_graph.add_pass("particle finish", Render_Graph::Queue::COMPUTE, [&](VkCommandBuffer command_buffer) {
+            particle_system.finish(command_buffer, bindless.set());
+        })};
+
+        render_graph.write(finish_pass, state, Render_Graph::Access::STORAGE);
+
+        Render_Graph::Pass sort_pass{render_graph.add_pass("particle sort", Render_Graph::Queue::COMPUTE, [&](VkCommandBuffer command_buffer) {
+            particle_system.sort(command_buffer, bindless.set());
+        })};
+
+        render_graph.read(sort_pass, state, Render_Graph::Access::INDIRECT);
+        render_graph.read(sort_pass, state, Render_Graph::Access::STORAGE);
+        render_graph.write(sort_pass, keys, Render_Graph::Access::STORAGE);
+
+        Render_Graph::Pass draw_pass{render_graph.add_pass("particle draw", Render_Graph::Queue::GRAPHICS, [&](VkCommandBuffer command_buffer) {
+            particle_system.draw(command_buffer, bindless.set(), render_extent);
+        })};
+
+        render_graph.read(draw_pass, state, Render_Graph::Access::INDIRECT);
+        render_graph.read(draw_pass, keys, Render_Graph::Access::STORAGE);
+        render_graph.read(draw_pass, destination, Render_Graph::Access::STORAGE);
+        render_graph.write(draw_pass, scene_image, Render_Graph::Access::COLOR_ATTACHMENT);
+        /* The pipeline does not write depth, but the graph's render passes keep the depth attachment's layout writable. */
+        render_graph.write(draw_pass, depth_image, Render_Graph::Access::DEPTH_ATTACHMENT);
+    }
+
+    if (scene_image != swapchain_image)
+    {
+        Render_Graph::Pass upscale_pass{render_graph.add_pass("upscale", Render_Graph::Queue::GRAPHICS, [&](VkCommandBuffer command_buffer) {
+            VkImageBlit region{
+                .srcSubresource{
+                    .aspectMask{VK_IMAGE_ASPECT_COLOR_BIT},
+                    .mipLevel{0},
+                    .baseArrayLayer{0},
+                    .layerCount{1},
+                },
+                .srcOffsets{{0, 0, 0}, {static_cast<int32_t>(render_extent.width), static_cast<int32_t>(render_extent.height), 1}},
+                .dstSubresource{
+                    .aspectMask{VK_IMAGE_ASPECT_COLOR_BIT},
+                    .mipLevel{0},
+                    .baseArrayLayer{0},
+                    .layerCount{1},
+                },
+                .dstOffsets{{0, 0, 0}, {static_cast<int32_t>(swapchain_extent.width), static_cast<int32_t>(swapchain_extent.height), 1}},
+            };
+
+            vkCmdBlitImage(command_buffer, render_graph.image(scene_image), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, swapchain_images[image_index], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region, upscale_filter);
+        })};
+
+        render_graph.read(upscale_pass, scene_image, Render_Graph::Access::TRANSFER);
+        render_graph.write(upscale_pass, swapchain_image, Render_Graph::Access::TRANSFER);
+    }
+
+    if (options.sprites > 0) queue_sprites(frame_uniforms.time);
+
+    /* Sprites are drawn over the upscaled frame, at the swapchain's resolution, so that text stays sharp at any render scale. */
+    if (sprite_batch.size() > 0)
+    {
+        Render_Graph::Pass sprite_pass{render_graph.add_pass("sprites", Render_Graph::Queue::GRAPHICS, [&](VkCommandBuffer command_buffer) {
+            sprite_batch.record(command_buffer, bindless.set(), swapchain_extent);
+        })};
+
+        render_graph.write(sprite_pass, swapchain_image, Render_Graph::Access::COLOR_ATTACHMENT);
     }
 
+    Readback::Callback capture{capture_callback()};
+
+    /* The copy reads the finished frame, and the graph moves the image on to presentation afterwards. */
+    if (capture)
+    {
+        Render_Graph::Pass capture_pass{render_graph.add_pass("capture", Render_Graph::Queue::GRAPHICS, [&](VkCommandBuffer command_buffer) {
+            readback.copy(command_buffer, swapchain_images[image_index], swapchain_image_format, swapchain_extent, std::move(capture));
+        })};
+
+        render_graph.read(capture_pass, swapchain_image, Render_Graph::Access::TRANSFER);
+        render_graph.keep(capture_pass);
+    }
+
+    render_graph.compile();
+    render_graph.execute(command_buffer, &gpu_profiler);
+    gpu_profiler.end_zone(command_buffer);
     CHECK(vkEndCommandBuffer(command_buffer));
 }
 
+/* Draws without a texture use a variant that never reads one, once it is compiled. Until then, the base permutation checks the handle as it draws, and a reused recording changes with the pipeline when the variant is ready. */
+VkPipeline Engine::scene_pipeline(const Pipeline_Key &key, bool textured)
+{
+    Pipeline_Key variant{key};
+    variant.constants[0] = textured ? VK_TRUE : VK_FALSE;
+    return pipeline_library.get(variant, key);
+}
+
+/* The draws of the scene pass, inline or into a reused secondary command buffer */
+void Engine::record_scene(VkCommandBuffer command_buffer, const Scene_State &scene)
+{
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, scene.graphics_pipeline);
+    VkDescriptorSet descriptor_sets[]{descriptor_set, bindless.set()};
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 0, 2, descriptor_sets, 2, scene.dynamic_offsets);
+    vkCmdPushConstants(command_buffer, pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(Push_Constants), &scene.push_constants);
+
+    VkViewport viewport{
+        .x{0.0f},
+        .y{0.0f},
+        .width{static_cast<float>(scene.extent.width)},
+        .height{static_cast<float>(scene.extent.height)},
+        .minDepth{0.0f},
+        .maxDepth{1.0f},
+    };
+
+    vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+
+    VkRect2D scissor{
+        .offset{0, 0},
+        .extent{scene.extent},
+    };
+
+    vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+    vkCmdDraw(command_buffer, 3, 1, 0, 0);
+    if (meshes.empty()) return;
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, scene.mesh_pipeline);
+    /* Meshes are laid out side by side across the window. */
+    float width{2.0f / static_cast<float>(meshes.size())};
+
+    for (size_t i{0}; i < meshes.size(); i++)
+    {
+        Push_Constants mesh_push_constants{scene.push_constants};
+        mesh_push_constants.offset[0] = -1.0f + width * (static_cast<float>(i) + 0.5f);
+        mesh_push_constants.scale = std::min(0.8f, 0.4f * width * scene.extent.width / scene.extent.height);
+        mesh_push_constants.object = static_cast<uint32_t>(i + 1);
+        vkCmdPushConstants(command_buffer, pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(Push_Constants), &mesh_push_constants);
+        VkDeviceSize offset{0};
+        vkCmdBindVertexBuffers(command_buffer, 0, 1, &meshes[i].vertex_buffer.buffer, &offset);
+        vkCmdBindIndexBuffer(command_buffer, meshes[i].index_buffer.buffer, 0, meshes[i].index_type);
+        vkCmdDrawIndexed(command_buffer, meshes[i].index_count, 1, 0, 0, 0);
+    }
+}
+
+/* `--sprites` fills the window with a grid of pulsing shapes and plain quads, as a stand-in for a dashboard. Every fifth sprite is additive, in a layer above the rest, so a frame has two batches. */
+void Engine::queue_sprites(float time)
+{
+    float cell{std::sqrt(static_cast<float>(swapchain_extent.width) * static_cast<float>(swapchain_extent.height) / static_cast<float>(options.sprites))};
+    uint32_t columns{std::max(1u, static_cast<uint32_t>(static_cast<float>(swapchain_extent.width) / cell))};
+
+    auto pack{[](float r, float g, float b, float a) {
+        auto channel{[](float c) { return static_cast<uint32_t>(std::clamp(c, 0.0f, 1.0f) * 255.0f + 0.5f); }};
+        return channel(r) | channel(g) << 8 | channel(b) << 16 | channel(a) << 24;
+    }};
+
+    for (uint32_t i{0}; i < options.sprites; i++)
+    {
+        float phase{static_cast<float>(i) * 0.1f};
+        float size{cell * (0.6f + 0.3f * std::sin(time * 2.0f + phase))};
+        float x{static_cast<float>(i % columns) * cell + (cell - size) * 0.5f};
+        float y{static_cast<float>(i / columns) * cell + (cell - size) * 0.5f};
+        bool additive{i % 5 == 0};
+        bool plain{i % 4 == 3};
+        const Atlas::Region &shape{sprite_shapes[i % sprite_shapes.size()]};
+
+        sprite_batch.add({
+            .rect{x, y, size, size},
+            .uv{shape.uv[0], shape.uv[1], shape.uv[2], shape.uv[3]},
+            .color{pack(0.5f + 0.5f * std::sin(phase), 0.5f + 0.5f * std::sin(phase + 2.1f), 0.5f + 0.5f * std::sin(phase + 4.2f), additive ? 0.5f : 0.9f)},
+            .texture{plain ? Bindless::INVALID : atlas.handle()},
+            .sampler{atlas_sampler},
+            .layer{static_cast<uint16_t>(additive ? 1 : 0)},
+            .blend{additive ? Sprite_Batch::Blend::ADDITIVE : Sprite_Batch::Blend::ALPHA},
+        });
+    }
+}
+
+/* This returns the callbacks for the frame being recorded, or an empty callback when nothing reads it back. */
+Readback::Callback Engine::capture_callback()
+{
+    if (!swapchain_capturable) return {};
+    std::vector<Readback::Callback> callbacks;
+    /* Streamed frames are dropped by `Readback` when every buffer is busy, and counted there, but screenshots and the golden frame wait for a free one. */
+    bool available{readback.available()};
+
+    if (screenshot_requested && available)
+    {
+        screenshot_requested = false;
+
+        callbacks.push_back([](const Readback::Image &image) {
+            std::string path{"screenshot_" + std::to_string(image.frame) + ".png"};
+            write_png(path, to_rgb(image));
+            fprintf(stdout, "The screenshot was written to `%s`.\n", path.c_str());
+        });
+    }
+
+    if (!options.capture.empty())
+    {
+        callbacks.push_back([this](const Readback::Image &image) {
+            char name[32];
+            snprintf(name, sizeof(name), "frame_%06llu.", static_cast<unsigned long long>(image.frame));
+            std::string path{options.capture + "/" + name + options.capture_format};
+            if (options.capture_format == "raw") write_raw(path, image);
+            else if (options.capture_format == "ppm") write_ppm(path, to_rgb(image));
+            else write_png(path, to_rgb(image));
+        });
+    }
+
+    if (!options.golden.empty() && !golden_recorded && frame_number >= options.golden_frame && available)
+    {
+        golden_recorded = true;
+
+        callbacks.push_back([this](const Readback::Image &image) {
+            try
+            {
+                Rgb_Image frame{to_rgb(image)};
+
+                if (!std::filesystem::exists(options.golden))
+                {
+                    write_ppm(options.golden, frame);
+                    fprintf(stdout, "There was no golden image, so frame %llu was written to `%s`.\n", static_cast<unsigned long long>(image.frame), options.golden.c_str());
+                    app_result = SDL_APP_SUCCESS;
+                    return;
+                }
+
+                Image_Difference difference{compare(frame, read_ppm(options.golden))};
+                bool passed{difference.max_difference <= options.golden_tolerance};
+                fprintf(passed ? stdout : stderr, "Frame %llu %s `%s`: %llu texels differ, by at most %u.\n", static_cast<unsigned long long>(image.frame), passed ? "matches" : "does not match", options.golden.c_str(), static_cast<unsigned long long>(difference.differing_texels), difference.max_difference);
+                app_result = passed ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+            }
+            catch (const std::exception &exception)
+            {
+                fprintf(stderr, "%s", exception.what());
+                app_result = SDL_APP_FAILURE;
+            }
+        });
+    }
+
+    if (callbacks.empty()) return {};
+    if (callbacks.size() == 1) return std::move(callbacks[0]);
+
+    return [callbacks = std::move(callbacks)](const Readback::Image &image) {
+        for (const auto &callback : callbacks) callback(image);
+    };
+}
+
 void Engine::event(SDL_Event *p_event)
 {
+    switch (p_event->type)
+    {
+    case SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED:
+        swapchain_out_of_date = true;
+        break;
+    case SDL_EVENT_KEY_DOWN:
+        if (p_event->key.repeat) break;
+
+        /* Shaders are reloaded from `bin`, and a failed reload keeps the pipelines that there are. */
+        if (p_event->key.key == SDLK_F5)
+        {
+            try
+            {
+                read_shaders();
+                create_graphics_pipeline();
+            }
+            catch (const std::exception &exception)
+            {
+                fprintf(stderr, "%s", exception.what());
+            }
+        }
+
+        if (p_event->key.key == SDLK_F11) screenshot_requested = true;
+        if (p_event->key.key == SDLK_F12) write_trace();
+        break;
+    }
+}
+
+void Engine::write_trace()
+{
+    std::string path{options.trace.empty() ? "trace.json" : options.trace};
+
+    try
+    {
+        Profiler::write_trace(path);
+        fprintf(stdout, "The trace was written to `%s`.\n", path.c_str());
+    }
+    catch (const std::exception &exception)
+    {
+        fprintf(stderr, "%s", exception.what());
+    }
 }
 
 void Engine::clean()
 {
-    vkDestroySemaphore(device, image_available_semaphore, nullptr);
-    vkDestroySemaphore(device, render_finished_semaphore, nullptr);
-    vkDestroyFence(device, in_flight_fence, nullptr);
+    frame_pacing.report(p_wait_for_present != nullptr);
+    /* Its callbacks run on the pool, and the device is idle, so the last frames' copies are complete. */
+    readback.destroy();
+    if (readback.dropped() > 0) fprintf(stderr, "%llu frames were dropped from the capture.\n", static_cast<unsigned long long>(readback.dropped()));
+    /* Workers may still be reading into the streamer. */
+    thread_pool.stop();
+    if (!options.trace.empty()) write_trace();
+    render_finished_semaphores.clear();
+
+    for (uint32_t i{0}; i < MAX_FRAMES_IN_FLIGHT; i++)
+    {
+        vkDestroySemaphore(device, image_available_semaphores[i], nullptr);
+        vkDestroyFence(device, in_flight_fences[i], nullptr);
+    }
+
+    for (auto &mesh : meshes)
+    {
+        destroy_buffer(device, mesh.index_buffer);
+        destroy_buffer(device, mesh.vertex_buffer);
+    }
+
+    if (sprite_batch.dropped() > 0) fprintf(stderr, "%llu sprites were dropped past the sprite batch's capacity.\n", static_cast<unsigned long long>(sprite_batch.dropped()));
+    sprite_batch.destroy();
+    atlas.destroy();
+    if (options.particles > 0) particle_system.destroy();
+    sampler_cache.destroy();
+    texture_streamer.destroy();
+    /* Descriptor sets are freed when their pool is destroyed. */
+    vkDestroyDescriptorPool(device, descriptor_pool, nullptr);
+    frame_ring.destroy(device);
+    gpu_profiler.destroy();
     vkDestroyCommandPool(device, command_pool, nullptr);
-    for (const auto &framebuffer : swapchain_framebuffers) vkDestroyFramebuffer(device, framebuffer, nullptr);
-    vkDestroyPipeline(device, graphics_pipeline, nullptr);
-    vkDestroyPipelineLayout(device, pipeline_layout, nullptr);
-    vkDestroyRenderPass(device, render_pass, nullptr);
-    for (const auto &image_view : swapchain_image_views) vkDestroyImageView(device, image_view, nullptr);
-    vkDestroySwapchainKHR(device, swapchain, nullptr);
+    /* Compiles that are still queued run here, since the workers have stopped. */
+    pipeline_library.destroy();
+    pipeline_layout.reset();
+    save_pipeline_cache();
+    vkDestroyPipelineCache(device, pipeline_cache, nullptr);
+    bindless.destroy(device);
+    vkDestroyDescriptorSetLayout(device, descriptor_set_layout, nullptr);
+    render_graph.destroy();
+    swapchain_image_views.clear();
+    swapchain.reset();
+    /* The device is idle, so everything that was retired, including the handles above, can be destroyed in the order it was retired. */
+    deletion_queue.flush();
     /* Device queues are destroyed when the device is destroyed. */
     vkDestroyDevice(device, nullptr);
     vkDestroySurfaceKHR(instance, surface, nullptr);
@@ -1,5 +1,9 @@
 #pragma once
 
+/*
+    - `std::atomic` [[.](https://en.cppreference.com/w/cpp/atomic/atomic.html)]
+*/
+#include <atomic>
 /*
     - `std::clamp` [[.](https://en.cppreference.com/w/cpp/algorithm/clamp.html)]
 */
@@ -8,6 +12,10 @@
     - `std::ifstream` [[.](https://en.cppreference.com/w/cpp/io/basic_ifstream.html)]
 */
 #include <fstream>
+/*
+    - `std::map` [[.](https://en.cppreference.com/w/cpp/container/map.html)]
+*/
+#include <map>
 /*
     - `std::optional` [[.](https://en.cppreference.com/w/cpp/utility/optional.html)]
 */
@@ -16,6 +24,10 @@
     - `std::set` [[.](https://en.cppreference.com/w/cpp/container/set.html)]
 */
 #include <set>
+/*
+    - `std::span` [[.](https://en.cppreference.com/w/cpp/container/span.html)]
+*/
+#include <span>
 /*
     - `std::runtime_error` [[.](https://en.cppreference.com/w/cpp/error/runtime_error.html)]
 */
@@ -28,14 +40,33 @@
 #include <SDL3/SDL.h>
 #include <SDL3/SDL_vulkan.h>
 
+#include "arena.hpp"
+#include "atlas.hpp"
+#include "bindless.hpp"
+#include "buffer.hpp"
 #include "common.hpp"
+#include "deletion_queue.hpp"
+#include "dynamic_resolution.hpp"
+#include "frame_pacing.hpp"
+#include "frame_ring.hpp"
+#include "mesh.hpp"
+#include "options.hpp"
+#include "particles.hpp"
+#include "pipeline_library.hpp"
+#include "profiler.hpp"
+#include "readback.hpp"
+#include "render_graph.hpp"
+#include "sprite_batch.hpp"
+#include "task_graph.hpp"
+#include "texture.hpp"
+#include "thread_pool.hpp"
 
 class Engine
 {
     public:
     /* These are are ordered by call. */
 
-    void initialize();
+    void initialize(const Options &);
     void draw();
     void event(SDL_Event *p_event);
     void clean();
@@ -46,7 +77,13 @@ class Engine
         CHECK(vkDeviceWaitIdle(device));
     }
 
+    /* This is `SDL_APP_CONTINUE` until a golden image has been compared, or a benchmark has finished. */
+    SDL_AppResult result() const { return app_result; }
+
     private:
+    static constexpr uint32_t MAX_FRAMES_IN_FLIGHT{2};
+    static_assert(Frame_Arena::FRAME_COUNT == MAX_FRAMES_IN_FLIGHT);
+
     struct Queue_Family_Index
     {
         std::optional<uint32_t> graphics_family;
@@ -54,6 +91,7 @@ class Engine
         bool completed() { return graphics_family.has_value() && present_family.has_value(); }
     };
 
+    /* This is queried on resize, outside of frames, so it stays on the heap; the frame arena is only reset as frames advance, which they do not while the window is minimized. */
     struct Swapchain_Support
     {
         VkSurfaceCapabilitiesKHR surface_capabilities;
@@ -61,10 +99,72 @@ class Engine
         std::vector<VkSurfaceFormatKHR> surface_formats;
     };
 
+    /* These mirror the blocks declared in `triangle.vert`, `triangle.frag`, `mesh.vert` and `mesh.frag`. */
+
+    /* `std140`, bound once per frame through `set = 0, binding = 0` */
+    struct Frame_Uniforms
+    {
+        float extent[2];
+        float time;
+        float delta_time;
+    };
+
+    /* `std430`, an array bound through `set = 0, binding = 1` */
+    struct Object
+    {
+        float tint[4];
+        /* `mesh.vert` dequantizes positions with this; meshes are centered on their bounds. */
+        float position_scale[4];
+    };
+
+    /* `std430`, at most 128 bytes, which is the minimum `maxPushConstantsSize` */
+    struct Push_Constants
+    {
+        float offset[2];
+        float scale;
+        uint32_t object;
+        /* These index the `Bindless` arrays, or are `Bindless::INVALID`. */
+        uint32_t texture_index;
+        uint32_t sampler_index;
+        bool operator==(const Push_Constants &) const = default;
+    };
+
+    /* A `Mesh_Data` in device-local memory */
+    struct Mesh
+    {
+        Buffer vertex_buffer;
+        Buffer index_buffer;
+        uint32_t index_count;
+        VkIndexType index_type;
+        float position_scale[3];
+    };
+
+    /* What the scene's draws are recorded from; a reused recording is replayed while this stays the same. */
+    struct Scene_State
+    {
+        VkPipeline graphics_pipeline;
+        VkPipeline mesh_pipeline;
+        VkRenderPass render_pass;
+        VkExtent2D extent;
+        uint32_t dynamic_offsets[2];
+        Push_Constants push_constants;
+
+        bool operator==(const Scene_State &other) const
+        {
+            return graphics_pipeline == other.graphics_pipeline && mesh_pipeline == other.mesh_pipeline && render_pass == other.render_pass && extent.width == other.extent.width && extent.height == other.extent.height && dynamic_offsets[0] == other.dynamic_offsets[0] && dynamic_offsets[1] == other.dynamic_offsets[1] && push_constants == other.push_constants;
+        }
+    };
+
     /* The sections below are ordered by call, except where noted. */
 
     /* # `initialize` # */
 
+    Options options;
+    /* `draw` reports the time to the first present from these. */
+    int64_t initialize_begin{0};
+    int64_t initialize_end{0};
+    void create_thread_pool();
+    /* * */ Thread_Pool thread_pool;
     void create_window();
     /* * */ SDL_Window *p_window{nullptr};
     /* * */ VkExtent2D window_extent{512 * 2, 342 * 2};
@@ -76,6 +176,7 @@ class Engine
     /* * */ const bool validation_layers_enabled{true};
 #endif
     /* * */ bool query_validation_layer_support();
+    /* * */ /* * */ bool validation_layers_supported{false};
     /* * */ /* * */ const std::vector<const char *> validation_layers{"VK_LAYER_KHRONOS_validation"};
     void create_debug_utils_messenger();
     void create_surface();
@@ -85,41 +186,146 @@ class Engine
     /* * */ bool physical_device_suitable(VkPhysicalDevice);
     /* * */ /* * */ Queue_Family_Index find_queue_families(VkPhysicalDevice);
     /* * */ /* * */ bool query_extension_support(VkPhysicalDevice);
+    /* * */ /* * */ bool query_feature_support(VkPhysicalDevice);
     /* * */ /* * */ /* * */ std::vector<const char *> device_extensions{VK_KHR_SWAPCHAIN_EXTENSION_NAME};
     /* * */ /* * */ Swapchain_Support query_swapchain_support(VkPhysicalDevice);
     void create_logical_device();
     /* * */ VkDevice device{VK_NULL_HANDLE};
     /* * */ VkQueue graphics_queue;
     /* * */ VkQueue present_queue;
+    /* * */ bool calibrated_timestamps_enabled{false};
+    /* * */ bool present_wait_enabled{false};
+    /* * */ PFN_vkWaitForPresentKHR p_wait_for_present{nullptr};
+    void create_deletion_queue();
+    /* * */ Deletion_Queue deletion_queue;
+    void create_gpu_profiler();
+    /* * */ Gpu_Profiler gpu_profiler;
     void create_swapchain();
     /* * */ VkExtent2D swapchain_extent;
     /* * */ VkFormat swapchain_image_format;
-    /* * */ VkSwapchainKHR swapchain;
+    /* * */ Unique_Swapchain swapchain;
     /* * */ std::vector<VkImage> swapchain_images;
-    /* * */ VkSurfaceFormatKHR choose_swapchain_surface_format(const std::vector<VkSurfaceFormatKHR> &);
-    /* * */ VkPresentModeKHR choose_swapchain_present_mode(const std::vector<VkPresentModeKHR> &);
+    /* * */ bool swapchain_capturable{false};
+    /* * */ /* This is used for the dynamic resolution upscale, and is linear where the format allows it. */
+    /* * */ VkFilter upscale_filter{VK_FILTER_NEAREST};
+    /* * */ VkSurfaceFormatKHR choose_swapchain_surface_format(std::span<const VkSurfaceFormatKHR>);
+    /* * */ VkPresentModeKHR choose_swapchain_present_mode(std::span<const VkPresentModeKHR>);
     /* * */ VkExtent2D choose_swapchain_extent(const VkSurfaceCapabilitiesKHR &);
     void create_image_views();
-    /* * */ std::vector<VkImageView> swapchain_image_views;
-    void create_render_pass();
-    /* * */ VkRenderPass render_pass;
+    /* * */ std::vector<Unique_Image_View> swapchain_image_views;
+    void create_render_graph();
+    /* * */ Render_Graph render_graph;
+    /* * */ VkFormat depth_format;
+    /* * */ VkFormat find_depth_format();
+    void create_descriptor_set_layout();
+    /* * */ VkDescriptorSetLayout descriptor_set_layout;
+    void create_bindless();
+    /* * */ Bindless bindless;
+    void create_pipeline_cache();
+    /* * */ VkPipelineCache pipeline_cache{VK_NULL_HANDLE};
+    /* * */ /* This is read in parallel with everything before the device. */
+    /* * */ void read_pipeline_cache();
+    /* * */ /* * */ std::vector<char> pipeline_cache_data;
+    /* * */ /* * */ static constexpr const char *PIPELINE_CACHE_PATH{"bin/pipeline_cache.bin"};
+    /* * */ void save_pipeline_cache();
+    void create_pipeline_library();
+    /* * */ Pipeline_Library pipeline_library;
+    /* This is called again to reload the shaders, and the old pipelines are retired. */
     void create_graphics_pipeline();
-    /* * */ VkPipeline graphics_pipeline;
-    /* * */ VkPipelineLayout pipeline_layout;
+    /* * */ /* The scene's pipelines come from the library; these are its base permutations, which are always ready. */
+    /* * */ Pipeline_Key triangle_key;
+    /* * */ Pipeline_Key mesh_key;
+    /* * */ Unique_Pipeline_Layout pipeline_layout;
+    /* * */ void read_shaders();
+    /* * */ /* * */ std::map<std::string, std::vector<char>> shader_code;
     /* * */ static std::vector<char> read_file(const std::string &);
     /* * */ VkShaderModule create_shader_module(const std::vector<char> &);
-    void create_framebuffers();
-    /* * */ std::vector<VkFramebuffer> swapchain_framebuffers;
     void create_command_pool();
     /* * */ VkCommandPool command_pool;
-    void create_command_buffer();
-    /* * */ VkCommandBuffer command_buffer;
-    void create_sync_object();
-    /* * */ VkFence in_flight_fence;
-    /* * */ VkSemaphore image_available_semaphore;
-    /* * */ VkSemaphore render_finished_semaphore;
+    void create_frame_ring();
+    /* * */ Frame_Ring frame_ring;
+    /* * */ /* The descriptor ranges are fixed; dynamic offsets select where in the ring they start. */
+    /* * */ static constexpr VkDeviceSize UNIFORM_RANGE{256};
+    /* * */ static constexpr VkDeviceSize STORAGE_RANGE{64 * 1024};
+    /* * */ static constexpr VkDeviceSize FRAME_RING_SIZE{1024 * 1024};
+    void create_descriptor_pool();
+    /* * */ VkDescriptorPool descriptor_pool;
+    void create_descriptor_set();
+    /* * */ VkDescriptorSet descriptor_set;
+    void create_texture_streamer();
+    /* * */ Texture_Streamer texture_streamer;
+    /* * */ Sampler_Cache sampler_cache;
+    /* * */ uint32_t default_sampler;
+    /* * */ std::vector<uint32_t> textures;
+    void create_sprite_batch();
+    /* * */ /* The pipelines are made with the others, in `create_graphics_pipeline`. */
+    /* * */ Sprite_Batch sprite_batch;
+    /* * */ static constexpr uint32_t SPRITE_CAPACITY{1 << 16};
+    /* * */ Atlas atlas;
+    /* * */ static constexpr uint32_t ATLAS_SIZE{1024};
+    /* * */ static constexpr VkDeviceSize ATLAS_STAGING_SIZE{4 * 1024 * 1024};
+    /* * */ uint32_t atlas_sampler;
+    /* * */ /* The shapes that `--sprites` draws */
+    /* * */ std::vector<Atlas::Region> sprite_shapes;
+    void create_particle_system();
+    /* * */ /* This is only created with `--particles`, and its pipelines are made with the others. */
+    /* * */ Particle_System particle_system;
+    void create_meshes();
+    /* * */ std::vector<Mesh> meshes;
+    /* * */ /* These are loaded in parallel with everything before the command pool, and dropped once uploaded. */
+    /* * */ std::vector<Mesh_Data> mesh_data;
+    /* * */ Mesh_Data load_mesh_data(const std::string &);
+    /* * */ Buffer create_device_local_buffer(const void *, VkDeviceSize, VkBufferUsageFlags);
+    /* * */ /* * */ VkCommandBuffer begin_single_time_commands();
+    /* * */ /* * */ void end_single_time_commands(VkCommandBuffer);
+    void create_command_buffers();
+    /* * */ VkCommandBuffer command_buffers[MAX_FRAMES_IN_FLIGHT];
+    void create_sync_objects();
+    /* * */ VkFence in_flight_fences[MAX_FRAMES_IN_FLIGHT];
+    /* * */ VkSemaphore image_available_semaphores[MAX_FRAMES_IN_FLIGHT];
+    /* * */ void create_render_finished_semaphores();
+    /* * */ /* These are indexed by swapchain image, since the presentation engine holds them until that image is acquired again. */
+    /* * */ /* * */ std::vector<Unique_Semaphore> render_finished_semaphores;
+    void create_readback();
+    /* * */ Readback readback;
+    void create_dynamic_resolution();
+    /* * */ /* This is only used with `--target-frame-time`. */
+    /* * */ Dynamic_Resolution dynamic_resolution;
 
     /* # `draw` # */
 
+    uint32_t current_frame{0};
+    /* This counts frames for the `Deletion_Queue`; `current_frame` is this modulo `MAX_FRAMES_IN_FLIGHT`. */
+    uint64_t frame_number{0};
+    /* The swapchain is replaced before the next frame when this is set. */
+    bool swapchain_out_of_date{false};
+    /* This returns `false` while the window has no area, when there is nothing to draw to. */
+    bool recreate_swapchain();
+    Uint64 last_ticks{0};
+    /* The last present that low latency waits for, and the swapchain it went to, since IDs belong to a swapchain */
+    uint64_t last_present_id{0};
+    VkSwapchainKHR presented_swapchain{VK_NULL_HANDLE};
+    static constexpr uint64_t PRESENT_WAIT_TIMEOUT{100'000'000};
+    Frame_Pacing frame_pacing;
+    /* `--benchmark` totals, over the frames after the warm-up, in which the arenas grow and the caches fill */
+    static constexpr uint64_t BENCHMARK_WARMUP{60};
+    uint64_t benchmark_allocations{0};
+    int64_t benchmark_time{0};
+    void end_benchmark_frame(uint64_t allocations_before, int64_t begin);
     void record_command_buffer(VkCommandBuffer, uint32_t);
+    /* * */ VkPipeline scene_pipeline(const Pipeline_Key &, bool textured);
+    /* * */ void record_scene(VkCommandBuffer, const Scene_State &);
+    /* * */ /* With `--reuse-command-buffers`, each frame slot's scene draws are recorded into these once, and replayed until its `Scene_State` changes. Everything that changes every frame is recorded around them. */
+    /* * */ VkCommandBuffer scene_command_buffers[MAX_FRAMES_IN_FLIGHT];
+    /* * */ std::optional<Scene_State> recorded_scenes[MAX_FRAMES_IN_FLIGHT];
+    /* * */ void queue_sprites(float time);
+    /* * */ Readback::Callback capture_callback();
+    /* * */ /* * */ bool screenshot_requested{false};
+    /* * */ /* * */ bool golden_recorded{false};
+    /* * */ /* * */ /* This is set on a pool thread. */
+    /* * */ /* * */ std::atomic<SDL_AppResult> app_result{SDL_APP_CONTINUE};
+
+    /* # `event` # */
+
+    void write_trace();
 };
@@ -0,0 +1,47 @@
+#include "frame_pacing.hpp"
+
+/*
+    - `std::max` [[.](https://en.cppreference.com/w/cpp/algorithm/max.html)]
+*/
+#include <algorithm>
+/*
+    - `fprintf` [[.](https://en.cppreference.com/w/cpp/io/c/fprintf.html)]
+*/
+#include <cstdio>
+
+void Frame_Pacing::begin_frame(uint64_t present_id, int64_t time)
+{
+    begins[present_id % HISTORY] = {present_id, time};
+}
+
+void Frame_Pacing::presented(uint64_t present_id, int64_t time)
+{
+    /* Presents that were not timed are spread evenly over the interval. */
+    if (last_present_id != 0 && present_id > last_present_id)
+    {
+        int64_t interval{(time - last_present_time) / static_cast<int64_t>(present_id - last_present_id)};
+        interval_sum += static_cast<double>(interval) * static_cast<double>(present_id - last_present_id);
+        interval_count += present_id - last_present_id;
+        interval_max = std::max(interval_max, interval);
+    }
+
+    const Begin &begin{begins[present_id % HISTORY]};
+
+    if (begin.present_id == present_id)
+    {
+        int64_t latency{time - begin.time};
+        latency_sum += static_cast<double>(latency);
+        latency_count++;
+        latency_max = std::max(latency_max, latency);
+    }
+
+    last_present_id = present_id;
+    last_present_time = time;
+}
+
+void Frame_Pacing::report(bool displayed) const
+{
+    if (interval_count == 0 || latency_count == 0) return;
+    fprintf(stdout, "Presents came every %.2f ms on average, and at most %.2f ms apart.\n", interval_sum / static_cast<double>(interval_count) * 1e-6, static_cast<double>(interval_max) * 1e-6);
+    fprintf(stdout, "From the start of a frame's CPU work until it was %s took %.2f ms on average, and at most %.2f ms.\n", displayed ? "displayed" : "queued for presentation", latency_sum / static_cast<double>(latency_count) * 1e-6, static_cast<double>(latency_max) * 1e-6);
+}
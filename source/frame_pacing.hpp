@@ -0,0 +1,40 @@
+#pragma once
+
+/*
+    - `uint64_t` [[.](https://en.cppreference.com/w/cpp/types/integer.html)]
+*/
+#include <cstdint>
+
+/*
+    Intervals between presents, and the latency from the start of a frame's CPU work to its present, which are reported at exit. Presents are timed when they reach the display with `VK_KHR_present_wait`, and when they are queued otherwise.
+
+    Times are those of `Profiler::now`.
+*/
+class Frame_Pacing
+{
+    public:
+    void begin_frame(uint64_t present_id, int64_t time);
+    void presented(uint64_t present_id, int64_t time);
+    /* `displayed` says how presents were timed. */
+    void report(bool displayed) const;
+
+    private:
+    /* More than the frames that can be queued at once */
+    static constexpr uint32_t HISTORY{16};
+
+    struct Begin
+    {
+        uint64_t present_id{0};
+        int64_t time{0};
+    };
+
+    Begin begins[HISTORY];
+    uint64_t last_present_id{0};
+    int64_t last_present_time{0};
+    uint64_t interval_count{0};
+    double interval_sum{0.0};
+    int64_t interval_max{0};
+    uint64_t latency_count{0};
+    double latency_sum{0.0};
+    int64_t latency_max{0};
+};
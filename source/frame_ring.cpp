@@ -0,0 +1,33 @@
+#include "frame_ring.hpp"
+
+void Frame_Ring::create(VkPhysicalDevice physical_device, VkDevice device, VkDeviceSize frame_size, uint32_t frame_count, VkBufferUsageFlags usage, VkDeviceSize tail)
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physical_device, &properties);
+    /* Dynamic offsets must be multiples of these, and every limit is a power of two, so the largest satisfies all of them. */
+    alignment = std::max({properties.limits.minUniformBufferOffsetAlignment, properties.limits.minStorageBufferOffsetAlignment, VkDeviceSize{16}});
+    this->frame_size = (frame_size + alignment - 1) & ~(alignment - 1);
+    ring = create_buffer(physical_device, device, this->frame_size * frame_count + tail, usage, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    begin_frame(0);
+}
+
+void Frame_Ring::destroy(VkDevice device)
+{
+    destroy_buffer(device, ring);
+}
+
+void Frame_Ring::begin_frame(uint32_t frame)
+{
+    region_begin = frame * frame_size;
+    region_end = region_begin + frame_size;
+    head = region_begin;
+}
+
+Frame_Ring::Allocation Frame_Ring::allocate(VkDeviceSize size, VkDeviceSize block)
+{
+    VkDeviceSize step{std::lcm(alignment, block)};
+    VkDeviceSize offset{(head + step - 1) / step * step};
+    if (offset + size > region_end) throw std::runtime_error("The frame ring is exhausted.\n");
+    head = offset + size;
+    return {offset, static_cast<char *>(ring.p_mapped) + offset};
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+/*
+    - `std::max` [[.](https://en.cppreference.com/w/cpp/algorithm/max.html)]
+*/
+#include <algorithm>
+/*
+    - `std::memcpy` [[.](https://en.cppreference.com/w/cpp/string/byte/memcpy.html)]
+*/
+#include <cstring>
+/*
+    - `std::lcm` [[.](https://en.cppreference.com/w/cpp/numeric/lcm.html)]
+*/
+#include <numeric>
+
+#include "buffer.hpp"
+
+/*
+    A persistently mapped buffer split into one region per frame in flight. Each region is suballocated with a bump pointer that is reset when its frame begins again, which is only after the fence for that frame has been waited on. Descriptors point at the whole buffer once, and each draw selects its data with a dynamic offset, so nothing is allocated or written to a descriptor set per frame.
+*/
+class Frame_Ring
+{
+    public:
+    struct Allocation
+    {
+        VkDeviceSize offset;
+        void *p_data;
+    };
+
+    /* `tail` is padding past the last region so that a descriptor range starting at any allocation stays inside the buffer. */
+    void create(VkPhysicalDevice, VkDevice, VkDeviceSize frame_size, uint32_t frame_count, VkBufferUsageFlags, VkDeviceSize tail);
+    void destroy(VkDevice);
+    void begin_frame(uint32_t frame);
+    /* The offset is also a multiple of `block`, which need not be a power of two, such as a texel block for a copy to an image. */
+    Allocation allocate(VkDeviceSize size, VkDeviceSize block = 1);
+
+    template <typename T>
+    Allocation push(const T &value)
+    {
+        Allocation allocation{allocate(sizeof(T))};
+        std::memcpy(allocation.p_data, &value, sizeof(T));
+        return allocation;
+    }
+
+    /* This is conservative: it assumes every one of `count` allocations loses the most it can to alignment. */
+    bool fits(VkDeviceSize size, uint32_t count = 1, VkDeviceSize block = 1) const { return head + size + count * (std::lcm(alignment, block) - 1) <= region_end; }
+    VkBuffer buffer() const { return ring.buffer; }
+    VkDeviceSize used() const { return head - region_begin; }
+
+    private:
+    Buffer ring;
+    VkDeviceSize frame_size{0};
+    VkDeviceSize alignment{1};
+    VkDeviceSize region_begin{0};
+    VkDeviceSize region_end{0};
+    VkDeviceSize head{0};
+};
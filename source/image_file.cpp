@@ -0,0 +1,221 @@
+#include "image_file.hpp"
+
+/*
+    - `std::max` [[.](https://en.cppreference.com/w/cpp/algorithm/max.html)]
+    - `std::min` [[.](https://en.cppreference.com/w/cpp/algorithm/min.html)]
+*/
+#include <algorithm>
+/*
+    - `std::array` [[.](https://en.cppreference.com/w/cpp/container/array.html)]
+*/
+#include <array>
+/*
+    - `std::abs` [[.](https://en.cppreference.com/w/cpp/numeric/math/abs.html)]
+*/
+#include <cstdlib>
+/*
+    - `std::memcpy` [[.](https://en.cppreference.com/w/cpp/string/byte/memcpy.html)]
+*/
+#include <cstring>
+/*
+    - `std::ifstream` [[.](https://en.cppreference.com/w/cpp/io/basic_ifstream.html)]
+    - `std::ofstream` [[.](https://en.cppreference.com/w/cpp/io/basic_ofstream.html)]
+*/
+#include <fstream>
+/*
+    - `std::runtime_error` [[.](https://en.cppreference.com/w/cpp/error/runtime_error.html)]
+*/
+#include <stdexcept>
+
+namespace
+{
+    std::ofstream open(const std::string &path)
+    {
+        std::ofstream file(path, std::ios::binary);
+        if (!file.is_open()) throw std::runtime_error("`" + path + "` could not be opened for writing.\n");
+        return file;
+    }
+
+    /* PNG's integers are big-endian. */
+    void append_u32(std::vector<uint8_t> &bytes, uint32_t value)
+    {
+        for (int shift{24}; shift >= 0; shift -= 8) bytes.push_back(static_cast<uint8_t>(value >> shift));
+    }
+
+    uint32_t crc32(const uint8_t *p_bytes, size_t size)
+    {
+        static const std::array<uint32_t, 256> TABLE{[]() {
+            std::array<uint32_t, 256> table;
+
+            for (uint32_t i{0}; i < 256; i++)
+            {
+                uint32_t c{i};
+                for (int k{0}; k < 8; k++) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                table[i] = c;
+            }
+
+            return table;
+        }()};
+
+        uint32_t c{~0u};
+        for (size_t i{0}; i < size; i++) c = TABLE[(c ^ p_bytes[i]) & 0xFF] ^ (c >> 8);
+        return ~c;
+    }
+
+    void write_chunk(std::ofstream &file, const char type[4], const std::vector<uint8_t> &data)
+    {
+        std::vector<uint8_t> chunk;
+        chunk.reserve(12 + data.size());
+        append_u32(chunk, static_cast<uint32_t>(data.size()));
+        chunk.insert(chunk.end(), type, type + 4);
+        chunk.insert(chunk.end(), data.begin(), data.end());
+        /* The CRC covers the type and the data. */
+        append_u32(chunk, crc32(chunk.data() + 4, chunk.size() - 4));
+        file.write(reinterpret_cast<const char *>(chunk.data()), static_cast<std::streamsize>(chunk.size()));
+    }
+}
+
+Rgb_Image to_rgb(const Readback::Image &image)
+{
+    Rgb_Image rgb{image.extent.width, image.extent.height, {}};
+    size_t count{static_cast<size_t>(image.extent.width) * image.extent.height};
+    rgb.texels.resize(count * 3);
+    uint8_t *p_rgb{rgb.texels.data()};
+
+    for (size_t i{0}; i < count; i++)
+    {
+        const uint8_t *p_texel{image.p_texels + i * 4};
+        uint32_t packed;
+        std::memcpy(&packed, p_texel, sizeof(packed));
+
+        /* Ten-bit channels keep their top eight bits. */
+        switch (image.format)
+        {
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R8G8B8A8_SRGB:
+            p_rgb[i * 3 + 0] = p_texel[0];
+            p_rgb[i * 3 + 1] = p_texel[1];
+            p_rgb[i * 3 + 2] = p_texel[2];
+            break;
+        case VK_FORMAT_B8G8R8A8_UNORM:
+        case VK_FORMAT_B8G8R8A8_SRGB:
+            p_rgb[i * 3 + 0] = p_texel[2];
+            p_rgb[i * 3 + 1] = p_texel[1];
+            p_rgb[i * 3 + 2] = p_texel[0];
+            break;
+        case VK_FORMAT_A2B10G10R10_UNORM_PACK32:
+            p_rgb[i * 3 + 0] = static_cast<uint8_t>((packed >> 2) & 0xFF);
+            p_rgb[i * 3 + 1] = static_cast<uint8_t>((packed >> 12) & 0xFF);
+            p_rgb[i * 3 + 2] = static_cast<uint8_t>((packed >> 22) & 0xFF);
+            break;
+        case VK_FORMAT_A2R10G10B10_UNORM_PACK32:
+            p_rgb[i * 3 + 0] = static_cast<uint8_t>((packed >> 22) & 0xFF);
+            p_rgb[i * 3 + 1] = static_cast<uint8_t>((packed >> 12) & 0xFF);
+            p_rgb[i * 3 + 2] = static_cast<uint8_t>((packed >> 2) & 0xFF);
+            break;
+        default:
+            throw std::runtime_error("Images of this format cannot be converted to RGB.\n");
+        }
+    }
+
+    return rgb;
+}
+
+void write_raw(const std::string &path, const Readback::Image &image)
+{
+    std::ofstream file{open(path)};
+    file.write(reinterpret_cast<const char *>(image.p_texels), static_cast<std::streamsize>(image.extent.width) * image.extent.height * Readback::texel_size(image.format));
+}
+
+void write_ppm(const std::string &path, const Rgb_Image &image)
+{
+    std::ofstream file{open(path)};
+    file << "P6\n" << image.width << ' ' << image.height << "\n255\n";
+    file.write(reinterpret_cast<const char *>(image.texels.data()), static_cast<std::streamsize>(image.texels.size()));
+}
+
+/*
+    The zlib stream holds stored deflate blocks of at most 65535 bytes each, after a header that declares no compression. Every row starts with filter type `0`.
+*/
+void write_png(const std::string &path, const Rgb_Image &image)
+{
+    constexpr uint8_t SIGNATURE[8]{0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    constexpr size_t MAX_BLOCK{65535};
+    size_t row_size{static_cast<size_t>(image.width) * 3};
+    std::vector<uint8_t> scanlines;
+    scanlines.reserve((row_size + 1) * image.height);
+
+    for (uint32_t y{0}; y < image.height; y++)
+    {
+        scanlines.push_back(0);
+        scanlines.insert(scanlines.end(), image.texels.begin() + y * row_size, image.texels.begin() + (y + 1) * row_size);
+    }
+
+    std::vector<uint8_t> header;
+    append_u32(header, image.width);
+    append_u32(header, image.height);
+    /* Eight bits per channel, RGB, deflate, adaptive filtering and no interlacing */
+    header.insert(header.end(), {8, 2, 0, 0, 0});
+    std::vector<uint8_t> data{0x78, 0x01};
+    data.reserve(scanlines.size() + scanlines.size() / MAX_BLOCK * 5 + 11);
+    size_t offset{0};
+
+    do
+    {
+        size_t size{std::min(MAX_BLOCK, scanlines.size() - offset)};
+        bool last{offset + size == scanlines.size()};
+        data.insert(data.end(), {static_cast<uint8_t>(last), static_cast<uint8_t>(size), static_cast<uint8_t>(size >> 8), static_cast<uint8_t>(~size), static_cast<uint8_t>(~size >> 8)});
+        data.insert(data.end(), scanlines.begin() + offset, scanlines.begin() + offset + size);
+        offset += size;
+    } while (offset < scanlines.size());
+
+    /* Adler-32 of the uncompressed data */
+    uint32_t a{1};
+    uint32_t b{0};
+
+    for (uint8_t byte : scanlines)
+    {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+
+    append_u32(data, (b << 16) | a);
+    std::ofstream file{open(path)};
+    file.write(reinterpret_cast<const char *>(SIGNATURE), sizeof(SIGNATURE));
+    write_chunk(file, "IHDR", header);
+    write_chunk(file, "IDAT", data);
+    write_chunk(file, "IEND", {});
+}
+
+Rgb_Image read_ppm(const std::string &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) throw std::runtime_error("`" + path + "` could not be opened.\n");
+    std::string magic;
+    Rgb_Image image;
+    uint32_t max_value{0};
+    file >> magic >> image.width >> image.height >> max_value;
+    if (!file || magic != "P6" || max_value != 255) throw std::runtime_error("`" + path + "` is not a binary PPM with 8-bit channels.\n");
+    /* A single whitespace character separates the header from the texels. */
+    file.get();
+    image.texels.resize(static_cast<size_t>(image.width) * image.height * 3);
+    file.read(reinterpret_cast<char *>(image.texels.data()), static_cast<std::streamsize>(image.texels.size()));
+    if (!file) throw std::runtime_error("`" + path + "` is truncated.\n");
+    return image;
+}
+
+Image_Difference compare(const Rgb_Image &a, const Rgb_Image &b)
+{
+    if (a.width != b.width || a.height != b.height) throw std::runtime_error("Images of different sizes cannot be compared.\n");
+    Image_Difference difference{0, 0};
+
+    for (size_t i{0}; i < a.texels.size(); i += 3)
+    {
+        uint32_t texel_difference{0};
+        for (size_t c{0}; c < 3; c++) texel_difference = std::max(texel_difference, static_cast<uint32_t>(std::abs(a.texels[i + c] - b.texels[i + c])));
+        difference.max_difference = std::max(difference.max_difference, texel_difference);
+        if (texel_difference > 0) difference.differing_texels++;
+    }
+
+    return difference;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+/*
+    - `std::string` [[.](https://en.cppreference.com/w/cpp/string/basic_string.html)]
+*/
+#include <string>
+/*
+    - `std::vector` [[.](https://en.cppreference.com/w/cpp/container/vector.html)]
+*/
+#include <vector>
+
+#include "readback.hpp"
+
+/* Frames as they are written and compared: tightly packed 8-bit RGB, top row first */
+struct Rgb_Image
+{
+    uint32_t width{0};
+    uint32_t height{0};
+    std::vector<uint8_t> texels;
+};
+
+/* Differences are per channel. */
+struct Image_Difference
+{
+    uint32_t max_difference;
+    uint64_t differing_texels;
+};
+
+/* This converts every format that `Readback` reads back; alpha is dropped. */
+Rgb_Image to_rgb(const Readback::Image &);
+/* The texels as they were read back, without a header */
+void write_raw(const std::string &path, const Readback::Image &);
+/* Binary PPM (`P6`) */
+void write_ppm(const std::string &path, const Rgb_Image &);
+/* The image data is stored rather than compressed, which takes no time to encode and keeps captures at frame rate. */
+void write_png(const std::string &path, const Rgb_Image &);
+/* Only binary PPMs with a maximum value of 255 are read. */
+Rgb_Image read_ppm(const std::string &path);
+/* The images must have the same size. */
+Image_Difference compare(const Rgb_Image &, const Rgb_Image &);
@@ -0,0 +1,154 @@
+#include "ktx2.hpp"
+
+/*
+    - `std::bit_width` [[.](https://en.cppreference.com/w/cpp/numeric/bit_width.html)]
+*/
+#include <bit>
+/*
+    - `std::memcmp` [[.](https://en.cppreference.com/w/cpp/string/byte/memcmp.html)]
+*/
+#include <cstring>
+/*
+    - `std::runtime_error` [[.](https://en.cppreference.com/w/cpp/error/runtime_error.html)]
+*/
+#include <stdexcept>
+
+namespace
+{
+    /* All fields are little-endian, as is every platform we build for. */
+    struct Header
+    {
+        char identifier[12];
+        uint32_t vk_format;
+        uint32_t type_size;
+        uint32_t pixel_width;
+        uint32_t pixel_height;
+        uint32_t pixel_depth;
+        uint32_t layer_count;
+        uint32_t face_count;
+        uint32_t level_count;
+        uint32_t supercompression_scheme;
+        uint32_t dfd_byte_offset;
+        uint32_t dfd_byte_length;
+        uint32_t kvd_byte_offset;
+        uint32_t kvd_byte_length;
+        uint64_t sgd_byte_offset;
+        uint64_t sgd_byte_length;
+    };
+
+    struct Level_Index
+    {
+        uint64_t byte_offset;
+        uint64_t byte_length;
+        uint64_t uncompressed_byte_length;
+    };
+
+    static_assert(sizeof(Header) == 80);
+    static_assert(sizeof(Level_Index) == 24);
+
+    constexpr char IDENTIFIER[12]{'\xAB', 'K', 'T', 'X', ' ', '2', '0', '\xBB', '\r', '\n', '\x1A', '\n'};
+
+    /* Uncompressed formats are 1x1 blocks of one texel. */
+    struct Block
+    {
+        uint32_t width;
+        uint32_t height;
+        uint32_t size;
+    };
+
+    /* A `size` of `0` means the format is not supported. */
+    Block block(VkFormat format)
+    {
+        switch (format)
+        {
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        case VK_FORMAT_BC4_UNORM_BLOCK:
+        case VK_FORMAT_BC4_SNORM_BLOCK:
+            return {4, 4, 8};
+        case VK_FORMAT_BC2_UNORM_BLOCK:
+        case VK_FORMAT_BC2_SRGB_BLOCK:
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+        case VK_FORMAT_BC5_SNORM_BLOCK:
+        case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+        case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            return {4, 4, 16};
+        case VK_FORMAT_R8_UNORM:
+        case VK_FORMAT_R8_SRGB:
+            return {1, 1, 1};
+        case VK_FORMAT_R8G8_UNORM:
+        case VK_FORMAT_R8G8_SRGB:
+        case VK_FORMAT_R16_SFLOAT:
+            return {1, 1, 2};
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R8G8B8A8_SNORM:
+        case VK_FORMAT_R8G8B8A8_SRGB:
+        case VK_FORMAT_B8G8R8A8_UNORM:
+        case VK_FORMAT_B8G8R8A8_SRGB:
+        case VK_FORMAT_A2B10G10R10_UNORM_PACK32:
+        case VK_FORMAT_R16G16_SFLOAT:
+        case VK_FORMAT_R32_SFLOAT:
+        case VK_FORMAT_B10G11R11_UFLOAT_PACK32:
+        case VK_FORMAT_E5B9G9R9_UFLOAT_PACK32:
+            return {1, 1, 4};
+        case VK_FORMAT_R16G16B16A16_SFLOAT:
+        case VK_FORMAT_R32G32_SFLOAT:
+            return {1, 1, 8};
+        case VK_FORMAT_R32G32B32A32_SFLOAT:
+            return {1, 1, 16};
+        default:
+            return {1, 1, 0};
+        }
+    }
+}
+
+Ktx2 Ktx2::read_header(std::ifstream &file, const std::string &file_name)
+{
+    Header header;
+    file.seekg(0);
+    file.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (!file || std::memcmp(header.identifier, IDENTIFIER, sizeof(IDENTIFIER)) != 0) throw std::runtime_error("`" + file_name + "` is not a KTX 2.0 file.\n");
+    if (header.supercompression_scheme != 0) throw std::runtime_error("`" + file_name + "` is supercompressed, which is not supported.\n");
+    if (header.vk_format == VK_FORMAT_UNDEFINED) throw std::runtime_error("`" + file_name + "` has no Vulkan format (Basis Universal payloads are not supported).\n");
+    if (header.pixel_depth > 1 || header.layer_count > 1 || header.face_count != 1) throw std::runtime_error("`" + file_name + "` is not a single 2D image.\n");
+    Block format_block{block(static_cast<VkFormat>(header.vk_format))};
+    if (format_block.size == 0) throw std::runtime_error("`" + file_name + "` uses " + string_VkFormat(static_cast<VkFormat>(header.vk_format)) + ", which is not supported.\n");
+    /* A level count of zero asks the loader to generate mipmaps, which we do not; only the base level is stored. */
+    uint32_t level_count{std::max(1u, header.level_count)};
+    std::vector<Level_Index> index(level_count);
+    file.read(reinterpret_cast<char *>(index.data()), level_count * sizeof(Level_Index));
+    if (!file) throw std::runtime_error("The level index of `" + file_name + "` could not be read.\n");
+    if (level_count > static_cast<uint32_t>(std::bit_width(std::max(header.pixel_width, header.pixel_height)))) throw std::runtime_error("`" + file_name + "` has more levels than its extent allows.\n");
+
+    Ktx2 ktx2{
+        .format{static_cast<VkFormat>(header.vk_format)},
+        .extent{header.pixel_width, header.pixel_height},
+        .block_size{format_block.size},
+    };
+
+    ktx2.levels.reserve(level_count);
+    for (uint32_t i{0}; i < level_count; i++)
+    {
+        /* The payload is copied to the image as it is, so a level of any other size would be read past or not filled. */
+        VkExtent2D extent{ktx2.level_extent(i)};
+        uint64_t size{uint64_t{(extent.width + format_block.width - 1) / format_block.width} * ((extent.height + format_block.height - 1) / format_block.height) * format_block.size};
+        if (index[i].byte_length != size) throw std::runtime_error("Level " + std::to_string(i) + " of `" + file_name + "` is " + std::to_string(index[i].byte_length) + " bytes, but its extent and format need " + std::to_string(size) + ".\n");
+        ktx2.levels.push_back({index[i].byte_offset, index[i].byte_length});
+    }
+    return ktx2;
+}
+
+std::vector<char> Ktx2::read_level(std::ifstream &file, uint32_t level) const
+{
+    std::vector<char> data(levels[level].size);
+    file.seekg(static_cast<std::streamoff>(levels[level].offset));
+    file.read(data.data(), static_cast<std::streamsize>(data.size()));
+    if (!file) throw std::runtime_error("Level " + std::to_string(level) + " could not be read.\n");
+    return data;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+/*
+    - `std::max` [[.](https://en.cppreference.com/w/cpp/algorithm/max.html)]
+*/
+#include <algorithm>
+/*
+    - `std::ifstream` [[.](https://en.cppreference.com/w/cpp/io/basic_ifstream.html)]
+*/
+#include <fstream>
+/*
+    - `std::string` [[.](https://en.cppreference.com/w/cpp/string/basic_string.html)]
+*/
+#include <string>
+/*
+    - `std::vector` [[.](https://en.cppreference.com/w/cpp/container/vector.html)]
+*/
+#include <vector>
+
+#include "common.hpp"
+
+/*
+    The parts of a KTX 2.0 container [[.](https://registry.khronos.org/KTX/specs/2.0/ktxspec.v2.html)] needed to upload it. Only 2D, single-layer, single-face textures without supercompression are accepted, which covers block-compressed (BCn) and uncompressed formats; the GPU decodes BCn itself, so the payload of each level is uploaded as it is stored.
+*/
+struct Ktx2
+{
+    struct Level
+    {
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    VkFormat format;
+    VkExtent2D extent;
+    /* The bytes in one texel block, which staging offsets must be a multiple of */
+    uint32_t block_size;
+    /* `levels[0]` is the largest. */
+    std::vector<Level> levels;
+
+    /* These throw `std::runtime_error` if the file cannot be read or uses a feature that is not supported. */
+    static Ktx2 read_header(std::ifstream &, const std::string &file_name);
+    std::vector<char> read_level(std::ifstream &, uint32_t level) const;
+
+    VkExtent2D level_extent(uint32_t level) const { return {std::max(1u, extent.width >> level), std::max(1u, extent.height >> level)}; }
+};
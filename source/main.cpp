@@ -7,7 +7,7 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[])
 {
     try
     {
-        engine.initialize();
+        engine.initialize(parse_options(argc, argv));
     }
     catch (const std::exception &exception)
     {
@@ -22,7 +22,8 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[])
 SDL_AppResult SDL_AppIterate(void *appstate)
 {
     engine.draw();
-    return SDL_APP_CONTINUE;
+    /* A golden image comparison ends the program with its result. */
+    return engine.result();
 }
 
 /* This runs when a new event occurs. */
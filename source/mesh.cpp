@@ -0,0 +1,113 @@
+#include "mesh.hpp"
+
+/*
+    - `std::memcmp` [[.](https://en.cppreference.com/w/cpp/string/byte/memcmp.html)]
+*/
+#include <cstring>
+/*
+    - `std::ifstream` [[.](https://en.cppreference.com/w/cpp/io/basic_ifstream.html)]
+    - `std::ofstream` [[.](https://en.cppreference.com/w/cpp/io/basic_ofstream.html)]
+*/
+#include <fstream>
+/*
+    - `std::runtime_error` [[.](https://en.cppreference.com/w/cpp/error/runtime_error.html)]
+*/
+#include <stdexcept>
+
+namespace
+{
+    struct Header
+    {
+        char magic[4];
+        uint32_t version;
+        float position_offset[3];
+        float position_scale[3];
+        uint32_t vertex_count;
+        uint32_t index_count;
+        uint32_t meshlet_count;
+        uint32_t meshlet_vertex_count;
+        uint32_t meshlet_triangle_count;
+    };
+
+    template <typename T>
+    void write_array(std::ofstream &file, const std::vector<T> &array)
+    {
+        file.write(reinterpret_cast<const char *>(array.data()), static_cast<std::streamsize>(array.size() * sizeof(T)));
+    }
+
+    template <typename T>
+    void read_array(std::ifstream &file, std::vector<T> &array, uint32_t count)
+    {
+        array.resize(count);
+        file.read(reinterpret_cast<char *>(array.data()), static_cast<std::streamsize>(array.size() * sizeof(T)));
+    }
+}
+
+void Mesh_Data::write(const std::string &file_name) const
+{
+    std::ofstream file(file_name, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) throw std::runtime_error("`" + file_name + "` could not be opened for writing.\n");
+
+    Header header{
+        .version{VERSION},
+        .position_offset{position_offset[0], position_offset[1], position_offset[2]},
+        .position_scale{position_scale[0], position_scale[1], position_scale[2]},
+        .vertex_count{static_cast<uint32_t>(vertices.size())},
+        .index_count{static_cast<uint32_t>(indices.size())},
+        .meshlet_count{static_cast<uint32_t>(meshlets.size())},
+        .meshlet_vertex_count{static_cast<uint32_t>(meshlet_vertices.size())},
+        .meshlet_triangle_count{static_cast<uint32_t>(meshlet_triangles.size() / 3)},
+    };
+
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    write_array(file, vertices);
+
+    if (wide_indices())
+    {
+        write_array(file, indices);
+    }
+    else
+    {
+        std::vector<uint16_t> narrow(indices.begin(), indices.end());
+        write_array(file, narrow);
+    }
+
+    write_array(file, meshlets);
+    write_array(file, meshlet_vertices);
+    write_array(file, meshlet_triangles);
+    if (!file) throw std::runtime_error("`" + file_name + "` could not be written.\n");
+}
+
+Mesh_Data Mesh_Data::read(const std::string &file_name)
+{
+    std::ifstream file(file_name, std::ios::binary);
+    if (!file.is_open()) throw std::runtime_error("`" + file_name + "` could not be opened.\n");
+    Header header;
+    file.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (!file || std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION) throw std::runtime_error("`" + file_name + "` is not a version " + std::to_string(VERSION) + " mesh file.\n");
+    Mesh_Data mesh;
+    std::memcpy(mesh.position_offset, header.position_offset, sizeof(mesh.position_offset));
+    std::memcpy(mesh.position_scale, header.position_scale, sizeof(mesh.position_scale));
+    read_array(file, mesh.vertices, header.vertex_count);
+
+    if (mesh.wide_indices())
+    {
+        read_array(file, mesh.indices, header.index_count);
+    }
+    else
+    {
+        std::vector<uint16_t> narrow;
+        read_array(file, narrow, header.index_count);
+        mesh.indices.assign(narrow.begin(), narrow.end());
+    }
+
+    read_array(file, mesh.meshlets, header.meshlet_count);
+    read_array(file, mesh.meshlet_vertices, header.meshlet_vertex_count);
+    read_array(file, mesh.meshlet_triangles, header.meshlet_triangle_count * 3);
+    if (!file) throw std::runtime_error("`" + file_name + "` is truncated.\n");
+    /* Vertices past the end would be fetched out of bounds on the GPU. */
+    for (uint32_t index : mesh.indices) if (index >= header.vertex_count) throw std::runtime_error("`" + file_name + "` has an index past its vertices.\n");
+    for (uint32_t index : mesh.meshlet_vertices) if (index >= header.vertex_count) throw std::runtime_error("`" + file_name + "` has a meshlet vertex past its vertices.\n");
+    return mesh;
+}
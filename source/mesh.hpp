@@ -0,0 +1,70 @@
+#pragma once
+
+/*
+    - `std::string` [[.](https://en.cppreference.com/w/cpp/string/basic_string.html)]
+*/
+#include <string>
+/*
+    - `std::vector` [[.](https://en.cppreference.com/w/cpp/container/vector.html)]
+*/
+#include <vector>
+
+#include "common.hpp"
+
+/*
+    16 bytes, against 32 for three floats of position, three of normal and two of texture coordinates
+
+    - `position` is `VK_FORMAT_R16G16B16A16_SNORM`, relative to the mesh's bounds (see `Mesh_Data::position_offset`); `w` is zero.
+    - `normal` is `VK_FORMAT_R16G16_SNORM`, octahedral-encoded [[.](https://jcgt.org/published/0003/02/01/)].
+    - `uv` is `VK_FORMAT_R16G16_SFLOAT`.
+*/
+struct Mesh_Vertex
+{
+    int16_t position[4];
+    int16_t normal[2];
+    uint16_t uv[2];
+};
+
+static_assert(sizeof(Mesh_Vertex) == 16);
+
+/*
+    A cluster of at most `MAX_VERTICES` vertices and `MAX_TRIANGLES` triangles, with bounds for culling. The cluster faces away from a camera at `c`, and can be culled, when `dot(center - c, cone_axis) >= cone_cutoff * length(center - c) + radius`. A `cone_cutoff` of one disables the cone test.
+*/
+struct Meshlet
+{
+    static constexpr uint32_t MAX_VERTICES{64};
+    static constexpr uint32_t MAX_TRIANGLES{124};
+
+    uint32_t vertex_offset;
+    uint32_t triangle_offset;
+    uint32_t vertex_count;
+    uint32_t triangle_count;
+    float center[3];
+    float radius;
+    float cone_axis[3];
+    float cone_cutoff;
+};
+
+/* The contents of a `.mesh` file, as written by `import_mesh` */
+struct Mesh_Data
+{
+    static constexpr char MAGIC[4]{'M', 'E', 'S', 'H'};
+    static constexpr uint32_t VERSION{1};
+
+    /* A position is `position_offset + position_scale * position / 32767`. */
+    float position_offset[3];
+    float position_scale[3];
+    std::vector<Mesh_Vertex> vertices;
+    /* These are stored as 16 bits when every vertex can be addressed that way. */
+    std::vector<uint32_t> indices;
+    std::vector<Meshlet> meshlets;
+    /* `meshlets[i]` uses `meshlet_vertices[vertex_offset + j]` for its local vertex `j`. */
+    std::vector<uint32_t> meshlet_vertices;
+    /* Three local vertex indices per triangle, starting at `triangle_offset * 3` */
+    std::vector<uint8_t> meshlet_triangles;
+
+    bool wide_indices() const { return vertices.size() > 65536; }
+    /* These throw `std::runtime_error` on failure. */
+    void write(const std::string &) const;
+    static Mesh_Data read(const std::string &);
+};
@@ -0,0 +1,1235 @@
+#include "mesh_import.hpp"
+
+/*
+    - `std::sort` [[.](https://en.cppreference.com/w/cpp/algorithm/sort.html)]
+*/
+#include <algorithm>
+/*
+    - `std::array` [[.](https://en.cppreference.com/w/cpp/container/array.html)]
+*/
+#include <array>
+/*
+    - `std::isdigit` [[.](https://en.cppreference.com/w/cpp/string/byte/isdigit.html)]
+*/
+#include <cctype>
+/*
+    - `std::sqrt` [[.](https://en.cppreference.com/w/cpp/numeric/math/sqrt.html)]
+*/
+#include <cmath>
+/*
+    - `std::strtof` [[.](https://en.cppreference.com/w/cpp/string/byte/strtof.html)]
+*/
+#include <cstdlib>
+/*
+    - `std::memcpy` [[.](https://en.cppreference.com/w/cpp/string/byte/memcpy.html)]
+*/
+#include <cstring>
+/*
+    - `std::filesystem::path` [[.](https://en.cppreference.com/w/cpp/filesystem/path.html)]
+*/
+#include <filesystem>
+/*
+    - `std::ifstream` [[.](https://en.cppreference.com/w/cpp/io/basic_ifstream.html)]
+*/
+#include <fstream>
+/*
+    - `std::numeric_limits` [[.](https://en.cppreference.com/w/cpp/types/numeric_limits.html)]
+*/
+#include <limits>
+/*
+    - `std::runtime_error` [[.](https://en.cppreference.com/w/cpp/error/runtime_error.html)]
+*/
+#include <stdexcept>
+/*
+    - `std::string_view` [[.](https://en.cppreference.com/w/cpp/string/basic_string_view.html)]
+*/
+#include <string_view>
+/*
+    - `std::unordered_map` [[.](https://en.cppreference.com/w/cpp/container/unordered_map.html)]
+*/
+#include <unordered_map>
+
+namespace
+{
+    using Vector = std::array<float, 3>;
+
+    Vector operator-(const Vector &a, const Vector &b) { return {a[0] - b[0], a[1] - b[1], a[2] - b[2]}; }
+    float dot(const Vector &a, const Vector &b) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }
+    Vector cross(const Vector &a, const Vector &b) { return {a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]}; }
+
+    Vector normalize(const Vector &a)
+    {
+        float length{std::sqrt(dot(a, a))};
+        return length > 0.0f ? Vector{a[0] / length, a[1] / length, a[2] / length} : Vector{};
+    }
+
+    /* Importers produce three of these per triangle; a zero normal means that the source did not have one. */
+    struct Corner
+    {
+        Vector position;
+        Vector normal;
+        float uv[2];
+    };
+
+    /* # JSON # */
+
+    /* Just enough JSON [[.](https://www.rfc-editor.org/rfc/rfc8259)] for glTF */
+    struct Json
+    {
+        enum class Type
+        {
+            NONE,
+            BOOLEAN,
+            NUMBER,
+            STRING,
+            ARRAY,
+            OBJECT,
+        };
+
+        Type type{Type::NONE};
+        bool boolean{false};
+        double number{0.0};
+        std::string string;
+        std::vector<Json> array;
+        std::vector<std::pair<std::string, Json>> members;
+
+        static Json parse(std::string_view);
+
+        /* These return a `Type::NONE` value when the key or index is absent. */
+        const Json &operator[](std::string_view key) const
+        {
+            static const Json none;
+            for (const auto &[name, value] : members)
+                if (name == key) return value;
+            return none;
+        }
+
+        const Json &operator[](size_t i) const
+        {
+            static const Json none;
+            return i < array.size() ? array[i] : none;
+        }
+
+        bool has(std::string_view key) const { return (*this)[key].type != Type::NONE; }
+        double number_or(double fallback) const { return type == Type::NUMBER ? number : fallback; }
+
+        uint32_t index() const
+        {
+            if (type != Type::NUMBER || number < 0.0) throw std::runtime_error("An index is missing from the glTF.\n");
+            return static_cast<uint32_t>(number);
+        }
+    };
+
+    struct Json_Parser
+    {
+        std::string_view text;
+        size_t at{0};
+
+        [[noreturn]] void fail() const { throw std::runtime_error("The JSON is malformed at byte " + std::to_string(at) + ".\n"); }
+
+        void skip_space()
+        {
+            while (at < text.size() && (text[at] == ' ' || text[at] == '\t' || text[at] == '\n' || text[at] == '\r')) at++;
+        }
+
+        void expect(char c)
+        {
+            skip_space();
+            if (at >= text.size() || text[at] != c) fail();
+            at++;
+        }
+
+        bool literal(std::string_view word)
+        {
+            if (text.substr(at, word.size()) != word) return false;
+            at += word.size();
+            return true;
+        }
+
+        std::string string()
+        {
+            expect('"');
+            std::string result;
+
+            while (true)
+            {
+                if (at >= text.size()) fail();
+                char c{text[at++]};
+                if (c == '"') return result;
+
+                if (c != '\\')
+                {
+                    result += c;
+                    continue;
+                }
+
+                if (at >= text.size()) fail();
+
+                switch (char escape{text[at++]})
+                {
+                case 'b': result += '\b'; break;
+                case 'f': result += '\f'; break;
+                case 'n': result += '\n'; break;
+                case 'r': result += '\r'; break;
+                case 't': result += '\t'; break;
+                case 'u':
+                {
+                    if (at + 4 > text.size()) fail();
+                    uint32_t code{static_cast<uint32_t>(std::stoul(std::string{text.substr(at, 4)}, nullptr, 16))};
+                    at += 4;
+
+                    /* This is UTF-8; surrogate pairs are not combined, which only matters for names. */
+                    if (code < 0x80)
+                    {
+                        result += static_cast<char>(code);
+                    }
+                    else if (code < 0x800)
+                    {
+                        result += static_cast<char>(0xc0 | code >> 6);
+                        result += static_cast<char>(0x80 | (code & 0x3f));
+                    }
+                    else
+                    {
+                        result += static_cast<char>(0xe0 | code >> 12);
+                        result += static_cast<char>(0x80 | (code >> 6 & 0x3f));
+                        result += static_cast<char>(0x80 | (code & 0x3f));
+                    }
+
+                    break;
+                }
+                default: result += escape;
+                }
+            }
+        }
+
+        Json value()
+        {
+            skip_space();
+            if (at >= text.size()) fail();
+            Json json;
+
+            switch (text[at])
+            {
+            case '{':
+                json.type = Json::Type::OBJECT;
+                at++;
+                skip_space();
+
+                if (at < text.size() && text[at] == '}')
+                {
+                    at++;
+                    break;
+                }
+
+                do
+                {
+                    std::string key{string()};
+                    expect(':');
+                    json.members.emplace_back(std::move(key), value());
+                    skip_space();
+                } while (at < text.size() && text[at] == ',' && ++at);
+
+                expect('}');
+                break;
+            case '[':
+                json.type = Json::Type::ARRAY;
+                at++;
+                skip_space();
+
+                if (at < text.size() && text[at] == ']')
+                {
+                    at++;
+                    break;
+                }
+
+                do
+                {
+                    json.array.push_back(value());
+                    skip_space();
+                } while (at < text.size() && text[at] == ',' && ++at);
+
+                expect(']');
+                break;
+            case '"':
+                json.type = Json::Type::STRING;
+                json.string = string();
+                break;
+            default:
+                if (literal("true"))
+                {
+                    json.type = Json::Type::BOOLEAN;
+                    json.boolean = true;
+                }
+                else if (literal("false"))
+                {
+                    json.type = Json::Type::BOOLEAN;
+                }
+                else if (literal("null"))
+                {
+                }
+                else
+                {
+                    size_t end{at};
+                    while (end < text.size() && std::string_view{"+-.0123456789eE"}.find(text[end]) != std::string_view::npos) end++;
+                    if (end == at) fail();
+                    json.type = Json::Type::NUMBER;
+                    json.number = std::strtod(std::string{text.substr(at, end - at)}.c_str(), nullptr);
+                    at = end;
+                }
+            }
+
+            return json;
+        }
+    };
+
+    Json Json::parse(std::string_view text)
+    {
+        Json_Parser parser{text};
+        Json json{parser.value()};
+        parser.skip_space();
+        if (parser.at != text.size()) parser.fail();
+        return json;
+    }
+
+    /* Every job is waited for before an exception propagates, since jobs refer to the caller's locals. Waiting runs queued jobs, so imports may run on the pool themselves. */
+    template <typename T>
+    std::vector<T> gather(Thread_Pool &thread_pool, std::vector<std::future<T>> &futures)
+    {
+        for (auto &future : futures) thread_pool.wait(future);
+        std::vector<T> results;
+        for (auto &future : futures) results.push_back(future.get());
+        return results;
+    }
+
+    std::vector<char> read_file(const std::string &file_name)
+    {
+        std::ifstream file(file_name, std::ios::ate | std::ios::binary);
+        if (!file.is_open()) throw std::runtime_error("`" + file_name + "` could not be opened.\n");
+        std::vector<char> buffer(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        return buffer;
+    }
+
+    /* # OBJ # */
+
+    /* OBJ indices may be relative to the vertices read so far, which a chunk only knows locally; `relative` marks those until the chunk's base is known. */
+    struct Obj_Reference
+    {
+        static constexpr int64_t NONE{std::numeric_limits<int64_t>::min()};
+
+        int64_t value{NONE};
+        bool relative{false};
+    };
+
+    struct Obj_Chunk
+    {
+        std::vector<float> positions;
+        std::vector<float> uvs;
+        std::vector<float> normals;
+        /* These are position, texture coordinate and normal references, three corners per triangle. */
+        std::vector<std::array<Obj_Reference, 3>> corners;
+    };
+
+    void skip_blank(const char *&p, const char *end)
+    {
+        while (p < end && (*p == ' ' || *p == '\t')) p++;
+    }
+
+    /* `std::strtof` skips newlines, so the next character is checked first, to keep each record on its line. */
+    bool parse_float(const char *&p, const char *end, float &value)
+    {
+        skip_blank(p, end);
+        if (p == end || !(std::isdigit(static_cast<unsigned char>(*p)) || *p == '-' || *p == '+' || *p == '.')) return false;
+        char *next;
+        value = std::strtof(p, &next);
+        p = next;
+        return true;
+    }
+
+    bool parse_integer(const char *&p, const char *end, int64_t &value)
+    {
+        if (p == end || !(std::isdigit(static_cast<unsigned char>(*p)) || *p == '-')) return false;
+        char *next;
+        value = std::strtoll(p, &next, 10);
+        p = next;
+        return true;
+    }
+
+    void parse_floats(const char *&p, const char *end, std::vector<float> &values, uint32_t count)
+    {
+        for (uint32_t i{0}; i < count; i++)
+        {
+            float value{0.0f};
+            parse_float(p, end, value);
+            values.push_back(value);
+        }
+    }
+
+    /* The text must be followed by a non-numeric character, which the whole file's trailing `'\0'` guarantees. */
+    Obj_Chunk parse_obj_chunk(std::string_view text)
+    {
+        Obj_Chunk chunk;
+        const char *p{text.data()};
+        const char *end{text.data() + text.size()};
+        std::vector<std::array<Obj_Reference, 3>> polygon;
+
+        while (p < end)
+        {
+            skip_blank(p, end);
+            const char *line{p};
+            while (p < end && *p != '\n') p++;
+            const char *line_end{p++};
+            if (line_end - line < 2) continue;
+
+            if (line[0] == 'v' && (line[1] == ' ' || line[1] == '\t'))
+            {
+                line += 1;
+                parse_floats(line, line_end, chunk.positions, 3);
+            }
+            else if (line[0] == 'v' && line[1] == 't')
+            {
+                line += 2;
+                parse_floats(line, line_end, chunk.uvs, 2);
+            }
+            else if (line[0] == 'v' && line[1] == 'n')
+            {
+                line += 2;
+                parse_floats(line, line_end, chunk.normals, 3);
+            }
+            else if (line[0] == 'f' && (line[1] == ' ' || line[1] == '\t'))
+            {
+                line += 1;
+                polygon.clear();
+                int64_t counts[3]{static_cast<int64_t>(chunk.positions.size() / 3), static_cast<int64_t>(chunk.uvs.size() / 2), static_cast<int64_t>(chunk.normals.size() / 3)};
+
+                while (true)
+                {
+                    skip_blank(line, line_end);
+                    if (line == line_end || *line == '\r') break;
+                    std::array<Obj_Reference, 3> corner{};
+
+                    /* `v`, `v/vt`, `v//vn` or `v/vt/vn` */
+                    for (uint32_t i{0}; i < 3; i++)
+                    {
+                        int64_t value;
+
+                        if (parse_integer(line, line_end, value) && value != 0)
+                        {
+                            if (value > 0)
+                                corner[i] = {value - 1, false};
+                            else
+                                corner[i] = {counts[i] + value, true};
+                        }
+
+                        if (line == line_end || *line != '/') break;
+                        line++;
+                    }
+
+                    if (corner[0].value == Obj_Reference::NONE) throw std::runtime_error("An OBJ face is missing a position.\n");
+                    polygon.push_back(corner);
+                    while (line < line_end && *line != ' ' && *line != '\t') line++;
+                }
+
+                /* Polygons are triangulated as fans. */
+                for (size_t i{2}; i < polygon.size(); i++)
+                {
+                    chunk.corners.push_back(polygon[0]);
+                    chunk.corners.push_back(polygon[i - 1]);
+                    chunk.corners.push_back(polygon[i]);
+                }
+            }
+        }
+
+        return chunk;
+    }
+
+    std::vector<Corner> import_obj(const std::string &file_name, Thread_Pool &thread_pool)
+    {
+        std::vector<char> text{read_file(file_name)};
+        text.push_back('\0');
+        size_t size{text.size() - 1};
+
+        /* Chunks of at least 256 KiB, split at line ends, several per worker to even out the load */
+        size_t chunk_count{std::clamp<size_t>(size / (256 * 1024), 1, thread_pool.size() * 4)};
+        std::vector<std::future<Obj_Chunk>> futures;
+        size_t begin{0};
+
+        for (size_t i{0}; i < chunk_count && begin < size; i++)
+        {
+            size_t end{i + 1 == chunk_count ? size : std::max(begin, size * (i + 1) / chunk_count)};
+            while (end < size && text[end] != '\n') end++;
+            end = std::min(end + 1, size);
+            futures.push_back(thread_pool.submit([view{std::string_view{text.data() + begin, end - begin}}]() { return parse_obj_chunk(view); }));
+            begin = end;
+        }
+
+        std::vector<Obj_Chunk> chunks{gather(thread_pool, futures)};
+
+        /* Once every chunk's counts are known, its references become global, and its corners can be resolved, again in parallel. */
+        std::vector<float> positions, uvs, normals;
+        std::vector<std::array<int64_t, 3>> bases;
+
+        for (const auto &chunk : chunks)
+        {
+            bases.push_back({static_cast<int64_t>(positions.size() / 3), static_cast<int64_t>(uvs.size() / 2), static_cast<int64_t>(normals.size() / 3)});
+            positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+            uvs.insert(uvs.end(), chunk.uvs.begin(), chunk.uvs.end());
+            normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+        }
+
+        std::vector<std::future<std::vector<Corner>>> resolved;
+
+        for (size_t i{0}; i < chunks.size(); i++)
+        {
+            resolved.push_back(thread_pool.submit([&, i]() {
+                int64_t counts[3]{static_cast<int64_t>(positions.size() / 3), static_cast<int64_t>(uvs.size() / 2), static_cast<int64_t>(normals.size() / 3)};
+                std::vector<Corner> corners;
+                corners.reserve(chunks[i].corners.size());
+
+                for (const auto &references : chunks[i].corners)
+                {
+                    int64_t index[3];
+
+                    for (uint32_t j{0}; j < 3; j++)
+                    {
+                        index[j] = references[j].value;
+                        if (index[j] == Obj_Reference::NONE) continue;
+                        if (references[j].relative) index[j] += bases[i][j];
+                        if (index[j] < 0 || index[j] >= counts[j]) throw std::runtime_error("`" + file_name + "` has an out-of-range face index.\n");
+                    }
+
+                    Corner corner{};
+                    std::memcpy(corner.position.data(), &positions[index[0] * 3], sizeof(corner.position));
+
+                    if (index[1] != Obj_Reference::NONE)
+                    {
+                        /* OBJ's texture origin is at the bottom. */
+                        corner.uv[0] = uvs[index[1] * 2];
+                        corner.uv[1] = 1.0f - uvs[index[1] * 2 + 1];
+                    }
+
+                    if (index[2] != Obj_Reference::NONE) std::memcpy(corner.normal.data(), &normals[index[2] * 3], sizeof(corner.normal));
+                    corners.push_back(corner);
+                }
+
+                return corners;
+            }));
+        }
+
+        std::vector<Corner> corners;
+        for (const auto &chunk_corners : gather(thread_pool, resolved)) corners.insert(corners.end(), chunk_corners.begin(), chunk_corners.end());
+        return corners;
+    }
+
+    /* # glTF # */
+
+    using Matrix = std::array<float, 16>;
+
+    constexpr Matrix IDENTITY{1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+
+    /* Column-major, as glTF stores them */
+    Matrix multiply(const Matrix &a, const Matrix &b)
+    {
+        Matrix result{};
+
+        for (uint32_t column{0}; column < 4; column++)
+            for (uint32_t row{0}; row < 4; row++)
+                for (uint32_t k{0}; k < 4; k++) result[column * 4 + row] += a[k * 4 + row] * b[column * 4 + k];
+
+        return result;
+    }
+
+    Matrix node_matrix(const Json &node)
+    {
+        Matrix matrix{IDENTITY};
+
+        if (node.has("matrix"))
+        {
+            for (uint32_t i{0}; i < 16; i++) matrix[i] = static_cast<float>(node["matrix"][i].number_or(matrix[i]));
+            return matrix;
+        }
+
+        float t[3], r[4]{0.0f, 0.0f, 0.0f, 1.0f}, s[3]{1.0f, 1.0f, 1.0f};
+        for (uint32_t i{0}; i < 3; i++) t[i] = static_cast<float>(node["translation"][i].number_or(0.0));
+        for (uint32_t i{0}; i < 4; i++) r[i] = static_cast<float>(node["rotation"][i].number_or(r[i]));
+        for (uint32_t i{0}; i < 3; i++) s[i] = static_cast<float>(node["scale"][i].number_or(1.0));
+        float x{r[0]}, y{r[1]}, z{r[2]}, w{r[3]};
+
+        /* `T * R * S` */
+        matrix = {
+            (1 - 2 * (y * y + z * z)) * s[0], 2 * (x * y + z * w) * s[0], 2 * (x * z - y * w) * s[0], 0,
+            2 * (x * y - z * w) * s[1], (1 - 2 * (x * x + z * z)) * s[1], 2 * (y * z + x * w) * s[1], 0,
+            2 * (x * z + y * w) * s[2], 2 * (y * z - x * w) * s[2], (1 - 2 * (x * x + y * y)) * s[2], 0,
+            t[0], t[1], t[2], 1};
+
+        return matrix;
+    }
+
+    struct Gltf
+    {
+        Json json;
+        std::vector<std::vector<char>> buffers;
+    };
+
+    std::vector<char> decode_base64(std::string_view text)
+    {
+        std::vector<char> data;
+        uint32_t bits{0}, count{0};
+
+        for (char c : text)
+        {
+            uint32_t value;
+
+            if (c >= 'A' && c <= 'Z')
+                value = c - 'A';
+            else if (c >= 'a' && c <= 'z')
+                value = c - 'a' + 26;
+            else if (c >= '0' && c <= '9')
+                value = c - '0' + 52;
+            else if (c == '+')
+                value = 62;
+            else if (c == '/')
+                value = 63;
+            else
+                break;
+
+            bits = bits << 6 | value;
+            count += 6;
+
+            if (count >= 8)
+            {
+                count -= 8;
+                data.push_back(static_cast<char>(bits >> count & 0xff));
+            }
+        }
+
+        return data;
+    }
+
+    Gltf read_gltf(const std::string &file_name)
+    {
+        std::vector<char> file{read_file(file_name)};
+        std::string_view text{file.data(), file.size()};
+        std::vector<char> binary;
+
+        /* A `.glb` is a 12-byte header, a JSON chunk and an optional binary chunk [[.](https://registry.khronos.org/glTF/specs/2.0/glTF-2.0.html#binary-gltf-layout)]. */
+        if (file.size() >= 20 && text.substr(0, 4) == "glTF")
+        {
+            uint32_t json_size;
+            std::memcpy(&json_size, file.data() + 12, sizeof(json_size));
+            if (20 + static_cast<size_t>(json_size) > file.size()) throw std::runtime_error("`" + file_name + "` is truncated.\n");
+            text = {file.data() + 20, json_size};
+            size_t at{20 + static_cast<size_t>(json_size)};
+
+            if (at + 8 <= file.size())
+            {
+                uint32_t binary_size;
+                std::memcpy(&binary_size, file.data() + at, sizeof(binary_size));
+                if (at + 8 + binary_size > file.size()) throw std::runtime_error("`" + file_name + "` is truncated.\n");
+                binary.assign(file.data() + at + 8, file.data() + at + 8 + binary_size);
+            }
+        }
+
+        Gltf gltf{Json::parse(text)};
+        std::filesystem::path directory{std::filesystem::path{file_name}.parent_path()};
+
+        for (const auto &buffer : gltf.json["buffers"].array)
+        {
+            const std::string &uri{buffer["uri"].string};
+
+            if (uri.empty())
+                gltf.buffers.push_back(std::move(binary));
+            else if (uri.starts_with("data:"))
+                gltf.buffers.push_back(decode_base64(std::string_view{uri}.substr(uri.find(',') + 1)));
+            else
+                gltf.buffers.push_back(read_file((directory / uri).string()));
+
+            if (gltf.buffers.back().size() < static_cast<size_t>(buffer["byteLength"].number_or(0.0))) throw std::runtime_error("A buffer in `" + file_name + "` is truncated.\n");
+        }
+
+        return gltf;
+    }
+
+    /* This reads `components` values per element, as floats, whatever the accessor's component type. */
+    std::vector<float> read_accessor(const Gltf &gltf, uint32_t index, uint32_t components)
+    {
+        const Json &accessor{gltf.json["accessors"][index]};
+        if (accessor.has("sparse") || !accessor.has("bufferView")) throw std::runtime_error("Sparse glTF accessors are not supported.\n");
+        const Json &view{gltf.json["bufferViews"][accessor["bufferView"].index()]};
+        const std::vector<char> &buffer{gltf.buffers.at(view["buffer"].index())};
+
+        uint32_t type{accessor["componentType"].index()};
+        uint32_t component_size{type == 5126 || type == 5125 ? 4u : type == 5122 || type == 5123 ? 2u : 1u};
+        size_t count{accessor["count"].index()};
+        size_t stride{static_cast<size_t>(view["byteStride"].number_or(component_size * components))};
+        size_t offset{static_cast<size_t>(view["byteOffset"].number_or(0.0) + accessor["byteOffset"].number_or(0.0))};
+        bool normalized{accessor["normalized"].boolean};
+        if (count > 0 && offset + (count - 1) * stride + components * component_size > buffer.size()) throw std::runtime_error("A glTF accessor is out of range.\n");
+
+        std::vector<float> values(count * components);
+
+        for (size_t i{0}; i < count; i++)
+        {
+            for (uint32_t c{0}; c < components; c++)
+            {
+                const char *p{buffer.data() + offset + i * stride + c * component_size};
+                float &value{values[i * components + c]};
+
+                /* The normalized conversions are the specification's. */
+                switch (type)
+                {
+                case 5120: value = normalized ? std::max(*reinterpret_cast<const int8_t *>(p) / 127.0f, -1.0f) : *reinterpret_cast<const int8_t *>(p); break;
+                case 5121: value = normalized ? *reinterpret_cast<const uint8_t *>(p) / 255.0f : *reinterpret_cast<const uint8_t *>(p); break;
+                case 5122:
+                {
+                    int16_t v;
+                    std::memcpy(&v, p, sizeof(v));
+                    value = normalized ? std::max(v / 32767.0f, -1.0f) : v;
+                    break;
+                }
+                case 5123:
+                {
+                    uint16_t v;
+                    std::memcpy(&v, p, sizeof(v));
+                    value = normalized ? v / 65535.0f : v;
+                    break;
+                }
+                case 5125:
+                {
+                    uint32_t v;
+                    std::memcpy(&v, p, sizeof(v));
+                    value = static_cast<float>(v);
+                    break;
+                }
+                case 5126: std::memcpy(&value, p, sizeof(value)); break;
+                default: throw std::runtime_error("A glTF accessor has an unknown component type.\n");
+                }
+            }
+        }
+
+        return values;
+    }
+
+    std::vector<uint32_t> read_indices(const Gltf &gltf, const Json &primitive, size_t vertex_count)
+    {
+        std::vector<uint32_t> indices;
+
+        if (!primitive.has("indices"))
+        {
+            for (uint32_t i{0}; i < vertex_count; i++) indices.push_back(i);
+            return indices;
+        }
+
+        /* Through `float`, 32-bit indices are exact only up to 2^24, which is more vertices than a primitive has in practice. */
+        for (float index : read_accessor(gltf, primitive["indices"].index(), 1)) indices.push_back(static_cast<uint32_t>(index));
+        for (uint32_t index : indices)
+            if (index >= vertex_count) throw std::runtime_error("A glTF index is out of range.\n");
+        return indices;
+    }
+
+    std::vector<Corner> decode_primitive(const Gltf &gltf, const Json &primitive, const Matrix &matrix)
+    {
+        const Json &attributes{primitive["attributes"]};
+        uint32_t mode{static_cast<uint32_t>(primitive["mode"].number_or(4.0))};
+        /* Points and lines are not meshes. */
+        if (!attributes.has("POSITION") || mode < 4) return {};
+
+        std::vector<float> positions{read_accessor(gltf, attributes["POSITION"].index(), 3)};
+        size_t vertex_count{positions.size() / 3};
+        std::vector<float> normals{attributes.has("NORMAL") ? read_accessor(gltf, attributes["NORMAL"].index(), 3) : std::vector<float>(vertex_count * 3, 0.0f)};
+        std::vector<float> uvs{attributes.has("TEXCOORD_0") ? read_accessor(gltf, attributes["TEXCOORD_0"].index(), 2) : std::vector<float>(vertex_count * 2, 0.0f)};
+        if (normals.size() / 3 != vertex_count || uvs.size() / 2 != vertex_count) throw std::runtime_error("The attributes of a glTF primitive differ in count.\n");
+        std::vector<uint32_t> indices{read_indices(gltf, primitive, vertex_count)};
+
+        /* Strips and fans become lists. */
+        if (mode == 5 || mode == 6)
+        {
+            std::vector<uint32_t> list;
+
+            for (size_t i{2}; i < indices.size(); i++)
+            {
+                if (mode == 6)
+                    list.insert(list.end(), {indices[0], indices[i - 1], indices[i]});
+                else if (i % 2 == 0)
+                    list.insert(list.end(), {indices[i - 2], indices[i - 1], indices[i]});
+                else
+                    list.insert(list.end(), {indices[i - 1], indices[i - 2], indices[i]});
+            }
+
+            indices = std::move(list);
+        }
+
+        /* Normals transform by the cofactor matrix, which is the inverse transpose up to scale. */
+        Vector columns[3]{{matrix[0], matrix[1], matrix[2]}, {matrix[4], matrix[5], matrix[6]}, {matrix[8], matrix[9], matrix[10]}};
+        Vector cofactor[3]{cross(columns[1], columns[2]), cross(columns[2], columns[0]), cross(columns[0], columns[1])};
+        bool mirrored{dot(columns[0], cofactor[0]) < 0.0f};
+
+        std::vector<Corner> corners;
+        corners.reserve(indices.size() / 3 * 3);
+
+        for (size_t i{0}; i + 2 < indices.size(); i += 3)
+        {
+            /* A mirroring transform flips the winding, which is undone here. */
+            uint32_t triangle[3]{indices[i], indices[i + (mirrored ? 2 : 1)], indices[i + (mirrored ? 1 : 2)]};
+
+            for (uint32_t index : triangle)
+            {
+                const float *p{&positions[index * 3]};
+                const float *n{&normals[index * 3]};
+                Corner corner{};
+                for (uint32_t r{0}; r < 3; r++) corner.position[r] = matrix[r] * p[0] + matrix[4 + r] * p[1] + matrix[8 + r] * p[2] + matrix[12 + r];
+                for (uint32_t r{0}; r < 3; r++) corner.normal[r] = cofactor[0][r] * n[0] + cofactor[1][r] * n[1] + cofactor[2][r] * n[2];
+                corner.normal = normalize(corner.normal);
+                corner.uv[0] = uvs[index * 2];
+                corner.uv[1] = uvs[index * 2 + 1];
+                corners.push_back(corner);
+            }
+        }
+
+        return corners;
+    }
+
+    std::vector<Corner> import_gltf(const std::string &file_name, Thread_Pool &thread_pool)
+    {
+        Gltf gltf{read_gltf(file_name)};
+        const Json &json{gltf.json};
+        std::vector<std::pair<const Json *, Matrix>> primitives;
+
+        auto add_mesh{[&](const Json &mesh, const Matrix &matrix) {
+            for (const auto &primitive : mesh["primitives"].array) primitives.emplace_back(&primitive, matrix);
+        }};
+
+        /* Meshes are placed by the default scene's node hierarchy, or taken as they are when there is no scene. */
+        if (json.has("scenes"))
+        {
+            std::vector<std::pair<uint32_t, Matrix>> stack;
+            size_t visited{0};
+            for (const auto &node : json["scenes"][static_cast<size_t>(json["scene"].number_or(0.0))]["nodes"].array) stack.emplace_back(node.index(), IDENTITY);
+
+            while (!stack.empty())
+            {
+                auto [index, parent] {stack.back()};
+                stack.pop_back();
+                /* Each node has at most one parent, so a node visited twice means a cycle. */
+                if (++visited > json["nodes"].array.size()) throw std::runtime_error("The node hierarchy of `" + file_name + "` has a cycle.\n");
+                const Json &node{json["nodes"][index]};
+                Matrix matrix{multiply(parent, node_matrix(node))};
+                if (node.has("mesh")) add_mesh(json["meshes"][node["mesh"].index()], matrix);
+                for (const auto &child : node["children"].array) stack.emplace_back(child.index(), matrix);
+            }
+        }
+        else
+        {
+            for (const auto &mesh : json["meshes"].array) add_mesh(mesh, IDENTITY);
+        }
+
+        std::vector<std::future<std::vector<Corner>>> futures;
+        for (const auto &[p_primitive, matrix] : primitives) futures.push_back(thread_pool.submit([&gltf, p_primitive, matrix]() { return decode_primitive(gltf, *p_primitive, matrix); }));
+        std::vector<Corner> corners;
+        for (const auto &primitive_corners : gather(thread_pool, futures)) corners.insert(corners.end(), primitive_corners.begin(), primitive_corners.end());
+        return corners;
+    }
+
+    /* # Quantization # */
+
+    int16_t snorm16(float value) { return static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f)); }
+
+    /* This rounds to nearest, with ties away from zero. */
+    uint16_t half(float value)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        uint32_t sign{bits >> 16 & 0x8000};
+        uint32_t mantissa{bits & 0x7fffff};
+        int32_t exponent{static_cast<int32_t>(bits >> 23 & 0xff) - 127 + 15};
+
+        if ((bits >> 23 & 0xff) == 0xff) return static_cast<uint16_t>(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+        if (exponent >= 31) return static_cast<uint16_t>(sign | 0x7c00);
+
+        if (exponent <= 0)
+        {
+            if (exponent < -10) return static_cast<uint16_t>(sign);
+            mantissa |= 0x800000;
+            uint32_t shift{static_cast<uint32_t>(14 - exponent)};
+            return static_cast<uint16_t>(sign | ((mantissa >> shift) + (mantissa >> (shift - 1) & 1)));
+        }
+
+        /* A carry out of the mantissa correctly rounds up into the exponent. */
+        return static_cast<uint16_t>((sign | static_cast<uint32_t>(exponent) << 10 | mantissa >> 13) + (mantissa >> 12 & 1));
+    }
+
+    void encode_octahedral(Vector normal, int16_t encoded[2])
+    {
+        float l1{std::abs(normal[0]) + std::abs(normal[1]) + std::abs(normal[2])};
+
+        if (l1 == 0.0f)
+        {
+            encoded[0] = encoded[1] = 0;
+            return;
+        }
+
+        float x{normal[0] / l1}, y{normal[1] / l1};
+
+        if (normal[2] < 0.0f)
+        {
+            float folded_x{(1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f)};
+            y = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+            x = folded_x;
+        }
+
+        encoded[0] = snorm16(x);
+        encoded[1] = snorm16(y);
+    }
+
+    struct Vertex_Hash
+    {
+        size_t operator()(const Mesh_Vertex &vertex) const
+        {
+            uint64_t words[2];
+            std::memcpy(words, &vertex, sizeof(words));
+            return std::hash<uint64_t>{}(words[0] * 0x9e3779b97f4a7c15ull ^ words[1]);
+        }
+    };
+
+    struct Vertex_Equal
+    {
+        bool operator()(const Mesh_Vertex &a, const Mesh_Vertex &b) const { return std::memcmp(&a, &b, sizeof(Mesh_Vertex)) == 0; }
+    };
+
+    /* Corners are quantized first and then welded, so vertices that quantize alike are shared. `positions` receives each vertex's unquantized position. Triangles that become degenerate are dropped. */
+    void weld(std::vector<Corner> &corners, Mesh_Data &mesh, std::vector<Vector> &positions)
+    {
+        if (corners.empty()) throw std::runtime_error("The mesh has no triangles.\n");
+        Vector minimum{corners[0].position}, maximum{corners[0].position};
+
+        for (auto &corner : corners)
+        {
+            for (uint32_t i{0}; i < 3; i++)
+            {
+                minimum[i] = std::min(minimum[i], corner.position[i]);
+                maximum[i] = std::max(maximum[i], corner.position[i]);
+            }
+        }
+
+        for (uint32_t i{0}; i < 3; i++)
+        {
+            mesh.position_offset[i] = (minimum[i] + maximum[i]) * 0.5f;
+            mesh.position_scale[i] = maximum[i] > minimum[i] ? (maximum[i] - minimum[i]) * 0.5f : 1.0f;
+        }
+
+        /* Faces without normals are shaded flat. */
+        for (size_t i{0}; i < corners.size(); i += 3)
+        {
+            Vector normal{normalize(cross(corners[i + 1].position - corners[i].position, corners[i + 2].position - corners[i].position))};
+
+            for (size_t j{i}; j < i + 3; j++)
+                if (dot(corners[j].normal, corners[j].normal) == 0.0f) corners[j].normal = normal;
+        }
+
+        std::unordered_map<Mesh_Vertex, uint32_t, Vertex_Hash, Vertex_Equal> indices;
+        indices.reserve(corners.size() / 2);
+        uint32_t triangle[3];
+
+        for (size_t i{0}; i < corners.size(); i++)
+        {
+            const Corner &corner{corners[i]};
+            Mesh_Vertex vertex{};
+            for (uint32_t j{0}; j < 3; j++) vertex.position[j] = snorm16((corner.position[j] - mesh.position_offset[j]) / mesh.position_scale[j]);
+            encode_octahedral(corner.normal, vertex.normal);
+            vertex.uv[0] = half(corner.uv[0]);
+            vertex.uv[1] = half(corner.uv[1]);
+
+            auto [it, inserted] {indices.emplace(vertex, static_cast<uint32_t>(mesh.vertices.size()))};
+
+            if (inserted)
+            {
+                mesh.vertices.push_back(vertex);
+                positions.push_back(corner.position);
+            }
+
+            triangle[i % 3] = it->second;
+            if (i % 3 == 2 && triangle[0] != triangle[1] && triangle[1] != triangle[2] && triangle[0] != triangle[2]) mesh.indices.insert(mesh.indices.end(), triangle, triangle + 3);
+        }
+
+        if (mesh.indices.empty()) throw std::runtime_error("Every triangle of the mesh is degenerate.\n");
+    }
+
+    /* # Optimization # */
+
+    /*
+        Tipsify [[.](https://gfx.cs.princeton.edu/pubs/Sander_2007_%3ETR/tipsy.pdf)]: this fans around one vertex at a time, emitting its remaining triangles, then moves to the vertex that is likeliest to still be in the cache. It runs in linear time.
+    */
+    std::vector<uint32_t> optimize_vertex_cache(const std::vector<uint32_t> &indices, size_t vertex_count, uint32_t cache_size)
+    {
+        size_t triangle_count{indices.size() / 3};
+        /* The triangles around each vertex, in compressed rows */
+        std::vector<uint32_t> live(vertex_count, 0), offsets(vertex_count + 1, 0), adjacency(indices.size());
+        for (uint32_t index : indices) live[index]++;
+        for (size_t v{0}; v < vertex_count; v++) offsets[v + 1] = offsets[v] + live[v];
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i{0}; i < indices.size(); i++) adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+
+        std::vector<uint32_t> cache_time(vertex_count, 0), dead_end, candidates, result;
+        std::vector<bool> emitted(triangle_count, false);
+        result.reserve(indices.size());
+        uint32_t time{cache_size + 1};
+        size_t cursor{0};
+        int64_t fanning{0};
+
+        while (fanning >= 0)
+        {
+            candidates.clear();
+
+            for (uint32_t k{offsets[fanning]}; k < offsets[fanning + 1]; k++)
+            {
+                uint32_t t{adjacency[k]};
+                if (emitted[t]) continue;
+
+                for (uint32_t j{0}; j < 3; j++)
+                {
+                    uint32_t v{indices[t * 3 + j]};
+                    result.push_back(v);
+                    dead_end.push_back(v);
+                    candidates.push_back(v);
+                    live[v]--;
+                    if (time - cache_time[v] > cache_size) cache_time[v] = time++;
+                }
+
+                emitted[t] = true;
+            }
+
+            /* The next fan is the candidate that is still in the cache and will stay there for its own triangles. */
+            int64_t best{-1}, priority{-1};
+
+            for (uint32_t v : candidates)
+            {
+                if (live[v] == 0) continue;
+                int64_t p{0};
+                if (time - cache_time[v] + 2 * live[v] <= cache_size) p = time - cache_time[v];
+
+                if (p > priority)
+                {
+                    best = v;
+                    priority = p;
+                }
+            }
+
+            /* Otherwise, the most recently touched vertex with triangles left, and then any. */
+            while (best < 0 && !dead_end.empty())
+            {
+                uint32_t v{dead_end.back()};
+                dead_end.pop_back();
+                if (live[v] > 0) best = v;
+            }
+
+            while (best < 0 && cursor < vertex_count)
+            {
+                if (live[cursor] > 0) best = static_cast<int64_t>(cursor);
+                cursor++;
+            }
+
+            fanning = best;
+        }
+
+        return result;
+    }
+
+    /*
+        This is the second half of Sander et al.: the cache-ordered triangles are split into clusters where the order already misses the cache, and the clusters are drawn outside-in, ordered by how much they face away from the mesh's centroid, so that they tend to occlude what follows.
+    */
+    std::vector<uint32_t> optimize_overdraw(const std::vector<uint32_t> &indices, const std::vector<Vector> &positions, uint32_t cache_size, uint32_t cluster_size)
+    {
+        size_t triangle_count{indices.size() / 3};
+        std::vector<uint32_t> cache_time(positions.size(), 0), clusters;
+        uint32_t time{cache_size + 1};
+
+        for (size_t t{0}; t < triangle_count; t++)
+        {
+            uint32_t misses{0};
+
+            for (uint32_t j{0}; j < 3; j++)
+            {
+                uint32_t v{indices[t * 3 + j]};
+
+                if (time - cache_time[v] > cache_size)
+                {
+                    cache_time[v] = time++;
+                    misses++;
+                }
+            }
+
+            if (clusters.empty() || (misses == 3 && t - clusters.back() >= cluster_size)) clusters.push_back(static_cast<uint32_t>(t));
+        }
+
+        clusters.push_back(static_cast<uint32_t>(triangle_count));
+        std::vector<Vector> centroids, normals;
+        Vector mesh_centroid{};
+
+        for (size_t c{0}; c + 1 < clusters.size(); c++)
+        {
+            Vector centroid{}, normal{};
+
+            for (uint32_t t{clusters[c]}; t < clusters[c + 1]; t++)
+            {
+                const Vector &a{positions[indices[t * 3]]}, &b{positions[indices[t * 3 + 1]]}, &d{positions[indices[t * 3 + 2]]};
+                /* Area-weighted */
+                Vector n{cross(b - a, d - a)};
+                for (uint32_t i{0}; i < 3; i++) normal[i] += n[i];
+                for (uint32_t i{0}; i < 3; i++) centroid[i] += (a[i] + b[i] + d[i]) / 3.0f;
+            }
+
+            for (uint32_t i{0}; i < 3; i++) mesh_centroid[i] += centroid[i];
+            for (uint32_t i{0}; i < 3; i++) centroid[i] /= static_cast<float>(clusters[c + 1] - clusters[c]);
+            centroids.push_back(centroid);
+            normals.push_back(normalize(normal));
+        }
+
+        for (uint32_t i{0}; i < 3; i++) mesh_centroid[i] /= static_cast<float>(triangle_count);
+        std::vector<uint32_t> order(centroids.size());
+        std::vector<float> keys(centroids.size());
+
+        for (uint32_t c{0}; c < order.size(); c++)
+        {
+            order[c] = c;
+            keys[c] = dot(centroids[c] - mesh_centroid, normals[c]);
+        }
+
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return keys[a] > keys[b]; });
+        std::vector<uint32_t> result;
+        result.reserve(indices.size());
+        for (uint32_t c : order) result.insert(result.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+        return result;
+    }
+
+    /* Vertices are renumbered in order of first use, so that fetches walk the vertex buffer forwards. */
+    void optimize_vertex_fetch(Mesh_Data &mesh, std::vector<Vector> &positions)
+    {
+        constexpr uint32_t UNUSED{~0u};
+        std::vector<uint32_t> remap(mesh.vertices.size(), UNUSED);
+        std::vector<Mesh_Vertex> vertices;
+        std::vector<Vector> reordered;
+        vertices.reserve(mesh.vertices.size());
+        reordered.reserve(positions.size());
+
+        for (uint32_t &index : mesh.indices)
+        {
+            if (remap[index] == UNUSED)
+            {
+                remap[index] = static_cast<uint32_t>(vertices.size());
+                vertices.push_back(mesh.vertices[index]);
+                reordered.push_back(positions[index]);
+            }
+
+            index = remap[index];
+        }
+
+        mesh.vertices = std::move(vertices);
+        positions = std::move(reordered);
+    }
+
+    /* This is the bounding sphere and normal cone of a finished meshlet, as `Meshlet` describes. */
+    void bound_meshlet(Meshlet &meshlet, const Mesh_Data &mesh, const std::vector<Vector> &positions)
+    {
+        Vector center{};
+
+        for (uint32_t i{0}; i < meshlet.vertex_count; i++)
+            for (uint32_t j{0}; j < 3; j++) center[j] += positions[mesh.meshlet_vertices[meshlet.vertex_offset + i]][j] / static_cast<float>(meshlet.vertex_count);
+
+        float radius{0.0f};
+
+        for (uint32_t i{0}; i < meshlet.vertex_count; i++)
+        {
+            Vector d{positions[mesh.meshlet_vertices[meshlet.vertex_offset + i]] - center};
+            radius = std::max(radius, std::sqrt(dot(d, d)));
+        }
+
+        std::vector<Vector> normals;
+        Vector axis{};
+
+        for (uint32_t t{0}; t < meshlet.triangle_count; t++)
+        {
+            const uint8_t *local{&mesh.meshlet_triangles[(meshlet.triangle_offset + t) * 3]};
+            const Vector &a{positions[mesh.meshlet_vertices[meshlet.vertex_offset + local[0]]]};
+            const Vector &b{positions[mesh.meshlet_vertices[meshlet.vertex_offset + local[1]]]};
+            const Vector &c{positions[mesh.meshlet_vertices[meshlet.vertex_offset + local[2]]]};
+            Vector normal{normalize(cross(b - a, c - a))};
+            if (dot(normal, normal) == 0.0f) continue;
+            normals.push_back(normal);
+            for (uint32_t j{0}; j < 3; j++) axis[j] += normal[j];
+        }
+
+        axis = normalize(axis);
+        float minimum{1.0f};
+        for (const Vector &normal : normals) minimum = std::min(minimum, dot(axis, normal));
+
+        std::memcpy(meshlet.center, center.data(), sizeof(meshlet.center));
+        meshlet.radius = radius;
+        std::memcpy(meshlet.cone_axis, axis.data(), sizeof(meshlet.cone_axis));
+        /* A cone wider than about 84 degrees rarely culls anything, so it is disabled. */
+        meshlet.cone_cutoff = minimum <= 0.1f ? 1.0f : std::sqrt(1.0f - minimum * minimum);
+    }
+
+    /* Triangles are taken greedily in their optimized order, which keeps each meshlet spatially coherent. */
+    void build_meshlets(Mesh_Data &mesh, const std::vector<Vector> &positions)
+    {
+        constexpr uint32_t UNUSED{~0u};
+        std::vector<uint32_t> local(mesh.vertices.size(), UNUSED);
+        Meshlet meshlet{};
+
+        auto finish{[&]() {
+            if (meshlet.triangle_count == 0) return;
+            bound_meshlet(meshlet, mesh, positions);
+            for (uint32_t i{0}; i < meshlet.vertex_count; i++) local[mesh.meshlet_vertices[meshlet.vertex_offset + i]] = UNUSED;
+            mesh.meshlets.push_back(meshlet);
+            meshlet = {.vertex_offset{static_cast<uint32_t>(mesh.meshlet_vertices.size())}, .triangle_offset{static_cast<uint32_t>(mesh.meshlet_triangles.size() / 3)}};
+        }};
+
+        for (size_t i{0}; i < mesh.indices.size(); i += 3)
+        {
+            uint32_t added{0};
+            for (uint32_t j{0}; j < 3; j++) added += local[mesh.indices[i + j]] == UNUSED;
+            if (meshlet.vertex_count + added > Meshlet::MAX_VERTICES || meshlet.triangle_count == Meshlet::MAX_TRIANGLES) finish();
+
+            for (uint32_t j{0}; j < 3; j++)
+            {
+                uint32_t v{mesh.indices[i + j]};
+
+                if (local[v] == UNUSED)
+                {
+                    local[v] = meshlet.vertex_count++;
+                    mesh.meshlet_vertices.push_back(v);
+                }
+
+                mesh.meshlet_triangles.push_back(static_cast<uint8_t>(local[v]));
+            }
+
+            meshlet.triangle_count++;
+        }
+
+        finish();
+    }
+}
+
+Mesh_Data import_mesh(const std::string &file_name, Thread_Pool &thread_pool, const Mesh_Import_Settings &settings)
+{
+    std::string extension{std::filesystem::path{file_name}.extension().string()};
+    for (char &c : extension) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    std::vector<Corner> corners;
+
+    if (extension == ".obj")
+        corners = import_obj(file_name, thread_pool);
+    else if (extension == ".gltf" || extension == ".glb")
+        corners = import_gltf(file_name, thread_pool);
+    else
+        throw std::runtime_error("`" + file_name + "` is not an OBJ or glTF file.\n");
+
+    Mesh_Data mesh;
+    std::vector<Vector> positions;
+    weld(corners, mesh, positions);
+    mesh.indices = optimize_vertex_cache(mesh.indices, mesh.vertices.size(), settings.cache_size);
+    mesh.indices = optimize_overdraw(mesh.indices, positions, settings.cache_size, settings.cluster_size);
+    optimize_vertex_fetch(mesh, positions);
+    if (settings.meshlets) build_meshlets(mesh, positions);
+    return mesh;
+}
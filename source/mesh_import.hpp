@@ -0,0 +1,23 @@
+#pragma once
+
+/*
+    - `std::string` [[.](https://en.cppreference.com/w/cpp/string/basic_string.html)]
+*/
+#include <string>
+
+#include "mesh.hpp"
+#include "thread_pool.hpp"
+
+struct Mesh_Import_Settings
+{
+    /* This is the FIFO cache size that vertex cache optimization targets; 16 suits most GPUs. */
+    uint32_t cache_size{16};
+    /* Clusters for the overdraw sort are at least this many triangles, so that they rarely break the cache order. */
+    uint32_t cluster_size{64};
+    bool meshlets{true};
+};
+
+/*
+    This reads an OBJ, glTF (`.gltf`) or binary glTF (`.glb`) file and returns an indexed mesh, ordered for the post-transform vertex cache [[.](https://gfx.cs.princeton.edu/pubs/Sander_2007_%3ETR/tipsy.pdf)], then for overdraw, then for vertex fetch, with quantized vertices and, optionally, meshlets. OBJ files are parsed in chunks and glTF primitives are decoded in parallel on the pool, which may be called from a job on the same pool. This throws `std::runtime_error` on failure.
+*/
+Mesh_Data import_mesh(const std::string &file_name, Thread_Pool &, const Mesh_Import_Settings & = {});
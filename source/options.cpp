@@ -0,0 +1,103 @@
+#include "options.hpp"
+
+/*
+    - `std::runtime_error` [[.](https://en.cppreference.com/w/cpp/error/runtime_error.html)]
+*/
+#include <stdexcept>
+
+Options parse_options(int argc, char *argv[])
+{
+    Options options;
+
+    for (int i{1}; i < argc; i++)
+    {
+        std::string option{argv[i]};
+
+        /* Options that take a value read it through this. */
+        auto value{[&]() {
+            if (i + 1 == argc) throw std::runtime_error("`" + option + "` is missing its value.\n");
+            return std::string{argv[++i]};
+        }};
+
+        if (option == "--texture")
+        {
+            options.textures.push_back(value());
+        }
+        else if (option == "--texture-budget")
+        {
+            options.texture_budget = static_cast<uint32_t>(std::stoul(value()));
+        }
+        else if (option == "--mesh")
+        {
+            options.meshes.push_back(value());
+        }
+        else if (option == "--no-meshlets")
+        {
+            options.meshlets = false;
+        }
+        else if (option == "--trace")
+        {
+            options.trace = value();
+        }
+        else if (option == "--capture")
+        {
+            options.capture = value();
+        }
+        else if (option == "--capture-format")
+        {
+            options.capture_format = value();
+            if (options.capture_format != "raw" && options.capture_format != "ppm" && options.capture_format != "png") throw std::runtime_error("`" + options.capture_format + "` is not a capture format.\n");
+        }
+        else if (option == "--golden")
+        {
+            options.golden = value();
+        }
+        else if (option == "--golden-frame")
+        {
+            options.golden_frame = std::stoull(value());
+        }
+        else if (option == "--golden-tolerance")
+        {
+            options.golden_tolerance = static_cast<uint32_t>(std::stoul(value()));
+        }
+        else if (option == "--target-frame-time")
+        {
+            options.target_frame_time = std::stod(value());
+        }
+        else if (option == "--min-render-scale")
+        {
+            options.min_render_scale = std::stof(value());
+        }
+        else if (option == "--present-mode")
+        {
+            options.present_mode = value();
+            if (options.present_mode != "fifo" && options.present_mode != "mailbox" && options.present_mode != "immediate" && options.present_mode != "low-latency") throw std::runtime_error("`" + options.present_mode + "` is not a present mode.\n");
+        }
+        else if (option == "--swapchain-images")
+        {
+            options.swapchain_images = static_cast<uint32_t>(std::stoul(value()));
+        }
+        else if (option == "--reuse-command-buffers")
+        {
+            options.reuse_command_buffers = true;
+        }
+        else if (option == "--sprites")
+        {
+            options.sprites = static_cast<uint32_t>(std::stoul(value()));
+        }
+        else if (option == "--particles")
+        {
+            options.particles = static_cast<uint32_t>(std::stoul(value()));
+        }
+        else if (option == "--benchmark")
+        {
+            options.benchmark = std::stoull(value());
+        }
+        else
+        {
+            throw std::runtime_error("`" + option + "` is not a known option.\n");
+        }
+    }
+
+    return options;
+}
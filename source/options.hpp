@@ -0,0 +1,54 @@
+#pragma once
+
+/*
+    - `std::string` [[.](https://en.cppreference.com/w/cpp/string/basic_string.html)]
+*/
+#include <string>
+/*
+    - `std::vector` [[.](https://en.cppreference.com/w/cpp/container/vector.html)]
+*/
+#include <vector>
+
+/* These are set from the command line. */
+struct Options
+{
+    /* `--texture <path>`, which may be repeated; KTX 2.0 files */
+    std::vector<std::string> textures;
+    /* `--texture-budget <MiB>` */
+    uint32_t texture_budget{256};
+    /* `--mesh <path>`, which may be repeated; `.mesh` files, or OBJ and glTF files, which are imported to `<path>.mesh` first, or to `<path>.no-meshlets.mesh` with `--no-meshlets` */
+    std::vector<std::string> meshes;
+    /* `--no-meshlets` */
+    bool meshlets{true};
+    /* `--trace <path>`, where F12 writes a Chrome trace, and where one is also written at exit; F12 writes `trace.json` without it */
+    std::string trace;
+    /* `--capture <directory>`, where every frame is written as `frame_<number>.<format>`; frames are dropped rather than waited for when writing falls behind */
+    std::string capture;
+    /* `--capture-format <raw|ppm|png>` */
+    std::string capture_format{"png"};
+    /* `--golden <path>`, a binary PPM that frame `golden_frame` is compared against, after which the program exits with the result; the frame is written there instead when there is no such file */
+    std::string golden;
+    /* `--golden-frame <number>` */
+    uint64_t golden_frame{60};
+    /* `--golden-tolerance <difference>`, the largest difference of any channel that still passes */
+    uint32_t golden_tolerance{2};
+    /* `--target-frame-time <ms>`, the GPU frame time that the render resolution adapts to; `0` renders at the swapchain's resolution */
+    double target_frame_time{0.0};
+    /* `--min-render-scale <scale>`, the lowest fraction of the swapchain's width and height that is rendered with a target frame time */
+    float min_render_scale{0.5f};
+    /* `--present-mode <fifo|mailbox|immediate|low-latency>`; modes that the surface lacks fall back to FIFO */
+    std::string present_mode{"mailbox"};
+    /* `--swapchain-images <count>`, at least the surface's minimum; `0` picks one more than the minimum, or the minimum for low latency */
+    uint32_t swapchain_images{0};
+    /* `--reuse-command-buffers`, which replays the scene's draws from secondary command buffers until the scene, pipelines or extent change */
+    bool reuse_command_buffers{false};
+    /* `--sprites <count>`, which draws that many sprites over the frame every frame, as a load for the sprite batch */
+    uint32_t sprites{0};
+    /* `--particles <capacity>`, which simulates and draws about that many particles on the GPU, rounded up to a power of two */
+    uint32_t particles{0};
+    /* `--benchmark <frames>`, after which the program exits with the average time in `draw` and, in builds with `COUNT_ALLOCATIONS`, heap allocations of those frames, past a warm-up */
+    uint64_t benchmark{0};
+};
+
+/* This throws `std::runtime_error` on an unknown or incomplete option. */
+Options parse_options(int argc, char *argv[]);
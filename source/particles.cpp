@@ -0,0 +1,424 @@
+#include "particles.hpp"
+
+/*
+    - `std::max` [[.](https://en.cppreference.com/w/cpp/algorithm/max.html)]
+    - `std::min` [[.](https://en.cppreference.com/w/cpp/algorithm/min.html)]
+*/
+#include <algorithm>
+/*
+    - `std::bit_ceil` [[.](https://en.cppreference.com/w/cpp/numeric/bit_ceil.html)]
+*/
+#include <bit>
+/*
+    - `std::floor` [[.](https://en.cppreference.com/w/cpp/numeric/math/floor.html)]
+*/
+#include <cmath>
+
+namespace
+{
+    /* Each compute dispatch reads what the one before it wrote. */
+    void compute_barrier(VkCommandBuffer command_buffer)
+    {
+        VkMemoryBarrier barrier{
+            .sType{VK_STRUCTURE_TYPE_MEMORY_BARRIER},
+            // .pNext{},
+            .srcAccessMask{VK_ACCESS_SHADER_WRITE_BIT},
+            .dstAccessMask{VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT},
+        };
+
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+}
+
+void Particle_System::create(VkPhysicalDevice physical_device, VkDevice device, Deletion_Queue *p_deletion_queue, Bindless *p_bindless, uint32_t capacity)
+{
+    this->device = device;
+    this->p_deletion_queue = p_deletion_queue;
+    this->p_bindless = p_bindless;
+    particle_capacity = std::bit_ceil(std::max(capacity, SORT_BLOCK));
+    cleared = false;
+    /* It is flipped before the first frame. */
+    current = 1;
+
+    for (uint32_t i{0}; i < 2; i++)
+    {
+        particles[i] = create_buffer(physical_device, device, VkDeviceSize{particle_capacity} * sizeof(Particle), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        particle_handles[i] = p_bindless->add_buffer(device, particles[i].buffer, 0, VK_WHOLE_SIZE);
+    }
+
+    key_buffer = create_buffer(physical_device, device, VkDeviceSize{particle_capacity} * sizeof(uint32_t) * 2, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    key_handle = p_bindless->add_buffer(device, key_buffer.buffer, 0, VK_WHOLE_SIZE);
+    state_buffer = create_buffer(physical_device, device, sizeof(State), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    state_handle = p_bindless->add_buffer(device, state_buffer.buffer, 0, VK_WHOLE_SIZE);
+
+    VkPushConstantRange push_constant_range{
+        .stageFlags{VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT},
+        .offset{0},
+        .size{sizeof(Push_Constants)},
+    };
+
+    /* `set = 0` is the global bindless set. */
+    VkDescriptorSetLayout set_layout{p_bindless->layout()};
+
+    VkPipelineLayoutCreateInfo create_info{
+        .sType{VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO},
+        // .pNext{},
+        // .flags{},
+        .setLayoutCount{1},
+        .pSetLayouts{&set_layout},
+        .pushConstantRangeCount{1},
+        .pPushConstantRanges{&push_constant_range},
+    };
+
+    VkPipelineLayout layout;
+    CHECK(vkCreatePipelineLayout(device, &create_info, nullptr, &layout));
+    pipeline_layout = Unique_Pipeline_Layout{device, layout, p_deletion_queue};
+}
+
+void Particle_System::destroy()
+{
+    pipelines.emit.reset();
+    pipelines.simulate.reset();
+    pipelines.finish.reset();
+    pipelines.sort.reset();
+    pipelines.draw.reset();
+    pipeline_layout.reset();
+    p_bindless->remove_buffer(state_handle);
+    p_bindless->remove_buffer(key_handle);
+    destroy_buffer(device, state_buffer);
+    destroy_buffer(device, key_buffer);
+
+    for (uint32_t i{0}; i < 2; i++)
+    {
+        p_bindless->remove_buffer(particle_handles[i]);
+        destroy_buffer(device, particles[i]);
+    }
+}
+
+Particle_System::Pipelines Particle_System::create_pipelines(VkShaderModule emit, VkShaderModule simulate, VkShaderModule finish, VkShaderModule sort, VkShaderModule vert, VkShaderModule frag, VkRenderPass render_pass, VkPipelineCache pipeline_cache) const
+{
+    VkShaderModule compute_modules[]{emit, simulate, finish, sort};
+    VkComputePipelineCreateInfo compute_create_infos[4];
+
+    for (uint32_t i{0}; i < 4; i++)
+    {
+        compute_create_infos[i] = {
+            .sType{VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO},
+            // .pNext{},
+            // .flags{},
+            .stage{
+                .sType{VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO},
+                // .pNext{},
+                // .flags{},
+                .stage{VK_SHADER_STAGE_COMPUTE_BIT},
+                .module{compute_modules[i]},
+                .pName{"main"},
+                // .pSpecializationInfo{},
+            },
+            .layout{pipeline_layout},
+            /* This is optional. */ .basePipelineHandle{VK_NULL_HANDLE},
+            /* This is optional. */ .basePipelineIndex{-1},
+        };
+    }
+
+    VkPipeline compute_pipelines[4];
+    CHECK(vkCreateComputePipelines(device, pipeline_cache, 4, compute_create_infos, nullptr, compute_pipelines));
+    Pipelines created;
+    created.emit = Unique_Pipeline{device, compute_pipelines[0]};
+    created.simulate = Unique_Pipeline{device, compute_pipelines[1]};
+    created.finish = Unique_Pipeline{device, compute_pipelines[2]};
+    created.sort = Unique_Pipeline{device, compute_pipelines[3]};
+
+    VkPipelineShaderStageCreateInfo stages[]{
+        {
+            .sType{VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO},
+            // .pNext{},
+            // .flags{},
+            .stage{VK_SHADER_STAGE_VERTEX_BIT},
+            .module{vert},
+            .pName{"main"},
+            // .pSpecializationInfo{},
+        },
+        {
+            .sType{VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO},
+            // .pNext{},
+            // .flags{},
+            .stage{VK_SHADER_STAGE_FRAGMENT_BIT},
+            .module{frag},
+            .pName{"main"},
+            // .pSpecializationInfo{},
+        },
+    };
+
+    /* The vertex shader reads the particles itself. */
+    VkPipelineVertexInputStateCreateInfo vertex_input_state{
+        .sType{VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO},
+        // .pNext{},
+        // .flags{},
+        .vertexBindingDescriptionCount{0},
+        .pVertexBindingDescriptions{nullptr},
+        .vertexAttributeDescriptionCount{0},
+        .pVertexAttributeDescriptions{nullptr},
+    };
+
+    /* Four vertices make a billboard. */
+    VkPipelineInputAssemblyStateCreateInfo input_assembly_state{
+        .sType{VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO},
+        // .pNext{},
+        // .flags{},
+        .topology{VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP},
+        .primitiveRestartEnable{VK_FALSE},
+    };
+
+    VkPipelineViewportStateCreateInfo viewport_state{
+        .sType{VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO},
+        // .pNext{},
+        // .flags{},
+        .viewportCount{1},
+        // .pViewports{},
+        .scissorCount{1},
+        // .pScissors{},
+    };
+
+    VkPipelineRasterizationStateCreateInfo rasterization_state{
+        .sType{VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO},
+        // .pNext{},
+        // .flags{},
+        .depthClampEnable{VK_FALSE},
+        .rasterizerDiscardEnable{VK_FALSE},
+        .polygonMode{VK_POLYGON_MODE_FILL},
+        .cullMode{VK_CULL_MODE_NONE},
+        .frontFace{VK_FRONT_FACE_CLOCKWISE},
+        .depthBiasEnable{VK_FALSE},
+        /* This is optional. */ .depthBiasConstantFactor{0.0f},
+        /* This is optional. */ .depthBiasClamp{0.0f},
+        /* This is optional. */ .depthBiasSlopeFactor{0.0f},
+        .lineWidth{1.0f},
+    };
+
+    VkPipelineMultisampleStateCreateInfo multisample_state{
+        .sType{VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO},
+        // .pNext{},
+        // .flags{},
+        .rasterizationSamples{VK_SAMPLE_COUNT_1_BIT},
+        .sampleShadingEnable{VK_FALSE},
+        /* This is optional. */ .minSampleShading{1.0f},
+        /* This is optional. */ .pSampleMask{nullptr},
+        /* This is optional. */ .alphaToCoverageEnable{VK_FALSE},
+        /* This is optional. */ .alphaToOneEnable{VK_FALSE},
+    };
+
+    /* Particles are hidden by the scene in front of them, but do not hide each other; they are blended in sorted order instead. */
+    VkPipelineDepthStencilStateCreateInfo depth_stencil_state{
+        .sType{VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO},
+        // .pNext{},
+        // .flags{},
+        .depthTestEnable{VK_TRUE},
+        .depthWriteEnable{VK_FALSE},
+        .depthCompareOp{VK_COMPARE_OP_LESS},
+        .depthBoundsTestEnable{VK_FALSE},
+        .stencilTestEnable{VK_FALSE},
+        // .front{},
+        // .back{},
+        /* This is optional. */ .minDepthBounds{0.0f},
+        /* This is optional. */ .maxDepthBounds{1.0f},
+    };
+
+    /* Colors are not premultiplied. */
+    VkPipelineColorBlendAttachmentState color_blend_attachment_state{
+        .blendEnable{VK_TRUE},
+        .srcColorBlendFactor{VK_BLEND_FACTOR_SRC_ALPHA},
+        .dstColorBlendFactor{VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA},
+        .colorBlendOp{VK_BLEND_OP_ADD},
+        .srcAlphaBlendFactor{VK_BLEND_FACTOR_ONE},
+        .dstAlphaBlendFactor{VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA},
+        .alphaBlendOp{VK_BLEND_OP_ADD},
+        .colorWriteMask{VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT},
+    };
+
+    VkPipelineColorBlendStateCreateInfo color_blend_state{
+        .sType{VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO},
+        // .pNext{},
+        // .flags{},
+        .logicOpEnable{VK_FALSE},
+        /* This is optional. */ .logicOp{VK_LOGIC_OP_COPY},
+        .attachmentCount{1},
+        .pAttachments{&color_blend_attachment_state},
+        /* This is optional. */ .blendConstants{},
+    };
+
+    VkDynamicState dynamic_states[]{VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+
+    VkPipelineDynamicStateCreateInfo dynamic_state{
+        .sType{VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO},
+        // .pNext{},
+        // .flags{},
+        .dynamicStateCount{static_cast<uint32_t>(std::size(dynamic_states))},
+        .pDynamicStates{dynamic_states},
+    };
+
+    VkGraphicsPipelineCreateInfo create_info{
+        .sType{VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO},
+        // .pNext{},
+        // .flags{},
+        .stageCount{2},
+        .pStages{stages},
+        .pVertexInputState{&vertex_input_state},
+        .pInputAssemblyState{&input_assembly_state},
+        // .pTessellationState{},
+        .pViewportState{&viewport_state},
+        .pRasterizationState{&rasterization_state},
+        .pMultisampleState{&multisample_state},
+        .pDepthStencilState{&depth_stencil_state},
+        .pColorBlendState{&color_blend_state},
+        .pDynamicState{&dynamic_state},
+        .layout{pipeline_layout},
+        .renderPass{render_pass},
+        .subpass{0},
+        /* This is optional. */ .basePipelineHandle{VK_NULL_HANDLE},
+        /* This is optional. */ .basePipelineIndex{-1},
+    };
+
+    VkPipeline pipeline;
+    CHECK(vkCreateGraphicsPipelines(device, pipeline_cache, 1, &create_info, nullptr, &pipeline));
+    created.draw = Unique_Pipeline{device, pipeline};
+    return created;
+}
+
+void Particle_System::set_pipelines(Pipelines &&new_pipelines)
+{
+    /* Replacing these retires the old ones. */
+    pipelines.emit = Unique_Pipeline{device, new_pipelines.emit.release(), p_deletion_queue};
+    pipelines.simulate = Unique_Pipeline{device, new_pipelines.simulate.release(), p_deletion_queue};
+    pipelines.finish = Unique_Pipeline{device, new_pipelines.finish.release(), p_deletion_queue};
+    pipelines.sort = Unique_Pipeline{device, new_pipelines.sort.release(), p_deletion_queue};
+    pipelines.draw = Unique_Pipeline{device, new_pipelines.draw.release(), p_deletion_queue};
+}
+
+void Particle_System::begin_frame(float delta_time, float time)
+{
+    current = 1 - current;
+    this->delta_time = delta_time;
+    this->time = time;
+    /* Fractions of a particle carry over, so that slow emission is not rounded away, but a long frame emits at most a full buffer. */
+    emit_remainder += static_cast<float>(particle_capacity) / AVERAGE_LIFE * delta_time;
+    emit_count = static_cast<uint32_t>(std::min(std::floor(emit_remainder), static_cast<float>(particle_capacity)));
+    emit_remainder = std::min(emit_remainder - static_cast<float>(emit_count), 1.0f);
+}
+
+Particle_System::Push_Constants Particle_System::push_constants() const
+{
+    return {
+        .source_particles{particle_handles[current]},
+        .destination_particles{particle_handles[1 - current]},
+        .keys{key_handle},
+        .state{state_handle},
+        .source_index{current},
+        .capacity{particle_capacity},
+        .emit_count{emit_count},
+        .delta_time{delta_time},
+        .time{time},
+        .aspect{1.0f},
+        .sort_mode{SORT_LOCAL},
+        .sort_k{0},
+        .sort_j{0},
+    };
+}
+
+void Particle_System::bind(VkCommandBuffer command_buffer, VkDescriptorSet bindless_set, VkPipelineBindPoint bind_point, VkPipeline pipeline, const Push_Constants &push_constants)
+{
+    vkCmdBindPipeline(command_buffer, bind_point, pipeline);
+    vkCmdBindDescriptorSets(command_buffer, bind_point, pipeline_layout, 0, 1, &bindless_set, 0, nullptr);
+    vkCmdPushConstants(command_buffer, pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(Push_Constants), &push_constants);
+}
+
+/* The first frame zeroes the counts and the arguments of its own dispatch, which then does nothing. */
+void Particle_System::simulate(VkCommandBuffer command_buffer, VkDescriptorSet bindless_set)
+{
+    if (!cleared)
+    {
+        vkCmdFillBuffer(command_buffer, state_buffer.buffer, 0, VK_WHOLE_SIZE, 0);
+        cleared = true;
+
+        VkMemoryBarrier barrier{
+            .sType{VK_STRUCTURE_TYPE_MEMORY_BARRIER},
+            // .pNext{},
+            .srcAccessMask{VK_ACCESS_TRANSFER_WRITE_BIT},
+            .dstAccessMask{VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT},
+        };
+
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+
+    bind(command_buffer, bindless_set, VK_PIPELINE_BIND_POINT_COMPUTE, pipelines.simulate, push_constants());
+    vkCmdDispatchIndirect(command_buffer, state_buffer.buffer, offsetof(State, simulate));
+}
+
+void Particle_System::emit(VkCommandBuffer command_buffer, VkDescriptorSet bindless_set)
+{
+    if (emit_count == 0) return;
+    bind(command_buffer, bindless_set, VK_PIPELINE_BIND_POINT_COMPUTE, pipelines.emit, push_constants());
+    vkCmdDispatch(command_buffer, (emit_count + GROUP_SIZE - 1) / GROUP_SIZE, 1, 1);
+}
+
+void Particle_System::finish(VkCommandBuffer command_buffer, VkDescriptorSet bindless_set)
+{
+    bind(command_buffer, bindless_set, VK_PIPELINE_BIND_POINT_COMPUTE, pipelines.finish, push_constants());
+    vkCmdDispatch(command_buffer, 1, 1, 1);
+}
+
+/*
+    A bitonic sort of the padded count, whose dispatches are fixed by the capacity; the dispatches' sizes come from the count. Steps within a block run in shared memory, one dispatch for many steps, and only steps over longer distances take a dispatch each, so a million particles take 78 dispatches rather than 210.
+
+    Stages past the padded count find the keys sorted already, and steps past it find no pairs, so they do no harm.
+*/
+void Particle_System::sort(VkCommandBuffer command_buffer, VkDescriptorSet bindless_set)
+{
+    Push_Constants constants{push_constants()};
+    bind(command_buffer, bindless_set, VK_PIPELINE_BIND_POINT_COMPUTE, pipelines.sort, constants);
+    vkCmdDispatchIndirect(command_buffer, state_buffer.buffer, offsetof(State, sort));
+
+    for (uint32_t k{SORT_BLOCK * 2}; k <= particle_capacity; k <<= 1)
+    {
+        constants.sort_k = k;
+
+        for (uint32_t j{k / 2}; j >= SORT_BLOCK; j >>= 1)
+        {
+            constants.sort_mode = SORT_STEP;
+            constants.sort_j = j;
+            compute_barrier(command_buffer);
+            vkCmdPushConstants(command_buffer, pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(Push_Constants), &constants);
+            vkCmdDispatchIndirect(command_buffer, state_buffer.buffer, offsetof(State, sort));
+        }
+
+        constants.sort_mode = SORT_MERGE;
+        constants.sort_j = SORT_BLOCK / 2;
+        compute_barrier(command_buffer);
+        vkCmdPushConstants(command_buffer, pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(Push_Constants), &constants);
+        vkCmdDispatchIndirect(command_buffer, state_buffer.buffer, offsetof(State, sort));
+    }
+}
+
+void Particle_System::draw(VkCommandBuffer command_buffer, VkDescriptorSet bindless_set, VkExtent2D extent)
+{
+    VkViewport viewport{
+        .x{0.0f},
+        .y{0.0f},
+        .width{static_cast<float>(extent.width)},
+        .height{static_cast<float>(extent.height)},
+        .minDepth{0.0f},
+        .maxDepth{1.0f},
+    };
+
+    VkRect2D scissor{
+        .offset{0, 0},
+        .extent{extent},
+    };
+
+    Push_Constants constants{push_constants()};
+    constants.aspect = static_cast<float>(extent.height) / static_cast<float>(extent.width);
+    vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+    vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+    bind(command_buffer, bindless_set, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.draw, constants);
+    vkCmdDrawIndirect(command_buffer, state_buffer.buffer, offsetof(State, draw), 1, sizeof(VkDrawIndirectCommand));
+}
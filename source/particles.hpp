@@ -0,0 +1,146 @@
+#pragma once
+
+#include "bindless.hpp"
+#include "buffer.hpp"
+#include "common.hpp"
+#include "deletion_queue.hpp"
+
+/*
+    Particles that live entirely on the GPU, in two storage buffers that take turns. Each frame:
+
+    1. `simulate` moves the particles of one buffer and appends those still alive to the other, so the survivors are compacted as they are written.
+    2. `emit` appends new particles after them, up to the capacity.
+    3. `finish` clamps the count and writes the indirect arguments of everything that follows, and of the next frame's `simulate`.
+    4. `sort` orders the particles back to front with a bitonic sort of depth keys, for alpha blending.
+    5. `draw` is one indirect, instanced draw of billboards, inside a render pass.
+
+    The CPU never learns how many particles there are, so nothing is read back and nothing is uploaded per particle. The buffers are shared by all frames in flight; they are only used on one queue, so each frame's first barrier orders it after the last.
+
+    All buffers are reached through `Bindless` handles in push constants, and the turns are taken by swapping handles.
+*/
+class Particle_System
+{
+    public:
+    /* `capacity` is rounded up to a power of two, which the sort needs, and of at least one sort block. */
+    void create(VkPhysicalDevice, VkDevice, Deletion_Queue *, Bindless *, uint32_t capacity);
+    void destroy();
+    /* As `create_pipelines` returns them, these go through no deletion queue, since no frame has used them yet, so dropping them destroys them at once. */
+    struct Pipelines
+    {
+        Unique_Pipeline emit;
+        Unique_Pipeline simulate;
+        Unique_Pipeline finish;
+        Unique_Pipeline sort;
+        Unique_Pipeline draw;
+    };
+
+    /* The render pass needs one color attachment and a depth attachment, which is tested but not written. This changes nothing, so it may run on any thread while the system is in use. */
+    Pipelines create_pipelines(VkShaderModule emit, VkShaderModule simulate, VkShaderModule finish, VkShaderModule sort, VkShaderModule vert, VkShaderModule frag, VkRenderPass, VkPipelineCache) const;
+    /* Pipelines that frames in flight may use are retired, so this can be called at any time, on the thread that owns the deletion queue. */
+    void set_pipelines(Pipelines &&);
+    /* Particles are emitted at a rate that keeps about `capacity` alive. */
+    void begin_frame(float delta_time, float time);
+
+    /* # Recording # */
+
+    /* These are recorded in order, outside of render passes but for `draw`, with barriers between them for the buffers that they use. */
+    void simulate(VkCommandBuffer, VkDescriptorSet bindless_set);
+    void emit(VkCommandBuffer, VkDescriptorSet bindless_set);
+    void finish(VkCommandBuffer, VkDescriptorSet bindless_set);
+    void sort(VkCommandBuffer, VkDescriptorSet bindless_set);
+    /* `extent` is the area of the render pass that is drawn to. */
+    void draw(VkCommandBuffer, VkDescriptorSet bindless_set, VkExtent2D extent);
+
+    /* # Buffers # */
+
+    /* The buffer that this frame's `simulate` reads */
+    VkBuffer source() const { return particles[current].buffer; }
+    /* The buffer that this frame's `simulate` and `emit` write, and `draw` reads */
+    VkBuffer destination() const { return particles[1 - current].buffer; }
+    VkBuffer keys() const { return key_buffer.buffer; }
+    /* The counts and the indirect arguments */
+    VkBuffer state() const { return state_buffer.buffer; }
+    uint32_t capacity() const { return particle_capacity; }
+
+    private:
+    /* Threads per workgroup in every compute shader; a sort block is twice this. */
+    static constexpr uint32_t GROUP_SIZE{256};
+    static constexpr uint32_t SORT_BLOCK{GROUP_SIZE * 2};
+    /* Seconds, on average, which sets the emission rate; this matches `particle_emit.comp`. */
+    static constexpr float AVERAGE_LIFE{3.0f};
+
+    /* `std430`, as in `particle_simulate.comp`; a particle's life is counted down from its lifetime. */
+    struct Particle
+    {
+        float position_life[4];
+        float velocity_lifetime[4];
+    };
+
+    /* `std430`, as in the compute shaders; `finish` writes the indirect arguments, and `counts` are indexed like `particles`. */
+    struct State
+    {
+        VkDispatchIndirectCommand simulate;
+        VkDispatchIndirectCommand sort;
+        VkDrawIndirectCommand draw;
+        uint32_t counts[2];
+        /* The count rounded up to a power of two, of at least a sort block */
+        uint32_t padded;
+    };
+
+    /* `std430`, shared by every particle shader, at most 128 bytes */
+    struct Push_Constants
+    {
+        /* `Bindless` handles; the particle buffers swap roles every frame. */
+        uint32_t source_particles;
+        uint32_t destination_particles;
+        uint32_t keys;
+        uint32_t state;
+        /* The index into the state's `counts` of the source's count */
+        uint32_t source_index;
+        uint32_t capacity;
+        uint32_t emit_count;
+        float delta_time;
+        float time;
+        /* The height of the render area over its width, as in `mesh.vert` */
+        float aspect;
+        uint32_t sort_mode;
+        uint32_t sort_k;
+        uint32_t sort_j;
+    };
+
+    /* These match `particle_sort.comp`. */
+    enum Sort_Mode : uint32_t
+    {
+        /* Every block sorts itself, in alternating directions. */
+        SORT_LOCAL = 0,
+        /* One compare-and-swap step over the whole buffer, for distances past a block */
+        SORT_STEP = 1,
+        /* Every block finishes a merge, from a distance of half a block down. */
+        SORT_MERGE = 2,
+    };
+
+    void bind(VkCommandBuffer, VkDescriptorSet bindless_set, VkPipelineBindPoint, VkPipeline, const Push_Constants &);
+    Push_Constants push_constants() const;
+
+    VkDevice device{VK_NULL_HANDLE};
+    Deletion_Queue *p_deletion_queue{nullptr};
+    Bindless *p_bindless{nullptr};
+    uint32_t particle_capacity{0};
+    Buffer particles[2];
+    Buffer key_buffer;
+    Buffer state_buffer;
+    uint32_t particle_handles[2]{Bindless::INVALID, Bindless::INVALID};
+    uint32_t key_handle{Bindless::INVALID};
+    uint32_t state_handle{Bindless::INVALID};
+    /* The state is zeroed by the first `simulate`, since device-local memory starts undefined. */
+    bool cleared{false};
+    /* The index of the buffer that `simulate` reads, which flips every frame */
+    uint32_t current{0};
+    float delta_time{0.0f};
+    float time{0.0f};
+    uint32_t emit_count{0};
+    /* The fraction of a particle left over from earlier frames' emission */
+    float emit_remainder{0.0f};
+    Unique_Pipeline_Layout pipeline_layout;
+    Pipelines pipelines;
+};
@@ -0,0 +1,437 @@
+#include "pipeline_library.hpp"
+
+/*
+    - `std::find` [[.](https://en.cppreference.com/w/cpp/algorithm/find.html)]
+*/
+#include <algorithm>
+/*
+    - `std::chrono::seconds` [[.](https://en.cppreference.com/w/cpp/chrono/duration.html)]
+*/
+#include <chrono>
+/*
+    - `offsetof` [[.](https://en.cppreference.com/w/cpp/types/offsetof.html)]
+*/
+#include <cstddef>
+/*
+    - `fprintf` [[.](https://en.cppreference.com/w/cpp/io/c/fprintf.html)]
+*/
+#include <cstdio>
+/*
+    - `std::exception` [[.](https://en.cppreference.com/w/cpp/error/exception.html)]
+*/
+#include <exception>
+/*
+    - `std::runtime_error` [[.](https://en.cppreference.com/w/cpp/error/runtime_error.html)]
+*/
+#include <stdexcept>
+
+#include "mesh.hpp"
+#include "profiler.hpp"
+
+namespace
+{
+    VkShaderModule create_shader_module(VkDevice device, const std::vector<char> &code)
+    {
+        VkShaderModule shader_module;
+
+        VkShaderModuleCreateInfo create_info{
+            .sType{VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO},
+            // .pNext{},
+            // .flags{},
+            .codeSize{code.size()},
+            .pCode{reinterpret_cast<const uint32_t *>(code.data())},
+        };
+
+        CHECK(vkCreateShaderModule(device, &create_info, nullptr, &shader_module));
+        return shader_module;
+    }
+}
+
+void Pipeline_Library::create(VkDevice device, Deletion_Queue *p_deletion_queue, Thread_Pool *p_thread_pool, Render_Graph *p_render_graph, VkPipelineCache pipeline_cache)
+{
+    this->device = device;
+    this->p_deletion_queue = p_deletion_queue;
+    this->p_thread_pool = p_thread_pool;
+    this->p_render_graph = p_render_graph;
+    this->pipeline_cache = pipeline_cache;
+}
+
+void Pipeline_Library::destroy()
+{
+    wait_idle();
+    retire_pipelines();
+    destroy_shader_modules();
+}
+
+uint32_t Pipeline_Library::shader(std::string_view name)
+{
+    std::lock_guard lock{shader_mutex};
+    auto it{std::find(shader_names.begin(), shader_names.end(), name)};
+    if (it != shader_names.end()) return static_cast<uint32_t>(it - shader_names.begin());
+    shader_names.emplace_back(name);
+    return static_cast<uint32_t>(shader_names.size() - 1);
+}
+
+Pipeline_Library::Staged Pipeline_Library::compile(const std::map<std::string, std::vector<char>> &code, std::span<const Pipeline_Key> required)
+{
+    PROFILE_FUNCTION();
+    std::vector<std::string> names;
+
+    {
+        std::lock_guard lock{shader_mutex};
+        names = shader_names;
+    }
+
+    Staged staged;
+    staged.keys.assign(required.begin(), required.end());
+    /* The jobs are given the handles, so they do not refer to `staged`, which may move. */
+    std::vector<VkShaderModule> new_shader_modules;
+
+    for (const auto &name : names)
+    {
+        auto it{code.find(name)};
+        staged.shader_modules.emplace_back(device, it == code.end() ? VK_NULL_HANDLE : create_shader_module(device, it->second));
+        new_shader_modules.push_back(staged.shader_modules.back());
+    }
+
+    /* Pipelines are compiled in parallel, one per job, since a driver compiles the pipelines of one call in turn. The cache is thread-safe. Render passes are looked up here, since the graph is not used from the pool. */
+    for (const auto &key : required)
+    {
+        staged.pipelines.push_back(p_thread_pool->submit([this, key, key_render_pass = render_pass(key), new_shader_modules]() {
+            PROFILE_ZONE("vkCreateGraphicsPipelines");
+            return Unique_Pipeline{device, create_pipeline(key, key_render_pass, new_shader_modules)};
+        }));
+    }
+
+    return staged;
+}
+
+void Pipeline_Library::wait(const Staged &staged)
+{
+    for (const auto &future : staged.pipelines) p_thread_pool->wait(future);
+}
+
+void Pipeline_Library::commit(Staged &&staged)
+{
+    PROFILE_FUNCTION();
+    wait(staged);
+    /* If one throws, the pipelines that were compiled are destroyed with `staged` or `pipelines`, since nothing has used them. */
+    std::vector<Unique_Pipeline> pipelines;
+    for (auto &future : staged.pipelines) pipelines.push_back(future.get());
+    /* Variant compiles use the modules that are replaced. */
+    wait_idle();
+    /* Pipelines that are ready may be in use by frames in flight, and the rest have no compile queued any more. */
+    retire_pipelines();
+    destroy_shader_modules();
+    for (auto &shader_module : staged.shader_modules) shader_modules.push_back(shader_module.release());
+
+    for (size_t i{0}; i < staged.keys.size(); i++)
+    {
+        Shard &key_shard{shard(staged.keys[i])};
+        std::lock_guard lock{key_shard.mutex};
+        auto [it, inserted]{key_shard.entries.try_emplace(staged.keys[i])};
+        /* A key that is required twice is compiled twice, and the second is destroyed with `pipelines`. */
+        if (!inserted) continue;
+        it->second.pipeline = pipelines[i].release();
+        it->second.state.store(State::READY, std::memory_order_release);
+        compiled_count.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+VkPipeline Pipeline_Library::get(const Pipeline_Key &key, const Pipeline_Key &fallback)
+{
+    Shard &key_shard{shard(key)};
+    Entry *p_entry;
+    bool inserted;
+
+    {
+        std::lock_guard lock{key_shard.mutex};
+        auto [it, it_inserted]{key_shard.entries.try_emplace(key)};
+        p_entry = &it->second;
+        inserted = it_inserted;
+    }
+
+    if (p_entry->state.load(std::memory_order_acquire) == State::READY) return p_entry->pipeline;
+
+    if (inserted)
+    {
+        VkRenderPass key_render_pass{render_pass(key)};
+        std::lock_guard lock{job_mutex};
+        std::erase_if(jobs, [](const std::future<void> &job) { return job.wait_for(std::chrono::seconds{0}) == std::future_status::ready; });
+
+        jobs.push_back(p_thread_pool->submit([this, p_entry, key, key_render_pass]() {
+            PROFILE_ZONE("pipeline variant");
+
+            try
+            {
+                p_entry->pipeline = create_pipeline(key, key_render_pass, shader_modules);
+                p_entry->state.store(State::READY, std::memory_order_release);
+                compiled_count.fetch_add(1, std::memory_order_relaxed);
+            }
+            catch (const std::exception &exception)
+            {
+                fprintf(stderr, "A pipeline variant failed to compile, so its fallback is used.\n%s", exception.what());
+                p_entry->state.store(State::FAILED, std::memory_order_release);
+            }
+        }));
+    }
+
+    Shard &fallback_shard{shard(fallback)};
+    std::lock_guard lock{fallback_shard.mutex};
+    auto it{fallback_shard.entries.find(fallback)};
+    if (it == fallback_shard.entries.end() || it->second.state.load(std::memory_order_acquire) != State::READY) throw std::runtime_error("A fallback pipeline is not ready.\n");
+    return it->second.pipeline;
+}
+
+void Pipeline_Library::wait_idle()
+{
+    while (true)
+    {
+        std::vector<std::future<void>> pending;
+
+        {
+            std::lock_guard lock{job_mutex};
+            pending.swap(jobs);
+        }
+
+        if (pending.empty()) return;
+        for (const auto &job : pending) p_thread_pool->wait(job);
+    }
+}
+
+VkRenderPass Pipeline_Library::render_pass(const Pipeline_Key &key) const
+{
+    std::vector<VkFormat> color_formats;
+    if (key.color_format != VK_FORMAT_UNDEFINED) color_formats.push_back(key.color_format);
+    return p_render_graph->compatible_render_pass(color_formats, key.depth_format);
+}
+
+void Pipeline_Library::retire_pipelines()
+{
+    for (auto &key_shard : shards)
+    {
+        std::lock_guard lock{key_shard.mutex};
+
+        for (auto &[key, entry] : key_shard.entries)
+        {
+            if (entry.state.load(std::memory_order_acquire) != State::READY) continue;
+            p_deletion_queue->push([device = device, pipeline = entry.pipeline] { vkDestroyPipeline(device, pipeline, nullptr); });
+        }
+
+        key_shard.entries.clear();
+    }
+}
+
+void Pipeline_Library::destroy_shader_modules()
+{
+    /* Pipelines do not need their modules once they are made. */
+    for (VkShaderModule shader_module : shader_modules) if (shader_module != VK_NULL_HANDLE) vkDestroyShaderModule(device, shader_module, nullptr);
+    shader_modules.clear();
+}
+
+/* Everything that is not in the key is the same for every pipeline: one sample, no stencil, and a dynamic viewport and scissor. */
+VkPipeline Pipeline_Library::create_pipeline(const Pipeline_Key &key, VkRenderPass render_pass, const std::vector<VkShaderModule> &shader_modules) const
+{
+    for (uint32_t id : {key.vertex_shader, key.fragment_shader})
+        if (id >= shader_modules.size() || shader_modules[id] == VK_NULL_HANDLE) throw std::runtime_error("A pipeline refers to a shader that was not loaded.\n");
+
+    VkSpecializationMapEntry map_entries[Pipeline_Key::MAX_CONSTANTS];
+    for (uint32_t i{0}; i < Pipeline_Key::MAX_CONSTANTS; i++) map_entries[i] = {i, i * static_cast<uint32_t>(sizeof(uint32_t)), sizeof(uint32_t)};
+
+    VkSpecializationInfo specialization_info{
+        .mapEntryCount{key.constant_count},
+        .pMapEntries{map_entries},
+        .dataSize{key.constant_count * sizeof(uint32_t)},
+        .pData{key.constants},
+    };
+
+    const VkSpecializationInfo *p_specialization_info{key.constant_count > 0 ? &specialization_info : nullptr};
+
+    VkPipelineShaderStageCreateInfo stages[]{
+        {
+            .sType{VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO},
+            // .pNext{},
+            // .flags{},
+            .stage{VK_SHADER_STAGE_VERTEX_BIT},
+            .module{shader_modules[key.vertex_shader]},
+            .pName{"main"},
+            .pSpecializationInfo{p_specialization_info},
+        },
+        {
+            .sType{VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO},
+            // .pNext{},
+            // .flags{},
+            .stage{VK_SHADER_STAGE_FRAGMENT_BIT},
+            .module{shader_modules[key.fragment_shader]},
+            .pName{"main"},
+            .pSpecializationInfo{p_specialization_info},
+        },
+    };
+
+    VkVertexInputBindingDescription mesh_binding{
+        .binding{0},
+        .stride{sizeof(Mesh_Vertex)},
+        .inputRate{VK_VERTEX_INPUT_RATE_VERTEX},
+    };
+
+    /* These match `Mesh_Vertex`; the formats do the dequantization, except for the bounds and the octahedral decode. */
+    VkVertexInputAttributeDescription mesh_attributes[]{
+        {
+            .location{0},
+            .binding{0},
+            .format{VK_FORMAT_R16G16B16A16_SNORM},
+            .offset{offsetof(Mesh_Vertex, position)},
+        },
+        {
+            .location{1},
+            .binding{0},
+            .format{VK_FORMAT_R16G16_SNORM},
+            .offset{offsetof(Mesh_Vertex, normal)},
+        },
+        {
+            .location{2},
+            .binding{0},
+            .format{VK_FORMAT_R16G16_SFLOAT},
+            .offset{offsetof(Mesh_Vertex, uv)},
+        },
+    };
+
+    bool mesh{key.vertex_layout == Pipeline_Key::Vertex_Layout::MESH};
+
+    VkPipelineVertexInputStateCreateInfo vertex_input_state{
+        .sType{VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO},
+        // .pNext{},
+        // .flags{},
+        .vertexBindingDescriptionCount{mesh ? 1u : 0u},
+        .pVertexBindingDescriptions{mesh ? &mesh_binding : nullptr},
+        .vertexAttributeDescriptionCount{mesh ? static_cast<uint32_t>(std::size(mesh_attributes)) : 0u},
+        .pVertexAttributeDescriptions{mesh ? mesh_attributes : nullptr},
+    };
+
+    VkPipelineInputAssemblyStateCreateInfo input_assembly_state{
+        .sType{VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO},
+        // .pNext{},
+        // .flags{},
+        .topology{key.topology},
+        .primitiveRestartEnable{VK_FALSE},
+    };
+
+    VkPipelineViewportStateCreateInfo viewport_state{
+        .sType{VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO},
+        // .pNext{},
+        // .flags{},
+        .viewportCount{1},
+        // .pViewports{},
+        .scissorCount{1},
+        // .pScissors{},
+    };
+
+    VkPipelineRasterizationStateCreateInfo rasterization_state{
+        .sType{VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO},
+        // .pNext{},
+        // .flags{},
+        .depthClampEnable{VK_FALSE},
+        .rasterizerDiscardEnable{VK_FALSE},
+        .polygonMode{VK_POLYGON_MODE_FILL},
+        .cullMode{key.cull_mode},
+        .frontFace{VK_FRONT_FACE_CLOCKWISE},
+        .depthBiasEnable{VK_FALSE},
+        /* This is optional. */ .depthBiasConstantFactor{0.0f},
+        /* This is optional. */ .depthBiasClamp{0.0f},
+        /* This is optional. */ .depthBiasSlopeFactor{0.0f},
+        .lineWidth{1.0f},
+    };
+
+    VkPipelineMultisampleStateCreateInfo multisample_state{
+        .sType{VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO},
+        // .pNext{},
+        // .flags{},
+        .rasterizationSamples{VK_SAMPLE_COUNT_1_BIT},
+        .sampleShadingEnable{VK_FALSE},
+        /* This is optional. */ .minSampleShading{1.0f},
+        /* This is optional. */ .pSampleMask{nullptr},
+        /* This is optional. */ .alphaToCoverageEnable{VK_FALSE},
+        /* This is optional. */ .alphaToOneEnable{VK_FALSE},
+    };
+
+    VkPipelineDepthStencilStateCreateInfo depth_stencil_state{
+        .sType{VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO},
+        // .pNext{},
+        // .flags{},
+        .depthTestEnable{key.depth_test},
+        .depthWriteEnable{key.depth_write},
+        .depthCompareOp{key.depth_compare},
+        .depthBoundsTestEnable{VK_FALSE},
+        .stencilTestEnable{VK_FALSE},
+        /* This is optional. */ .front{},
+        /* This is optional. */ .back{},
+        /* This is optional. */ .minDepthBounds{0.0f},
+        /* This is optional. */ .maxDepthBounds{1.0f},
+    };
+
+    /* Alpha is premultiplied by neither blend; additive light keeps the destination's alpha. */
+    bool additive{key.blend == Pipeline_Key::Blend::ADDITIVE};
+
+    VkPipelineColorBlendAttachmentState attachment{
+        .blendEnable{key.blend != Pipeline_Key::Blend::OPAQUE},
+        .srcColorBlendFactor{key.blend == Pipeline_Key::Blend::OPAQUE ? VK_BLEND_FACTOR_ONE : VK_BLEND_FACTOR_SRC_ALPHA},
+        .dstColorBlendFactor{key.blend == Pipeline_Key::Blend::OPAQUE ? VK_BLEND_FACTOR_ZERO : additive ? VK_BLEND_FACTOR_ONE : VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA},
+        .colorBlendOp{VK_BLEND_OP_ADD},
+        .srcAlphaBlendFactor{additive ? VK_BLEND_FACTOR_ZERO : VK_BLEND_FACTOR_ONE},
+        .dstAlphaBlendFactor{key.blend == Pipeline_Key::Blend::OPAQUE ? VK_BLEND_FACTOR_ZERO : additive ? VK_BLEND_FACTOR_ONE : VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA},
+        .alphaBlendOp{VK_BLEND_OP_ADD},
+        .colorWriteMask{VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT},
+    };
+
+    VkPipelineColorBlendStateCreateInfo color_blend_state{
+        .sType{VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO},
+        // .pNext{},
+        // .flags{},
+        .logicOpEnable{VK_FALSE},
+        /* This is optional. */ .logicOp{VK_LOGIC_OP_COPY},
+        .attachmentCount{key.color_format != VK_FORMAT_UNDEFINED ? 1u : 0u},
+        .pAttachments{&attachment},
+        .blendConstants{
+            /* This is optional. */ 0.0f,
+            /* This is optional. */ 0.0f,
+            /* This is optional. */ 0.0f,
+            /* This is optional. */ 0.0f,
+        },
+    };
+
+    VkDynamicState dynamic_states[]{VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+
+    VkPipelineDynamicStateCreateInfo dynamic_state{
+        .sType{VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO},
+        // .pNext{},
+        // .flags{},
+        .dynamicStateCount{static_cast<uint32_t>(std::size(dynamic_states))},
+        .pDynamicStates{dynamic_states},
+    };
+
+    VkGraphicsPipelineCreateInfo create_info{
+        .sType{VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO},
+        // .pNext{},
+        // .flags{},
+        .stageCount{2},
+        .pStages{stages},
+        .pVertexInputState{&vertex_input_state},
+        .pInputAssemblyState{&input_assembly_state},
+        // .pTessellationState{},
+        .pViewportState{&viewport_state},
+        .pRasterizationState{&rasterization_state},
+        .pMultisampleState{&multisample_state},
+        .pDepthStencilState{&depth_stencil_state},
+        .pColorBlendState{&color_blend_state},
+        .pDynamicState{&dynamic_state},
+        .layout{key.layout},
+        .renderPass{render_pass},
+        .subpass{0},
+        /* This is optional. */ .basePipelineHandle{VK_NULL_HANDLE},
+        /* This is optional. */ .basePipelineIndex{-1},
+    };
+
+    VkPipeline pipeline;
+    CHECK(vkCreateGraphicsPipelines(device, pipeline_cache, 1, &create_info, nullptr, &pipeline));
+    return pipeline;
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+/*
+    - `std::atomic` [[.](https://en.cppreference.com/w/cpp/atomic/atomic.html)]
+*/
+#include <atomic>
+/*
+    - `std::future` [[.](https://en.cppreference.com/w/cpp/thread/future.html)]
+*/
+#include <future>
+/*
+    - `std::map` [[.](https://en.cppreference.com/w/cpp/container/map.html)]
+*/
+#include <map>
+/*
+    - `std::mutex` [[.](https://en.cppreference.com/w/cpp/thread/mutex.html)]
+*/
+#include <mutex>
+/*
+    - `std::span` [[.](https://en.cppreference.com/w/cpp/container/span.html)]
+*/
+#include <span>
+/*
+    - `std::string` [[.](https://en.cppreference.com/w/cpp/string/basic_string.html)]
+*/
+#include <string>
+/*
+    - `std::string_view` [[.](https://en.cppreference.com/w/cpp/string/basic_string_view.html)]
+*/
+#include <string_view>
+/*
+    - `std::has_unique_object_representations_v` [[.](https://en.cppreference.com/w/cpp/types/has_unique_object_representations.html)]
+*/
+#include <type_traits>
+/*
+    - `std::unordered_map` [[.](https://en.cppreference.com/w/cpp/container/unordered_map.html)]
+*/
+#include <unordered_map>
+/*
+    - `std::vector` [[.](https://en.cppreference.com/w/cpp/container/vector.html)]
+*/
+#include <vector>
+
+#include "common.hpp"
+#include "deletion_queue.hpp"
+#include "render_graph.hpp"
+#include "thread_pool.hpp"
+
+/* Everything that a graphics pipeline is made from. It has no padding, so it is hashed and compared as bytes. */
+struct Pipeline_Key
+{
+    static constexpr uint32_t MAX_CONSTANTS{4};
+
+    enum class Vertex_Layout : uint32_t
+    {
+        /* Vertices come from the vertex index alone. */
+        NONE,
+        /* One binding of `Mesh_Vertex` */
+        MESH,
+    };
+
+    enum class Blend : uint32_t
+    {
+        OPAQUE,
+        ALPHA,
+        ADDITIVE,
+    };
+
+    VkPipelineLayout layout{VK_NULL_HANDLE};
+    /* `Pipeline_Library::shader` IDs */
+    uint32_t vertex_shader{0};
+    uint32_t fragment_shader{0};
+    /* Both stages see `constants[i]` as `constant_id = i`, for the first `constant_count`, so unused ones must stay `0` for keys to match. */
+    uint32_t constant_count{0};
+    uint32_t constants[MAX_CONSTANTS]{};
+    Vertex_Layout vertex_layout{Vertex_Layout::NONE};
+    Blend blend{Blend::OPAQUE};
+    VkPrimitiveTopology topology{VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST};
+    VkCullModeFlags cull_mode{VK_CULL_MODE_BACK_BIT};
+    VkBool32 depth_test{VK_FALSE};
+    VkBool32 depth_write{VK_FALSE};
+    VkCompareOp depth_compare{VK_COMPARE_OP_LESS};
+    /* The render pass is the graph's compatible one for these; either may be `VK_FORMAT_UNDEFINED`. */
+    VkFormat color_format{VK_FORMAT_UNDEFINED};
+    VkFormat depth_format{VK_FORMAT_UNDEFINED};
+
+    bool operator==(const Pipeline_Key &) const = default;
+};
+
+static_assert(std::has_unique_object_representations_v<Pipeline_Key>);
+
+/*
+    Graphics pipelines made on demand from a `Pipeline_Key`, so that variants of a material, such as those of its specialization constants, are only compiled once something draws with them. Each key is compiled once, on the thread pool, and until it is ready the caller draws with a fallback that is, so a new variant never stalls a frame.
+
+    Pipelines are kept in a hash map that is split into shards, each with its own lock, so that requests from several threads rarely wait on each other. Shader modules are owned by the library and replaced together by `commit`.
+*/
+class Pipeline_Library
+{
+    public:
+    /* The render graph is only used by the threads that request pipelines, never by the pool. */
+    void create(VkDevice, Deletion_Queue *, Thread_Pool *, Render_Graph *, VkPipelineCache);
+    void destroy();
+    /* The ID of the shader called `name`, which is kept across reloads, so keys stay valid. */
+    uint32_t shader(std::string_view name);
+    /* Modules and pipelines that `compile` makes, which only become the library's in `commit`. The jobs refer to the modules, so they are waited for before this is dropped. */
+    struct Staged
+    {
+        std::vector<Unique_Shader_Module> shader_modules;
+        std::vector<Pipeline_Key> keys;
+        std::vector<std::future<Unique_Pipeline>> pipelines;
+    };
+
+    /* This makes modules from `code`, which is by name, and queues a job per pipeline in `required` that compiles it with them, without changing the library, so other work can be compiled alongside. It throws if a module cannot be made. */
+    Staged compile(const std::map<std::string, std::vector<char>> &code, std::span<const Pipeline_Key> required);
+    /* This runs queued jobs on the calling thread until every staged job is done, whether it succeeded or not. */
+    void wait(const Staged &);
+    /*
+        If a staged pipeline failed to compile, this throws, and the library is left as it was. Otherwise, every older pipeline is retired, the staged modules replace the library's, and the required pipelines are ready, to be used as fallbacks.
+
+        This waits for the compiles that are queued, so it is not called while other threads request pipelines.
+    */
+    void commit(Staged &&);
+    /* The pipeline for `key` if it is ready. Otherwise its compile is queued, once, and `fallback`'s pipeline is returned, which must be ready. A key that fails to compile is reported once and falls back from then on. */
+    VkPipeline get(const Pipeline_Key &key, const Pipeline_Key &fallback);
+    /* This runs queued compiles on the calling thread until none are left. */
+    void wait_idle();
+    uint32_t compiled() const { return compiled_count.load(std::memory_order_relaxed); }
+
+    private:
+    static constexpr uint32_t SHARD_COUNT{16};
+
+    struct Key_Hash
+    {
+        size_t operator()(const Pipeline_Key &key) const { return std::hash<std::string_view>{}({reinterpret_cast<const char *>(&key), sizeof(key)}); }
+    };
+
+    enum class State : uint32_t
+    {
+        PENDING,
+        READY,
+        FAILED,
+    };
+
+    /* `pipeline` is written before `state` becomes `READY`, and never after. */
+    struct Entry
+    {
+        std::atomic<State> state{State::PENDING};
+        VkPipeline pipeline{VK_NULL_HANDLE};
+    };
+
+    /* Entries are never moved, since the map's nodes keep their addresses, so jobs refer to them outside of the lock. */
+    struct Shard
+    {
+        std::mutex mutex;
+        std::unordered_map<Pipeline_Key, Entry, Key_Hash> entries;
+    };
+
+    Shard &shard(const Pipeline_Key &key) { return shards[Key_Hash{}(key) % SHARD_COUNT]; }
+    VkPipeline create_pipeline(const Pipeline_Key &, VkRenderPass, const std::vector<VkShaderModule> &shader_modules) const;
+    VkRenderPass render_pass(const Pipeline_Key &key) const;
+    void retire_pipelines();
+    void destroy_shader_modules();
+
+    VkDevice device{VK_NULL_HANDLE};
+    Deletion_Queue *p_deletion_queue{nullptr};
+    Thread_Pool *p_thread_pool{nullptr};
+    Render_Graph *p_render_graph{nullptr};
+    VkPipelineCache pipeline_cache{VK_NULL_HANDLE};
+    Shard shards[SHARD_COUNT];
+    /* Shader IDs index both of these; a module is `VK_NULL_HANDLE` if the last commit had no code for it. */
+    std::mutex shader_mutex;
+    std::vector<std::string> shader_names;
+    std::vector<VkShaderModule> shader_modules;
+    std::mutex job_mutex;
+    std::vector<std::future<void>> jobs;
+    std::atomic<uint32_t> compiled_count{0};
+};
@@ -0,0 +1,388 @@
+#include "profiler.hpp"
+
+/*
+    - `std::max` [[.](https://en.cppreference.com/w/cpp/algorithm/max.html)]
+*/
+#include <algorithm>
+/*
+    - `std::atomic` [[.](https://en.cppreference.com/w/cpp/atomic/atomic.html)]
+*/
+#include <atomic>
+/*
+    - `std::chrono::steady_clock` [[.](https://en.cppreference.com/w/cpp/chrono/steady_clock.html)]
+*/
+#include <chrono>
+/*
+    - `std::ofstream` [[.](https://en.cppreference.com/w/cpp/io/basic_ofstream.html)]
+*/
+#include <fstream>
+/*
+    - `std::equal_to` [[.](https://en.cppreference.com/w/cpp/utility/functional/equal_to.html)]
+*/
+#include <functional>
+/*
+    - `std::setprecision` [[.](https://en.cppreference.com/w/cpp/io/manip/setprecision.html)]
+*/
+#include <iomanip>
+/*
+    - `std::unique_ptr` [[.](https://en.cppreference.com/w/cpp/memory/unique_ptr.html)]
+*/
+#include <memory>
+/*
+    - `std::mutex` [[.](https://en.cppreference.com/w/cpp/thread/mutex.html)]
+*/
+#include <mutex>
+/*
+    - `std::runtime_error` [[.](https://en.cppreference.com/w/cpp/error/runtime_error.html)]
+*/
+#include <stdexcept>
+/*
+    - `std::string_view` [[.](https://en.cppreference.com/w/cpp/string/basic_string_view.html)]
+*/
+#include <string_view>
+/*
+    - `std::unordered_set` [[.](https://en.cppreference.com/w/cpp/container/unordered_set.html)]
+*/
+#include <unordered_set>
+
+#include "arena.hpp"
+
+namespace
+{
+    struct Event
+    {
+        const char *name;
+        int64_t begin;
+        int64_t end;
+    };
+
+    /* Zones per track; the oldest are overwritten past this. */
+    constexpr uint64_t CAPACITY{1 << 16};
+
+    /* The zones of one thread, or of the GPU. Only the owner writes `events` and `head`; readers copy and then check `head` again for what was overwritten meanwhile. */
+    struct Track
+    {
+        std::string name;
+        uint32_t process;
+        uint32_t thread;
+        std::unique_ptr<Event[]> events{std::make_unique<Event[]>(CAPACITY)};
+        std::atomic<uint64_t> head{0};
+    };
+
+    /* Names are looked up by `std::string_view`, so interning one that exists allocates nothing. */
+    struct Name_Hash
+    {
+        using is_transparent = void;
+
+        size_t operator()(std::string_view name) const { return std::hash<std::string_view>{}(name); }
+    };
+
+    struct Registry
+    {
+        /* This is only taken when a track is added or named, when a name is interned, and when a trace is written. */
+        std::mutex mutex;
+        /* Tracks outlive their threads, so that their zones are still written. */
+        std::vector<std::unique_ptr<Track>> tracks;
+        std::unordered_set<std::string, Name_Hash, std::equal_to<>> names;
+    };
+
+    Registry &registry()
+    {
+        static Registry registry;
+        return registry;
+    }
+
+    Track *add_track(const std::string &name, uint32_t process)
+    {
+        Registry &r{registry()};
+        std::lock_guard lock{r.mutex};
+        Track *p_track{r.tracks.emplace_back(std::make_unique<Track>()).get()};
+        p_track->name = name;
+        p_track->process = process;
+        p_track->thread = static_cast<uint32_t>(r.tracks.size() - 1);
+        return p_track;
+    }
+
+    Track &thread_track()
+    {
+        thread_local Track *p_track{add_track("", 0)};
+        return *p_track;
+    }
+
+    Track &gpu_track()
+    {
+        static Track *p_track{add_track("GPU", 1)};
+        return *p_track;
+    }
+
+    void push(Track &track, const Event &event)
+    {
+        uint64_t head{track.head.load(std::memory_order_relaxed)};
+        track.events[head % CAPACITY] = event;
+        track.head.store(head + 1, std::memory_order_release);
+    }
+
+    std::string escape(const std::string &text)
+    {
+        std::string result;
+
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\') result += '\\';
+            if (static_cast<unsigned char>(c) < 0x20) c = ' ';
+            result += c;
+        }
+
+        return result;
+    }
+}
+
+int64_t Profiler::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Profiler::name_thread(const std::string &name)
+{
+    Track &track{thread_track()};
+    std::lock_guard lock{registry().mutex};
+    track.name = name;
+}
+
+void Profiler::record(const char *name, int64_t begin, int64_t end)
+{
+    push(thread_track(), {name, begin, end});
+}
+
+void Profiler::record_gpu(const char *name, int64_t begin, int64_t end)
+{
+    push(gpu_track(), {name, begin, end});
+}
+
+const char *Profiler::intern(std::string_view name)
+{
+    Registry &r{registry()};
+    std::lock_guard lock{r.mutex};
+    if (auto it{r.names.find(name)}; it != r.names.end()) return it->c_str();
+    /* Elements of an `std::unordered_set` never move. */
+    return r.names.emplace(name).first->c_str();
+}
+
+void Profiler::write_trace(const std::string &path)
+{
+    std::ofstream file(path);
+    if (!file.is_open()) throw std::runtime_error("`" + path + "` could not be opened.\n");
+    /* The GPU track exists even before the first GPU zone. */
+    gpu_track();
+    Registry &r{registry()};
+    std::lock_guard lock{r.mutex};
+    /* Times are in microseconds. */
+    file << std::fixed << std::setprecision(3) << "{\"traceEvents\":[\n";
+    file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"CPU\"}},\n";
+    file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"GPU\"}}";
+
+    for (const auto &p_track : r.tracks)
+    {
+        const Track &track{*p_track};
+        std::string name{track.name.empty() ? "thread " + std::to_string(track.thread) : track.name};
+        file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << track.process << ",\"tid\":" << track.thread << ",\"args\":{\"name\":\"" << escape(name) << "\"}}";
+        uint64_t end{track.head.load(std::memory_order_acquire)};
+        uint64_t begin{end > CAPACITY ? end - CAPACITY : 0};
+        std::vector<Event> events;
+        events.reserve(end - begin);
+        for (uint64_t i{begin}; i < end; i++) events.push_back(track.events[i % CAPACITY]);
+        /* The owner may have wrapped around while these were copied, and may be writing the next slot now. */
+        uint64_t head{track.head.load(std::memory_order_acquire)};
+        uint64_t valid{head + 1 > CAPACITY ? head + 1 - CAPACITY : 0};
+
+        for (uint64_t i{std::max(begin, valid)}; i < end; i++)
+        {
+            const Event &event{events[i - begin]};
+            file << ",\n{\"name\":\"" << escape(event.name) << "\",\"ph\":\"X\",\"pid\":" << track.process << ",\"tid\":" << track.thread << ",\"ts\":" << static_cast<double>(event.begin) * 1e-3 << ",\"dur\":" << static_cast<double>(event.end - event.begin) * 1e-3 << "}";
+        }
+    }
+
+    file << "\n],\"displayTimeUnit\":\"ns\"}\n";
+}
+
+void Gpu_Profiler::create(VkInstance instance, VkPhysicalDevice physical_device, VkDevice device, uint32_t queue_family_index, bool calibrated_timestamps, uint32_t frame_count)
+{
+    this->device = device;
+    uint32_t count{0};
+    vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &count, nullptr);
+    std::vector<VkQueueFamilyProperties> queue_families(count);
+    vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &count, queue_families.data());
+    uint32_t valid_bits{queue_families[queue_family_index].timestampValidBits};
+    /* Without timestamps on the queue, no zones are recorded. */
+    if (valid_bits == 0) return;
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physical_device, &properties);
+    period = properties.limits.timestampPeriod;
+    mask = valid_bits == 64 ? ~0ull : (1ull << valid_bits) - 1;
+    frames.resize(frame_count);
+
+    VkQueryPoolCreateInfo create_info{
+        .sType{VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO},
+        // .pNext{},
+        // .flags{},
+        .queryType{VK_QUERY_TYPE_TIMESTAMP},
+        .queryCount{frame_count * MAX_QUERIES},
+        // .pipelineStatistics{},
+    };
+
+    CHECK(vkCreateQueryPool(device, &create_info, nullptr, &query_pool));
+    if (!calibrated_timestamps) return;
+    /* Extension commands are not exported by the loader. */
+    auto p_get_time_domains{reinterpret_cast<PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT>(vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceCalibrateableTimeDomainsEXT"))};
+    p_get_calibrated_timestamps = reinterpret_cast<PFN_vkGetCalibratedTimestampsEXT>(vkGetDeviceProcAddr(device, "vkGetCalibratedTimestampsEXT"));
+
+    if (p_get_time_domains == nullptr || p_get_calibrated_timestamps == nullptr)
+    {
+        p_get_calibrated_timestamps = nullptr;
+        return;
+    }
+
+    uint32_t domain_count{0};
+    p_get_time_domains(physical_device, &domain_count, nullptr);
+    std::vector<VkTimeDomainEXT> domains(domain_count);
+    p_get_time_domains(physical_device, &domain_count, domains.data());
+    bool device_domain{false};
+
+    for (VkTimeDomainEXT domain : domains)
+    {
+        if (domain == VK_TIME_DOMAIN_DEVICE_EXT) device_domain = true;
+#ifdef __linux__
+        /* Elsewhere, `std::chrono::steady_clock` may be another clock. */
+        if (domain == VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT) monotonic = true;
+#endif /* __linux__ */
+    }
+
+    if (!device_domain) p_get_calibrated_timestamps = nullptr;
+}
+
+void Gpu_Profiler::destroy()
+{
+    if (query_pool != VK_NULL_HANDLE) vkDestroyQueryPool(device, query_pool, nullptr);
+    query_pool = VK_NULL_HANDLE;
+    frames.clear();
+}
+
+void Gpu_Profiler::begin_frame(VkCommandBuffer command_buffer, uint32_t frame)
+{
+    if (query_pool == VK_NULL_HANDLE) return;
+    current_frame = frame;
+    Frame &f{frames[frame]};
+    /* The fence for this slot has been waited on, so its queries have results. */
+    read_back(f, frame * MAX_QUERIES);
+    f.zones.clear();
+    f.query_count = 0;
+    open_zones.clear();
+    pending_ends = 0;
+    vkCmdResetQueryPool(command_buffer, query_pool, frame * MAX_QUERIES, MAX_QUERIES);
+}
+
+void Gpu_Profiler::submit()
+{
+    if (query_pool == VK_NULL_HANDLE) return;
+    frames[current_frame].submitted = Profiler::now();
+}
+
+void Gpu_Profiler::begin_zone(VkCommandBuffer command_buffer, const char *name)
+{
+    if (query_pool == VK_NULL_HANDLE) return;
+    Frame &f{frames[current_frame]};
+
+    /* Each zone needs its own query and one for its end, besides those of the zones that are still open. */
+    if (f.query_count + pending_ends + 2 > MAX_QUERIES)
+    {
+        open_zones.push_back(~0u);
+        return;
+    }
+
+    open_zones.push_back(static_cast<uint32_t>(f.zones.size()));
+    f.zones.push_back({name, f.query_count, ~0u});
+    vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, query_pool, current_frame * MAX_QUERIES + f.query_count++);
+    pending_ends++;
+}
+
+void Gpu_Profiler::end_zone(VkCommandBuffer command_buffer)
+{
+    if (query_pool == VK_NULL_HANDLE || open_zones.empty()) return;
+    uint32_t zone{open_zones.back()};
+    open_zones.pop_back();
+    if (zone == ~0u) return;
+    Frame &f{frames[current_frame]};
+    f.zones[zone].end_query = f.query_count;
+    vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, query_pool, current_frame * MAX_QUERIES + f.query_count++);
+    pending_ends--;
+}
+
+void Gpu_Profiler::read_back(Frame &f, uint32_t first_query)
+{
+    if (f.query_count == 0) return;
+    std::pmr::vector<uint64_t> ticks(f.query_count, Frame_Arena::resource());
+    if (vkGetQueryPoolResults(device, query_pool, first_query, f.query_count, ticks.size() * sizeof(uint64_t), ticks.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) return;
+    for (auto &t : ticks) t &= mask;
+    /* A duration needs no calibration. */
+    const Zone &first{f.zones[0]};
+    if (first.end_query != ~0u) last_frame_time = static_cast<int64_t>(static_cast<double>((ticks[first.end_query] - ticks[first.begin_query]) & mask) * period);
+
+    if (p_get_calibrated_timestamps != nullptr)
+    {
+        calibrate();
+    }
+    else
+    {
+        /* The first zone is the frame's earliest, and it cannot have started before the frame was submitted. */
+        uint64_t start{ticks[f.zones[0].begin_query]};
+
+        if (!calibrated || to_cpu(start) < f.submitted)
+        {
+            calibration_time = f.submitted;
+            calibration_ticks = start;
+            calibrated = true;
+        }
+    }
+
+    if (!calibrated) return;
+
+    for (const auto &zone : f.zones)
+    {
+        /* A zone that was never ended has no end to show. */
+        if (zone.end_query == ~0u) continue;
+        Profiler::record_gpu(zone.name, to_cpu(ticks[zone.begin_query]), to_cpu(ticks[zone.end_query]));
+    }
+}
+
+void Gpu_Profiler::calibrate()
+{
+    VkCalibratedTimestampInfoEXT infos[]{
+        {
+            .sType{VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT},
+            // .pNext{},
+            .timeDomain{VK_TIME_DOMAIN_DEVICE_EXT},
+        },
+        {
+            .sType{VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT},
+            // .pNext{},
+            .timeDomain{VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT},
+        },
+    };
+
+    uint64_t timestamps[2];
+    uint64_t max_deviation;
+    int64_t before{Profiler::now()};
+    if (p_get_calibrated_timestamps(device, monotonic ? 2 : 1, infos, timestamps, &max_deviation) != VK_SUCCESS) return;
+    int64_t after{Profiler::now()};
+    calibration_ticks = timestamps[0] & mask;
+    /* Without the host clock, the device clock was sampled somewhere between the two reads of ours. */
+    calibration_time = monotonic ? static_cast<int64_t>(timestamps[1]) : before + (after - before) / 2;
+    calibrated = true;
+}
+
+int64_t Gpu_Profiler::to_cpu(uint64_t ticks) const
+{
+    /* Ticks before the calibration are negative. */
+    int64_t delta{static_cast<int64_t>(ticks - calibration_ticks)};
+    return calibration_time + static_cast<int64_t>(static_cast<double>(delta) * period);
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+/*
+    - `std::string` [[.](https://en.cppreference.com/w/cpp/string/basic_string.html)]
+*/
+#include <string>
+/*
+    - `std::string_view` [[.](https://en.cppreference.com/w/cpp/string/basic_string_view.html)]
+*/
+#include <string_view>
+/*
+    - `std::vector` [[.](https://en.cppreference.com/w/cpp/container/vector.html)]
+*/
+#include <vector>
+
+#include "common.hpp"
+
+/*
+    Zones of CPU and GPU time on one timeline, which is written as a Chrome trace on demand. Every thread records into its own ring of the most recent zones without locking, so zones are cheap enough to leave in, and old ones are overwritten rather than stalling anything.
+
+    Times are nanoseconds of `std::chrono::steady_clock`, which is `CLOCK_MONOTONIC` on Linux.
+*/
+class Profiler
+{
+    public:
+    static int64_t now();
+    /* Threads appear in the trace by this name, or by number if they have none. */
+    static void name_thread(const std::string &);
+    /* `name` must live until the trace is written, as string literals and `intern`ed names do. */
+    static void record(const char *name, int64_t begin, int64_t end);
+    /* Zones on the GPU, already moved onto the CPU timeline */
+    static void record_gpu(const char *name, int64_t begin, int64_t end);
+    static const char *intern(std::string_view);
+    /* This writes the trace event format, which `chrome://tracing` and Perfetto open. Zones that are being overwritten while it runs are left out. */
+    static void write_trace(const std::string &path);
+};
+
+/* A zone from construction to destruction, on the calling thread */
+class Profile_Zone
+{
+    public:
+    explicit Profile_Zone(const char *name) : name{name}, begin{Profiler::now()} {}
+    Profile_Zone(const Profile_Zone &) = delete;
+    Profile_Zone &operator=(const Profile_Zone &) = delete;
+    ~Profile_Zone() { Profiler::record(name, begin, Profiler::now()); }
+
+    private:
+    const char *name;
+    int64_t begin;
+};
+
+// clang-format off
+#define PROFILE_CONCATENATE_(A, B) A##B
+#define PROFILE_CONCATENATE(A, B) PROFILE_CONCATENATE_(A, B)
+#define PROFILE_ZONE(NAME) Profile_Zone PROFILE_CONCATENATE(profile_zone_, __LINE__){NAME}
+#define PROFILE_FUNCTION() PROFILE_ZONE(__func__)
+// clang-format on
+
+/*
+    Zones in command buffers, measured with timestamp queries. Each frame slot has its own range of queries, which is read back when the slot is recorded again, after its fence.
+
+    Device ticks are moved onto the CPU timeline with `VK_EXT_calibrated_timestamps` when the device has it, which samples both clocks at once. Otherwise, since GPU work cannot start before it is submitted, each frame's submission bounds the offset between the clocks from below, and the tightest bound is kept.
+*/
+class Gpu_Profiler
+{
+    public:
+    void create(VkInstance, VkPhysicalDevice, VkDevice, uint32_t queue_family_index, bool calibrated_timestamps, uint32_t frame_count);
+    void destroy();
+    /* This is recorded first in the command buffer for `frame`. */
+    void begin_frame(VkCommandBuffer, uint32_t frame);
+    /* This is called right before the frame is submitted. */
+    void submit();
+    /* Zones nest. `name` must live until the trace is written, as it does for `Profile_Zone`. */
+    void begin_zone(VkCommandBuffer, const char *name);
+    void end_zone(VkCommandBuffer);
+    /* The duration of the first zone of the latest frame that was read back, in nanoseconds, or `0` before there is one */
+    int64_t frame_time() const { return last_frame_time; }
+
+    private:
+    static constexpr uint32_t MAX_QUERIES{256};
+
+    struct Zone
+    {
+        const char *name;
+        uint32_t begin_query;
+        uint32_t end_query;
+    };
+
+    struct Frame
+    {
+        std::vector<Zone> zones;
+        uint32_t query_count{0};
+        int64_t submitted{0};
+    };
+
+    void read_back(Frame &, uint32_t first_query);
+    void calibrate();
+    int64_t to_cpu(uint64_t ticks) const;
+
+    VkDevice device{VK_NULL_HANDLE};
+    VkQueryPool query_pool{VK_NULL_HANDLE};
+    std::vector<Frame> frames;
+    uint32_t current_frame{0};
+    /* Indices into the frame's zones, or `~0u` for zones that did not fit */
+    std::vector<uint32_t> open_zones;
+    /* Queries kept back for the ends of open zones */
+    uint32_t pending_ends{0};
+    /* Nanoseconds per tick, and the bits of a timestamp that count */
+    double period{1.0};
+    uint64_t mask{~0ull};
+    PFN_vkGetCalibratedTimestampsEXT p_get_calibrated_timestamps{nullptr};
+    /* Whether the host side of a calibration is `CLOCK_MONOTONIC`, which is the clock of `Profiler::now` on Linux */
+    bool monotonic{false};
+    /* A moment on both clocks */
+    bool calibrated{false};
+    int64_t calibration_time{0};
+    uint64_t calibration_ticks{0};
+    int64_t last_frame_time{0};
+};
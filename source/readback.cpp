@@ -0,0 +1,187 @@
+#include "readback.hpp"
+
+/*
+    - `std::chrono::seconds` [[.](https://en.cppreference.com/w/cpp/chrono/duration.html)]
+*/
+#include <chrono>
+/*
+    - `fprintf` [[.](https://en.cppreference.com/w/cpp/io/c/fprintf.html)]
+*/
+#include <cstdio>
+/*
+    - `std::exception` [[.](https://en.cppreference.com/w/cpp/error/exception.html)]
+*/
+#include <exception>
+
+void Readback::create(VkPhysicalDevice physical_device, VkDevice device, Thread_Pool *p_thread_pool, uint32_t frame_count, uint32_t buffer_count)
+{
+    this->physical_device = physical_device;
+    this->device = device;
+    this->p_thread_pool = p_thread_pool;
+    this->frame_count = frame_count;
+    slots = std::vector<Slot>(buffer_count);
+    memory_properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    VkPhysicalDeviceMemoryProperties properties;
+    vkGetPhysicalDeviceMemoryProperties(physical_device, &properties);
+
+    for (uint32_t i{0}; i < properties.memoryTypeCount; i++)
+    {
+        constexpr VkMemoryPropertyFlags CACHED{VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT};
+        if ((properties.memoryTypes[i].propertyFlags & CACHED) == CACHED) memory_properties = CACHED;
+    }
+}
+
+void Readback::destroy()
+{
+    for (auto &slot : slots)
+    {
+        if (slot.recorded) start(slot);
+    }
+
+    for (auto &slot : slots)
+    {
+        /* The pool may be busy with other jobs, so this helps rather than waiting idly. */
+        if (slot.job.valid()) p_thread_pool->wait(slot.job);
+        if (slot.buffer.buffer != VK_NULL_HANDLE) destroy_buffer(device, slot.buffer);
+    }
+
+    slots.clear();
+}
+
+void Readback::begin_frame(uint64_t frame)
+{
+    current_frame = frame;
+    if (frame < frame_count) return;
+    /* Every frame up to this one has completed. */
+    uint64_t completed{frame - frame_count};
+
+    for (auto &slot : slots)
+    {
+        if (slot.recorded && slot.frame <= completed) start(slot);
+    }
+}
+
+bool Readback::available() const
+{
+    for (const auto &slot : slots)
+    {
+        if (free(slot)) return true;
+    }
+
+    return false;
+}
+
+bool Readback::copy(VkCommandBuffer command_buffer, VkImage image, VkFormat format, VkExtent2D extent, Callback callback)
+{
+    if (texel_size(format) == 0) throw std::runtime_error("Images of this format cannot be read back.\n");
+    Slot *p_slot{nullptr};
+
+    for (auto &slot : slots)
+    {
+        if (!free(slot)) continue;
+        p_slot = &slot;
+        break;
+    }
+
+    if (p_slot == nullptr)
+    {
+        dropped_count++;
+        return false;
+    }
+
+    VkDeviceSize size{static_cast<VkDeviceSize>(extent.width) * extent.height * texel_size(format)};
+
+    /* The buffer only grows; it is free, so nothing on the device uses it. */
+    if (p_slot->buffer.size < size)
+    {
+        if (p_slot->buffer.buffer != VK_NULL_HANDLE) destroy_buffer(device, p_slot->buffer);
+        p_slot->buffer = create_buffer(physical_device, device, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, memory_properties);
+    }
+
+    VkBufferImageCopy region{
+        .bufferOffset{0},
+        /* Zero means tightly packed. */
+        .bufferRowLength{0},
+        .bufferImageHeight{0},
+        .imageSubresource{
+            .aspectMask{VK_IMAGE_ASPECT_COLOR_BIT},
+            .mipLevel{0},
+            .baseArrayLayer{0},
+            .layerCount{1},
+        },
+        .imageOffset{0, 0, 0},
+        .imageExtent{extent.width, extent.height, 1},
+    };
+
+    vkCmdCopyImageToBuffer(command_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, p_slot->buffer.buffer, 1, &region);
+
+    /* The fence does not make device writes visible to the host by itself. */
+    VkBufferMemoryBarrier barrier{
+        .sType{VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER},
+        // .pNext{},
+        .srcAccessMask{VK_ACCESS_TRANSFER_WRITE_BIT},
+        .dstAccessMask{VK_ACCESS_HOST_READ_BIT},
+        .srcQueueFamilyIndex{VK_QUEUE_FAMILY_IGNORED},
+        .dstQueueFamilyIndex{VK_QUEUE_FAMILY_IGNORED},
+        .buffer{p_slot->buffer.buffer},
+        .offset{0},
+        .size{size},
+    };
+
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+    p_slot->recorded = true;
+    p_slot->frame = current_frame;
+    p_slot->format = format;
+    p_slot->extent = extent;
+    p_slot->callback = std::move(callback);
+    return true;
+}
+
+uint32_t Readback::texel_size(VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+    case VK_FORMAT_A2B10G10R10_UNORM_PACK32:
+    case VK_FORMAT_A2R10G10B10_UNORM_PACK32:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+bool Readback::free(const Slot &slot)
+{
+    return !slot.recorded && (!slot.job.valid() || slot.job.wait_for(std::chrono::seconds{0}) == std::future_status::ready);
+}
+
+void Readback::start(Slot &slot)
+{
+    /* Memory that is not coherent must be invalidated before the host reads it, and invalidating coherent memory does no harm. */
+    VkMappedMemoryRange range{
+        .sType{VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE},
+        // .pNext{},
+        .memory{slot.buffer.memory},
+        .offset{0},
+        .size{VK_WHOLE_SIZE},
+    };
+
+    CHECK(vkInvalidateMappedMemoryRanges(device, 1, &range));
+    slot.recorded = false;
+    Image image{static_cast<const uint8_t *>(slot.buffer.p_mapped), slot.format, slot.extent, slot.frame};
+
+    /* Nothing waits on the job, so its exceptions are reported here. */
+    slot.job = p_thread_pool->submit([&slot, image]() {
+        try
+        {
+            slot.callback(image);
+        }
+        catch (const std::exception &exception)
+        {
+            fprintf(stderr, "%s", exception.what());
+        }
+    });
+}
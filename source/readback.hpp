@@ -0,0 +1,79 @@
+#pragma once
+
+/*
+    - `std::function` [[.](https://en.cppreference.com/w/cpp/utility/functional/function.html)]
+*/
+#include <functional>
+/*
+    - `std::future` [[.](https://en.cppreference.com/w/cpp/thread/future.html)]
+*/
+#include <future>
+/*
+    - `std::vector` [[.](https://en.cppreference.com/w/cpp/container/vector.html)]
+*/
+#include <vector>
+
+#include "buffer.hpp"
+#include "common.hpp"
+#include "thread_pool.hpp"
+
+/*
+    Copies of images into a ring of host-visible buffers. A copy is recorded into a frame's command buffer and handed to a pool job once that frame's fence has been waited on, so neither the CPU nor the GPU waits for the other. When every buffer is still in use, a copy is dropped rather than waited for.
+*/
+class Readback
+{
+    public:
+    /* Tightly packed texels, which are only valid while the callback runs */
+    struct Image
+    {
+        const uint8_t *p_texels;
+        VkFormat format;
+        VkExtent2D extent;
+        /* The frame that the copy was recorded in */
+        uint64_t frame;
+    };
+
+    /* This runs on a pool thread, and the buffer is reused once it returns. */
+    using Callback = std::function<void(const Image &)>;
+
+    void create(VkPhysicalDevice, VkDevice, Thread_Pool *, uint32_t frame_count, uint32_t buffer_count);
+    /* The device must be idle, since the callbacks of every recorded copy run first. */
+    void destroy();
+    /* This is called once the fence of `frame`'s slot has been waited on, and starts the callbacks of copies from completed frames. */
+    void begin_frame(uint64_t frame);
+    /* Whether `copy` would find a free buffer */
+    bool available() const;
+    /* `image` must be in `VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL`. This returns `false` when the copy is dropped. */
+    bool copy(VkCommandBuffer, VkImage, VkFormat, VkExtent2D, Callback);
+    uint64_t dropped() const { return dropped_count; }
+    /* Bytes per texel, or `0` for formats that cannot be read back */
+    static uint32_t texel_size(VkFormat);
+
+    private:
+    struct Slot
+    {
+        Buffer buffer;
+        /* This is set from recording until the callback starts. */
+        bool recorded{false};
+        uint64_t frame{0};
+        VkFormat format{VK_FORMAT_UNDEFINED};
+        VkExtent2D extent{};
+        Callback callback;
+        /* The callback's job, once it has started */
+        std::future<void> job;
+    };
+
+    static bool free(const Slot &);
+    void start(Slot &);
+
+    VkPhysicalDevice physical_device{VK_NULL_HANDLE};
+    VkDevice device{VK_NULL_HANDLE};
+    Thread_Pool *p_thread_pool{nullptr};
+    uint32_t frame_count{0};
+    /* Cached memory is preferred, since uncached reads are slow on the CPU. */
+    VkMemoryPropertyFlags memory_properties{0};
+    /* This never resizes after `create`, since jobs refer to its slots. */
+    std::vector<Slot> slots;
+    uint64_t current_frame{0};
+    uint64_t dropped_count{0};
+};
@@ -0,0 +1,666 @@
+#include "render_graph.hpp"
+
+/*
+    - `std::ranges::equal` [[.](https://en.cppreference.com/w/cpp/algorithm/ranges/equal.html)]
+    - `std::sort` [[.](https://en.cppreference.com/w/cpp/algorithm/sort.html)]
+*/
+#include <algorithm>
+/*
+    - `std::runtime_error` [[.](https://en.cppreference.com/w/cpp/error/runtime_error.html)]
+*/
+#include <stdexcept>
+
+#include "buffer.hpp"
+
+void Render_Graph::create(VkPhysicalDevice physical_device, VkDevice device, Deletion_Queue *p_deletion_queue)
+{
+    this->physical_device = physical_device;
+    this->device = device;
+    this->p_deletion_queue = p_deletion_queue;
+}
+
+void Render_Graph::destroy()
+{
+    destroy_transients();
+    /* These go through the queue too, so they outlive the framebuffers made with them. */
+    for (const auto &[key, render_pass] : render_passes) p_deletion_queue->push([device = device, render_pass = render_pass] { vkDestroyRenderPass(device, render_pass, nullptr); });
+    render_passes.clear();
+    begin();
+}
+
+void Render_Graph::begin()
+{
+    resources.clear();
+    passes.clear();
+    final_barriers.reset();
+}
+
+Render_Graph::Resource Render_Graph::import_image(std::string_view name, VkImage image, VkImageView view, VkFormat format, VkExtent2D extent, const State &initial, const State &final)
+{
+    resources.push_back({.name{name.data(), name.size(), Frame_Arena::resource()}, .imported{true}, .is_buffer{false}, .image{image}, .view{view}, .format{format}, .extent{extent}, .initial{initial}, .final{final}});
+    return static_cast<Resource>(resources.size() - 1);
+}
+
+Render_Graph::Resource Render_Graph::import_buffer(std::string_view name, VkBuffer buffer, const State &initial, const State &final)
+{
+    resources.push_back({.name{name.data(), name.size(), Frame_Arena::resource()}, .imported{true}, .is_buffer{true}, .buffer{buffer}, .initial{initial}, .final{final}});
+    return static_cast<Resource>(resources.size() - 1);
+}
+
+Render_Graph::Resource Render_Graph::create_image(std::string_view name, VkFormat format, VkExtent2D extent)
+{
+    resources.push_back({.name{name.data(), name.size(), Frame_Arena::resource()}, .imported{false}, .is_buffer{false}, .format{format}, .extent{extent}});
+    return static_cast<Resource>(resources.size() - 1);
+}
+
+Render_Graph::Pass Render_Graph::push_pass(std::string_view name, Queue queue, Record record)
+{
+    passes.push_back({.name{name.data(), name.size(), Frame_Arena::resource()}, .queue{queue}, .record{record}});
+    return static_cast<Pass>(passes.size() - 1);
+}
+
+void Render_Graph::read(Pass pass, Resource resource, Access access)
+{
+    passes[pass].uses.push_back({resource, access, false, {}});
+}
+
+void Render_Graph::write(Pass pass, Resource resource, Access access, std::optional<VkClearValue> clear)
+{
+    passes[pass].uses.push_back({resource, access, true, clear});
+}
+
+Render_Graph::State Render_Graph::state(Access access, Queue queue, bool write)
+{
+    VkPipelineStageFlags shader_stage{queue == Queue::COMPUTE ? VkPipelineStageFlags{VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT} : VkPipelineStageFlags{VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT}};
+
+    switch (access)
+    {
+    case Access::COLOR_ATTACHMENT: return {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | (write ? VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT : 0u), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+    case Access::DEPTH_ATTACHMENT: return {VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | (write ? VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT : 0u), write ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL};
+    case Access::SAMPLED: return {shader_stage, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    case Access::STORAGE: return {shader_stage, write ? VkAccessFlags{VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT} : VkAccessFlags{VK_ACCESS_SHADER_READ_BIT}, VK_IMAGE_LAYOUT_GENERAL};
+    case Access::TRANSFER: return {VK_PIPELINE_STAGE_TRANSFER_BIT, write ? VK_ACCESS_TRANSFER_WRITE_BIT : VK_ACCESS_TRANSFER_READ_BIT, write ? VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL : VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL};
+    case Access::VERTEX: return {VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED};
+    case Access::INDIRECT: return {VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED};
+    }
+
+    throw std::runtime_error("The access is unknown.\n");
+}
+
+VkImageUsageFlags Render_Graph::usage(Access access, bool write)
+{
+    switch (access)
+    {
+    case Access::COLOR_ATTACHMENT: return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    case Access::DEPTH_ATTACHMENT: return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    case Access::SAMPLED: return VK_IMAGE_USAGE_SAMPLED_BIT;
+    case Access::STORAGE: return VK_IMAGE_USAGE_STORAGE_BIT;
+    case Access::TRANSFER: return write ? VK_IMAGE_USAGE_TRANSFER_DST_BIT : VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    default: return 0;
+    }
+}
+
+VkImageAspectFlags Render_Graph::aspect(VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_D32_SFLOAT: return VK_IMAGE_ASPECT_DEPTH_BIT;
+    case VK_FORMAT_D24_UNORM_S8_UINT:
+    case VK_FORMAT_D32_SFLOAT_S8_UINT: return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+    default: return VK_IMAGE_ASPECT_COLOR_BIT;
+    }
+}
+
+/* Whether a use depends on earlier contents; an uncleared attachment is loaded, and storage may be written in part. */
+bool Render_Graph::loads(const Use &use)
+{
+    if (!use.write) return true;
+    if (use.access == Access::COLOR_ATTACHMENT || use.access == Access::DEPTH_ATTACHMENT) return !use.clear.has_value();
+    return use.access == Access::STORAGE;
+}
+
+void Render_Graph::compile()
+{
+    cull();
+
+    for (uint32_t i{0}; i < passes.size(); i++)
+    {
+        if (!passes[i].alive) continue;
+
+        for (const auto &use : passes[i].uses)
+        {
+            Resource_Node &resource{resources[use.resource]};
+            resource.first = std::min(resource.first, i);
+            resource.last = std::max(resource.last, i);
+            resource.usage |= usage(use.access, use.write);
+        }
+    }
+
+    allocate_transients();
+    trackers.assign(resources.size(), {});
+
+    for (uint32_t r{0}; r < resources.size(); r++)
+    {
+        const State &initial{resources[r].initial};
+        /* Transients are handled at their first use. */
+        trackers[r] = {.layout{initial.layout}, .write_stage{initial.stage}, .write_access{initial.access}, .read_stages{0}, .written{resources[r].imported && initial.layout != VK_IMAGE_LAYOUT_UNDEFINED}, .touched{false}, .batch{0}};
+    }
+
+    compiled_batches.clear();
+
+    for (uint32_t i{0}; i < passes.size(); i++)
+    {
+        Pass_Node &pass{passes[i]};
+        if (!pass.alive) continue;
+        if (compiled_batches.empty() || compiled_batches.back().queue != pass.queue) compiled_batches.push_back({.queue{pass.queue}, .wait_stage{0}});
+        compiled_batches.back().passes.push_back(i);
+        pass.barriers = {};
+        /* Load operations depend on what was written before this pass, so render passes are made before the trackers advance. */
+        create_render_pass(pass, i);
+        for (const auto &use : pass.uses) barrier(pass.barriers, use.resource, state(use.access, pass.queue, use.write), use.write);
+        for (const auto &use : pass.uses) trackers[use.resource].written |= use.write;
+    }
+
+    final_barriers.emplace();
+
+    for (uint32_t r{0}; r < resources.size(); r++)
+    {
+        if (!resources[r].imported || resources[r].first == ~0u) continue;
+        barrier(*final_barriers, r, resources[r].final, false);
+    }
+}
+
+/*
+    Passes are visited from last to first. A pass is alive if it is kept, writes an imported resource, or writes something that a later alive pass reads; a write that does not load ends the need for earlier contents.
+*/
+void Render_Graph::cull()
+{
+    std::pmr::vector<bool> needed(resources.size(), false, Frame_Arena::resource());
+
+    for (uint32_t i{static_cast<uint32_t>(passes.size())}; i-- > 0;)
+    {
+        Pass_Node &pass{passes[i]};
+        pass.alive = pass.kept;
+
+        for (const auto &use : pass.uses)
+            if (use.write && (resources[use.resource].imported || needed[use.resource])) pass.alive = true;
+
+        if (!pass.alive) continue;
+
+        for (const auto &use : pass.uses)
+            if (use.write && !loads(use)) needed[use.resource] = false;
+
+        for (const auto &use : pass.uses)
+            if (loads(use)) needed[use.resource] = true;
+    }
+}
+
+/*
+    Transients are placed greedily, largest first, in the first block of memory whose occupants' lifetimes are all disjoint from theirs. Blocks are used in order of first use, and the first occupant follows the last, from the previous frame.
+*/
+void Render_Graph::allocate_transients()
+{
+    std::pmr::vector<Resource> live{Frame_Arena::resource()};
+    std::pmr::vector<uint64_t> signature{Frame_Arena::resource()};
+
+    for (Resource r{0}; r < resources.size(); r++)
+    {
+        const Resource_Node &resource{resources[r]};
+        if (resource.imported || resource.first == ~0u) continue;
+        live.push_back(r);
+        signature.insert(signature.end(), {static_cast<uint64_t>(resource.format), resource.extent.width, resource.extent.height, resource.usage, resource.first, resource.last});
+    }
+
+    if (!std::ranges::equal(signature, transient_signature))
+    {
+        /* The old images may still be in use by frames in flight, so they are only retired. */
+        destroy_transients();
+        transient_signature.assign(signature.begin(), signature.end());
+        std::vector<VkMemoryRequirements> requirements(live.size());
+
+        for (uint32_t i{0}; i < live.size(); i++)
+        {
+            const Resource_Node &resource{resources[live[i]]};
+
+            VkImageCreateInfo create_info{
+                .sType{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO},
+                // .pNext{},
+                // .flags{},
+                .imageType{VK_IMAGE_TYPE_2D},
+                .format{resource.format},
+                .extent{resource.extent.width, resource.extent.height, 1},
+                .mipLevels{1},
+                .arrayLayers{1},
+                .samples{VK_SAMPLE_COUNT_1_BIT},
+                .tiling{VK_IMAGE_TILING_OPTIMAL},
+                .usage{resource.usage},
+                .sharingMode{VK_SHARING_MODE_EXCLUSIVE},
+                // .queueFamilyIndexCount{},
+                // .pQueueFamilyIndices{},
+                .initialLayout{VK_IMAGE_LAYOUT_UNDEFINED},
+            };
+
+            Transient transient{};
+            CHECK(vkCreateImage(device, &create_info, nullptr, &transient.image));
+            vkGetImageMemoryRequirements(device, transient.image, &requirements[i]);
+
+            for (const auto &pass : passes)
+            {
+                if (!pass.alive) continue;
+
+                for (const auto &use : pass.uses)
+                {
+                    if (use.resource != live[i]) continue;
+                    State s{state(use.access, pass.queue, use.write)};
+                    transient.stages |= s.stage;
+                    transient.accesses |= s.access;
+                }
+            }
+
+            transients.push_back(transient);
+        }
+
+        struct Block
+        {
+            std::vector<uint32_t> occupants;
+            VkDeviceSize size;
+            uint32_t memory_type_bits;
+        };
+
+        std::vector<uint32_t> order(live.size());
+        for (uint32_t i{0}; i < order.size(); i++) order[i] = i;
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return requirements[a].size > requirements[b].size; });
+        std::vector<Block> blocks;
+
+        for (uint32_t i : order)
+        {
+            const Resource_Node &resource{resources[live[i]]};
+            Block *p_block{nullptr};
+
+            for (auto &block : blocks)
+            {
+                if (!(block.memory_type_bits & requirements[i].memoryTypeBits)) continue;
+                bool disjoint{true};
+
+                for (uint32_t j : block.occupants)
+                {
+                    const Resource_Node &occupant{resources[live[j]]};
+                    if (resource.first <= occupant.last && occupant.first <= resource.last) disjoint = false;
+                }
+
+                if (disjoint)
+                {
+                    p_block = &block;
+                    break;
+                }
+            }
+
+            if (p_block == nullptr) p_block = &blocks.emplace_back(Block{{}, 0, ~0u});
+            p_block->occupants.push_back(i);
+            p_block->size = std::max(p_block->size, requirements[i].size);
+            p_block->memory_type_bits &= requirements[i].memoryTypeBits;
+        }
+
+        for (auto &block : blocks)
+        {
+            VkMemoryAllocateInfo allocate_info{
+                .sType{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO},
+                // .pNext{},
+                .allocationSize{block.size},
+                .memoryTypeIndex{find_memory_type(physical_device, block.memory_type_bits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)},
+            };
+
+            VkDeviceMemory memory;
+            CHECK(vkAllocateMemory(device, &allocate_info, nullptr, &memory));
+            transient_memories.push_back(memory);
+            std::sort(block.occupants.begin(), block.occupants.end(), [&](uint32_t a, uint32_t b) { return resources[live[a]].first < resources[live[b]].first; });
+
+            for (size_t k{0}; k < block.occupants.size(); k++)
+            {
+                Transient &transient{transients[block.occupants[k]]};
+                CHECK(vkBindImageMemory(device, transient.image, memory, 0));
+                transient.predecessor = block.occupants[(k + block.occupants.size() - 1) % block.occupants.size()];
+                const Resource_Node &resource{resources[live[block.occupants[k]]]};
+
+                VkImageViewCreateInfo create_info{
+                    .sType{VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO},
+                    // .pNext{},
+                    // .flags{},
+                    .image{transient.image},
+                    .viewType{VK_IMAGE_VIEW_TYPE_2D},
+                    .format{resource.format},
+                    .components{
+                        .r{VK_COMPONENT_SWIZZLE_IDENTITY},
+                        .g{VK_COMPONENT_SWIZZLE_IDENTITY},
+                        .b{VK_COMPONENT_SWIZZLE_IDENTITY},
+                        .a{VK_COMPONENT_SWIZZLE_IDENTITY},
+                    },
+                    .subresourceRange{
+                        .aspectMask{aspect(resource.format)},
+                        .baseMipLevel{0},
+                        .levelCount{1},
+                        .baseArrayLayer{0},
+                        .layerCount{1},
+                    },
+                };
+
+                CHECK(vkCreateImageView(device, &create_info, nullptr, &transient.view));
+            }
+        }
+    }
+
+    for (uint32_t i{0}; i < live.size(); i++)
+    {
+        resources[live[i]].transient = i;
+        resources[live[i]].image = transients[i].image;
+        resources[live[i]].view = transients[i].view;
+    }
+}
+
+void Render_Graph::release_framebuffers()
+{
+    for (const auto &[key, framebuffer] : framebuffers) p_deletion_queue->push([device = device, framebuffer = framebuffer] { vkDestroyFramebuffer(device, framebuffer, nullptr); });
+    framebuffers.clear();
+}
+
+void Render_Graph::destroy_transients()
+{
+    /* Framebuffers may refer to transient views, so they go too. */
+    release_framebuffers();
+
+    p_deletion_queue->push([device = device, transients = std::move(transients), memories = std::move(transient_memories)] {
+        for (const auto &transient : transients)
+        {
+            vkDestroyImageView(device, transient.view, nullptr);
+            vkDestroyImage(device, transient.image, nullptr);
+        }
+
+        for (const auto &memory : memories) vkFreeMemory(device, memory, nullptr);
+    });
+
+    transients.clear();
+    transient_memories.clear();
+    transient_signature.clear();
+}
+
+/*
+    A write, or a change of layout, waits for the last write and for every read since; a read waits for the last write, unless its stages already have. This is the minimum for each resource; a pass's barriers are then merged into one call.
+*/
+void Render_Graph::barrier(Barriers &barriers, Resource r, const State &next, bool write)
+{
+    constexpr VkAccessFlags WRITES{VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT};
+    Resource_Node &resource{resources[r]};
+    Tracker &tracker{trackers[r]};
+    bool transition{!resource.is_buffer && next.layout != tracker.layout};
+    VkPipelineStageFlags src_stage;
+    VkAccessFlags src_access;
+
+    if (resource.transient != ~0u && !tracker.touched)
+    {
+        /* The first use of a transient waits for whichever transient used its memory last. */
+        const Transient &predecessor{transients[transients[resource.transient].predecessor]};
+        src_stage = predecessor.stages;
+        src_access = predecessor.accesses & WRITES;
+        transition = true;
+    }
+    else if (write || transition)
+    {
+        src_stage = tracker.write_stage | tracker.read_stages;
+        src_access = tracker.write_access;
+    }
+    else
+    {
+        if (!(next.stage & ~tracker.read_stages) || tracker.write_stage == 0)
+        {
+            tracker.read_stages |= next.stage;
+            return;
+        }
+
+        src_stage = tracker.write_stage;
+        src_access = tracker.write_access;
+    }
+
+    VkImageLayout old_layout{tracker.touched || resource.transient == ~0u ? tracker.layout : VK_IMAGE_LAYOUT_UNDEFINED};
+    tracker.touched = true;
+    barriers.src_stage |= src_stage != 0 ? src_stage : VkPipelineStageFlags{VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT};
+    barriers.dst_stage |= next.stage;
+
+    if (resource.is_buffer)
+    {
+        barriers.buffer_barriers.push_back({
+            .sType{VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER},
+            // .pNext{},
+            .srcAccessMask{src_access},
+            .dstAccessMask{next.access},
+            .srcQueueFamilyIndex{VK_QUEUE_FAMILY_IGNORED},
+            .dstQueueFamilyIndex{VK_QUEUE_FAMILY_IGNORED},
+            .buffer{resource.buffer},
+            .offset{0},
+            .size{VK_WHOLE_SIZE},
+        });
+    }
+    else
+    {
+        barriers.image_barriers.push_back({
+            .sType{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER},
+            // .pNext{},
+            .srcAccessMask{src_access},
+            .dstAccessMask{next.access},
+            .oldLayout{old_layout},
+            .newLayout{next.layout},
+            .srcQueueFamilyIndex{VK_QUEUE_FAMILY_IGNORED},
+            .dstQueueFamilyIndex{VK_QUEUE_FAMILY_IGNORED},
+            .image{resource.image},
+            .subresourceRange{
+                .aspectMask{aspect(resource.format)},
+                .baseMipLevel{0},
+                .levelCount{VK_REMAINING_MIP_LEVELS},
+                .baseArrayLayer{0},
+                .layerCount{VK_REMAINING_ARRAY_LAYERS},
+            },
+        });
+    }
+
+    /* A waiting batch on another queue would wait at these stages. */
+    uint32_t batch{static_cast<uint32_t>(compiled_batches.empty() ? 0 : compiled_batches.size() - 1)};
+    if (!compiled_batches.empty() && tracker.batch != batch) compiled_batches.back().wait_stage |= next.stage;
+    tracker.batch = batch;
+
+    /* A layout transition is itself a write, which later readers in other stages must wait for. */
+    if (!resource.is_buffer) tracker.layout = next.layout;
+    tracker.write_stage = next.stage;
+    tracker.write_access = write ? next.access & WRITES : 0;
+    tracker.read_stages = write ? 0 : next.stage;
+}
+
+/* Color attachments come first, in declaration order, and then the depth attachment. */
+void Render_Graph::create_render_pass(Pass_Node &pass, uint32_t index)
+{
+    std::pmr::vector<Attachment> colors{Frame_Arena::resource()};
+    std::optional<Attachment> depth;
+    std::pmr::vector<VkImageView> views{Frame_Arena::resource()};
+    pass.render_pass = VK_NULL_HANDLE;
+    pass.clear_values.clear();
+    const Use *p_depth{nullptr};
+
+    auto attachment{[&](const Use &use) {
+        const Resource_Node &resource{resources[use.resource]};
+        pass.extent = resource.extent;
+        views.push_back(resource.view);
+        pass.clear_values.push_back(use.clear.value_or(VkClearValue{}));
+
+        /* Contents are only loaded if they exist, and only stored if something will read them. */
+        return Attachment{
+            .format{resource.format},
+            .load_op{use.clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : loads(use) && trackers[use.resource].written ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_DONT_CARE},
+            .store_op{resource.imported || resource.last > index ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE},
+        };
+    }};
+
+    for (const auto &use : pass.uses)
+    {
+        if (use.access == Access::COLOR_ATTACHMENT) colors.push_back(attachment(use));
+        if (use.access != Access::DEPTH_ATTACHMENT) continue;
+        if (p_depth != nullptr) throw std::runtime_error("The pass `" + std::string(pass.name) + "` has more than one depth attachment.\n");
+        p_depth = &use;
+    }
+
+    if (p_depth != nullptr) depth = attachment(*p_depth);
+    if (views.empty()) return;
+    pass.render_pass = get_render_pass(colors, depth);
+    std::pmr::vector<uint64_t> key({(uint64_t)pass.render_pass, pass.extent.width, pass.extent.height}, Frame_Arena::resource());
+    for (VkImageView view : views) key.push_back((uint64_t)view);
+
+    if (auto it{framebuffers.find(key)}; it != framebuffers.end())
+    {
+        pass.framebuffer = it->second;
+        return;
+    }
+
+    VkFramebufferCreateInfo create_info{
+        .sType{VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO},
+        // .pNext{},
+        // .flags{},
+        .renderPass{pass.render_pass},
+        .attachmentCount{static_cast<uint32_t>(views.size())},
+        .pAttachments{views.data()},
+        .width{pass.extent.width},
+        .height{pass.extent.height},
+        .layers{1},
+    };
+
+    CHECK(vkCreateFramebuffer(device, &create_info, nullptr, &pass.framebuffer));
+    framebuffers.emplace(std::vector<uint64_t>(key.begin(), key.end()), pass.framebuffer);
+}
+
+VkRenderPass Render_Graph::compatible_render_pass(const std::vector<VkFormat> &color_formats, VkFormat depth_format)
+{
+    std::vector<Attachment> colors;
+    for (VkFormat format : color_formats) colors.push_back({format, VK_ATTACHMENT_LOAD_OP_DONT_CARE, VK_ATTACHMENT_STORE_OP_DONT_CARE});
+    std::optional<Attachment> depth;
+    if (depth_format != VK_FORMAT_UNDEFINED) depth = Attachment{depth_format, VK_ATTACHMENT_LOAD_OP_DONT_CARE, VK_ATTACHMENT_STORE_OP_DONT_CARE};
+    return get_render_pass(colors, depth);
+}
+
+/*
+    Layouts do not change inside these render passes, since the graph's barriers make every transition, and there are no subpass dependencies for the same reason.
+*/
+VkRenderPass Render_Graph::get_render_pass(std::span<const Attachment> colors, std::optional<Attachment> depth)
+{
+    std::pmr::vector<uint64_t> key{Frame_Arena::resource()};
+    for (const auto &color : colors) key.insert(key.end(), {static_cast<uint64_t>(color.format), static_cast<uint64_t>(color.load_op), static_cast<uint64_t>(color.store_op)});
+    if (depth) key.insert(key.end(), {~0ull, static_cast<uint64_t>(depth->format), static_cast<uint64_t>(depth->load_op), static_cast<uint64_t>(depth->store_op)});
+    if (auto it{render_passes.find(key)}; it != render_passes.end()) return it->second;
+
+    std::vector<VkAttachmentDescription> attachments;
+    std::vector<VkAttachmentReference> color_references;
+
+    for (const auto &color : colors)
+    {
+        color_references.push_back({static_cast<uint32_t>(attachments.size()), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL});
+
+        attachments.push_back({
+            // .flags{},
+            .format{color.format},
+            .samples{VK_SAMPLE_COUNT_1_BIT},
+            .loadOp{color.load_op},
+            .storeOp{color.store_op},
+            .stencilLoadOp{VK_ATTACHMENT_LOAD_OP_DONT_CARE},
+            .stencilStoreOp{VK_ATTACHMENT_STORE_OP_DONT_CARE},
+            .initialLayout{VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL},
+            .finalLayout{VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL},
+        });
+    }
+
+    VkAttachmentReference depth_reference{static_cast<uint32_t>(attachments.size()), VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+
+    if (depth)
+    {
+        attachments.push_back({
+            // .flags{},
+            .format{depth->format},
+            .samples{VK_SAMPLE_COUNT_1_BIT},
+            .loadOp{depth->load_op},
+            .storeOp{depth->store_op},
+            .stencilLoadOp{VK_ATTACHMENT_LOAD_OP_DONT_CARE},
+            .stencilStoreOp{VK_ATTACHMENT_STORE_OP_DONT_CARE},
+            .initialLayout{VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL},
+            .finalLayout{VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL},
+        });
+    }
+
+    VkSubpassDescription subpass{
+        // .flags{},
+        .pipelineBindPoint{VK_PIPELINE_BIND_POINT_GRAPHICS},
+        // .inputAttachmentCount{},
+        // .pInputAttachments{},
+        .colorAttachmentCount{static_cast<uint32_t>(color_references.size())},
+        .pColorAttachments{color_references.data()},
+        // .pResolveAttachments{},
+        .pDepthStencilAttachment{depth ? &depth_reference : nullptr},
+        // .preserveAttachmentCount{},
+        // .pPreserveAttachments{},
+    };
+
+    VkRenderPassCreateInfo create_info{
+        .sType{VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO},
+        // .pNext{},
+        // .flags{},
+        .attachmentCount{static_cast<uint32_t>(attachments.size())},
+        .pAttachments{attachments.data()},
+        .subpassCount{1},
+        .pSubpasses{&subpass},
+        // .dependencyCount{},
+        // .pDependencies{},
+    };
+
+    VkRenderPass render_pass;
+    CHECK(vkCreateRenderPass(device, &create_info, nullptr, &render_pass));
+    render_passes.emplace(std::vector<uint64_t>(key.begin(), key.end()), render_pass);
+    return render_pass;
+}
+
+void Render_Graph::execute(VkCommandBuffer command_buffer, Gpu_Profiler *p_gpu_profiler)
+{
+    auto record_barriers{[command_buffer](const Barriers &barriers) {
+        if (barriers.image_barriers.empty() && barriers.buffer_barriers.empty()) return;
+        vkCmdPipelineBarrier(command_buffer, barriers.src_stage, barriers.dst_stage, 0, 0, nullptr, static_cast<uint32_t>(barriers.buffer_barriers.size()), barriers.buffer_barriers.data(), static_cast<uint32_t>(barriers.image_barriers.size()), barriers.image_barriers.data());
+    }};
+
+    for (const auto &pass : passes)
+    {
+        if (!pass.alive) continue;
+        /* Pass names are interned, since zones keep their names until a trace is written. */
+        const char *name{Profiler::intern(pass.name)};
+        Profile_Zone zone{name};
+        if (p_gpu_profiler != nullptr) p_gpu_profiler->begin_zone(command_buffer, name);
+        record_barriers(pass.barriers);
+
+        if (pass.render_pass == VK_NULL_HANDLE)
+        {
+            pass.record(command_buffer);
+            if (p_gpu_profiler != nullptr) p_gpu_profiler->end_zone(command_buffer);
+            continue;
+        }
+
+        VkRenderPassBeginInfo begin_info{
+            .sType{VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO},
+            // .pNext{},
+            .renderPass{pass.render_pass},
+            .framebuffer{pass.framebuffer},
+            .renderArea{
+                .offset{0, 0},
+                .extent{pass.extent},
+            },
+            .clearValueCount{static_cast<uint32_t>(pass.clear_values.size())},
+            .pClearValues{pass.clear_values.data()},
+        };
+
+        vkCmdBeginRenderPass(command_buffer, &begin_info, pass.secondary ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
+        pass.record(command_buffer);
+        vkCmdEndRenderPass(command_buffer);
+        if (p_gpu_profiler != nullptr) p_gpu_profiler->end_zone(command_buffer);
+    }
+
+    if (final_barriers) record_barriers(*final_barriers);
+}
@@ -0,0 +1,272 @@
+#pragma once
+
+/*
+    - `std::lexicographical_compare` [[.](https://en.cppreference.com/w/cpp/algorithm/lexicographical_compare.html)]
+*/
+#include <algorithm>
+/*
+    - `std::map` [[.](https://en.cppreference.com/w/cpp/container/map.html)]
+*/
+#include <map>
+/*
+    - `std::pmr::vector` [[.](https://en.cppreference.com/w/cpp/container/vector.html)]
+*/
+#include <memory_resource>
+/*
+    - `std::optional` [[.](https://en.cppreference.com/w/cpp/utility/optional.html)]
+*/
+#include <optional>
+/*
+    - `std::span` [[.](https://en.cppreference.com/w/cpp/container/span.html)]
+*/
+#include <span>
+/*
+    - `std::pmr::string` [[.](https://en.cppreference.com/w/cpp/string/basic_string.html)]
+*/
+#include <string>
+/*
+    - `std::string_view` [[.](https://en.cppreference.com/w/cpp/string/basic_string_view.html)]
+*/
+#include <string_view>
+/*
+    - `std::decay_t` [[.](https://en.cppreference.com/w/cpp/types/decay.html)]
+    - `std::is_trivially_destructible_v` [[.](https://en.cppreference.com/w/cpp/types/is_destructible.html)]
+*/
+#include <type_traits>
+/*
+    - `std::vector` [[.](https://en.cppreference.com/w/cpp/container/vector.html)]
+*/
+#include <vector>
+
+#include "arena.hpp"
+#include "common.hpp"
+#include "deletion_queue.hpp"
+#include "profiler.hpp"
+
+/*
+    A frame's passes and the resources that they read and write, which is declared anew every frame. `compile` culls passes whose results are never used, derives one batched pipeline barrier per pass, with the layout transitions, chooses attachment load and store operations, and places transient images with disjoint lifetimes in shared memory. Passes run in declaration order, so a pass may only read what earlier passes wrote.
+
+    Render passes, framebuffers and transient images are cached between frames, since the graph rarely changes. When it does, the old transients and framebuffers go through the `Deletion_Queue`, so frames in flight keep using them.
+
+    Everything declared for a frame lives in the `Frame_Arena`, and the lists of passes and resources keep their capacity, so a frame like the last one allocates nothing from the heap.
+*/
+class Render_Graph
+{
+    public:
+    using Resource = uint32_t;
+    using Pass = uint32_t;
+
+    enum class Queue
+    {
+        GRAPHICS,
+        COMPUTE,
+    };
+
+    /* How a pass uses a resource; the stages follow from this and the pass's queue. */
+    enum class Access
+    {
+        COLOR_ATTACHMENT,
+        DEPTH_ATTACHMENT,
+        SAMPLED,
+        STORAGE,
+        TRANSFER,
+        VERTEX,
+        INDIRECT,
+    };
+
+    struct State
+    {
+        VkPipelineStageFlags stage;
+        VkAccessFlags access;
+        /* This is ignored for buffers. */
+        VkImageLayout layout;
+    };
+
+    /* Consecutive passes on one queue; a submission to another queue would wait on the previous batch at `wait_stage`. */
+    struct Batch
+    {
+        Queue queue;
+        std::pmr::vector<Pass> passes{Frame_Arena::resource()};
+        VkPipelineStageFlags wait_stage;
+    };
+
+    void create(VkPhysicalDevice, VkDevice, Deletion_Queue *);
+    void destroy();
+    /* Framebuffers are cached by view, so this must be called before imported views are destroyed, as on a swapchain recreation. */
+    void release_framebuffers();
+
+    /* # Declaring # */
+
+    /* This forgets the previous frame's passes and resources, but not the caches. */
+    void begin();
+    /* `initial` is the state that the resource is in before the frame, and `final` the state that it is left in. */
+    Resource import_image(std::string_view name, VkImage, VkImageView, VkFormat, VkExtent2D, const State &initial, const State &final);
+    Resource import_buffer(std::string_view name, VkBuffer, const State &initial, const State &final);
+    /* A transient image only lives within the frame, and its contents start undefined. */
+    Resource create_image(std::string_view name, VkFormat, VkExtent2D);
+
+    /* `record` is kept in the `Frame_Arena` rather than in an `std::function`, which would allocate for most lambdas, so it may only capture what needs no destructor, such as references. */
+    template <typename F>
+    Pass add_pass(std::string_view name, Queue queue, F &&record)
+    {
+        using Callable = std::decay_t<F>;
+        static_assert(std::is_trivially_destructible_v<Callable>, "The arena never destroys a pass's recording function.");
+        void *p_callable{new (Frame_Arena::get().allocate(sizeof(Callable), alignof(Callable))) Callable(std::forward<F>(record))};
+        return push_pass(name, queue, {p_callable, [](void *p_callable, VkCommandBuffer command_buffer) { (*static_cast<Callable *>(p_callable))(command_buffer); }});
+    }
+
+    void read(Pass, Resource, Access);
+    /* An attachment that is written without being cleared keeps its earlier contents. */
+    void write(Pass, Resource, Access, std::optional<VkClearValue> clear = {});
+    /* A kept pass is never culled, for side effects that the graph does not see. */
+    void keep(Pass pass) { passes[pass].kept = true; }
+    /* The pass's render pass is begun for secondary command buffers, which is all that it may record then. */
+    void use_secondary(Pass pass) { passes[pass].secondary = true; }
+
+    /* # Compiling and executing # */
+
+    void compile();
+    /* Each pass is a zone, on the CPU while it is recorded, and on the GPU when there is a `Gpu_Profiler`. */
+    void execute(VkCommandBuffer, Gpu_Profiler * = nullptr);
+    const std::vector<Batch> &batches() const { return compiled_batches; }
+    VkImage image(Resource resource) const { return resources[resource].image; }
+    VkImageView view(Resource resource) const { return resources[resource].view; }
+    /* Secondary command buffers inherit this; it is `VK_NULL_HANDLE` for passes outside of render passes. */
+    VkRenderPass render_pass(Pass pass) const { return passes[pass].render_pass; }
+    /* Pipelines are created against this, since a render pass is compatible with any other that has the same attachment formats. */
+    VkRenderPass compatible_render_pass(const std::vector<VkFormat> &color_formats, VkFormat depth_format);
+
+    private:
+    struct Record
+    {
+        void *p_callable;
+        void (*p_invoke)(void *, VkCommandBuffer);
+
+        void operator()(VkCommandBuffer command_buffer) const { p_invoke(p_callable, command_buffer); }
+    };
+
+    /* Map keys are compared with arena-allocated keys without copying them to the heap. */
+    struct Key_Less
+    {
+        using is_transparent = void;
+
+        template <typename A, typename B>
+        bool operator()(const A &a, const B &b) const
+        {
+            return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end());
+        }
+    };
+
+    struct Resource_Node
+    {
+        std::pmr::string name;
+        bool imported;
+        bool is_buffer;
+        VkImage image{VK_NULL_HANDLE};
+        VkImageView view{VK_NULL_HANDLE};
+        VkBuffer buffer{VK_NULL_HANDLE};
+        VkFormat format{VK_FORMAT_UNDEFINED};
+        VkExtent2D extent{};
+        State initial{};
+        State final{};
+        /* These are set by `compile`. */
+        VkImageUsageFlags usage{0};
+        uint32_t first{~0u};
+        uint32_t last{0};
+        uint32_t transient{~0u};
+    };
+
+    struct Use
+    {
+        Resource resource;
+        Access access;
+        bool write;
+        std::optional<VkClearValue> clear;
+    };
+
+    struct Barriers
+    {
+        VkPipelineStageFlags src_stage{0};
+        VkPipelineStageFlags dst_stage{0};
+        std::pmr::vector<VkImageMemoryBarrier> image_barriers{Frame_Arena::resource()};
+        std::pmr::vector<VkBufferMemoryBarrier> buffer_barriers{Frame_Arena::resource()};
+    };
+
+    struct Pass_Node
+    {
+        std::pmr::string name;
+        Queue queue;
+        Record record;
+        std::pmr::vector<Use> uses{Frame_Arena::resource()};
+        bool kept{false};
+        bool secondary{false};
+        /* These are set by `compile`. */
+        bool alive{false};
+        Barriers barriers;
+        VkRenderPass render_pass{VK_NULL_HANDLE};
+        VkFramebuffer framebuffer{VK_NULL_HANDLE};
+        VkExtent2D extent{};
+        std::pmr::vector<VkClearValue> clear_values{Frame_Arena::resource()};
+    };
+
+    /* What has happened to a resource so far in the frame, while barriers are derived */
+    struct Tracker
+    {
+        VkImageLayout layout;
+        /* The last write, or layout transition, that later accesses must wait for */
+        VkPipelineStageFlags write_stage;
+        VkAccessFlags write_access;
+        /* The stages that have waited for that write already */
+        VkPipelineStageFlags read_stages;
+        /* Whether the resource has contents, for load operations */
+        bool written;
+        bool touched;
+        uint32_t batch;
+    };
+
+    struct Attachment
+    {
+        VkFormat format;
+        VkAttachmentLoadOp load_op;
+        VkAttachmentStoreOp store_op;
+    };
+
+    struct Transient
+    {
+        VkImage image;
+        VkImageView view;
+        /* The transient that used the memory last before this one, possibly in the previous frame */
+        uint32_t predecessor;
+        /* Every stage and access of this transient, for its successor to wait on */
+        VkPipelineStageFlags stages;
+        VkAccessFlags accesses;
+    };
+
+    static State state(Access, Queue, bool write);
+    static VkImageUsageFlags usage(Access, bool write);
+    static VkImageAspectFlags aspect(VkFormat);
+    static bool loads(const Use &);
+    Pass push_pass(std::string_view name, Queue, Record);
+    void cull();
+    void allocate_transients();
+    void destroy_transients();
+    void barrier(Barriers &, Resource, const State &, bool write);
+    void create_render_pass(Pass_Node &, uint32_t index);
+    VkRenderPass get_render_pass(std::span<const Attachment> colors, std::optional<Attachment> depth);
+
+    VkPhysicalDevice physical_device;
+    VkDevice device;
+    Deletion_Queue *p_deletion_queue;
+    std::vector<Resource_Node> resources;
+    std::vector<Pass_Node> passes;
+    std::vector<Tracker> trackers;
+    std::vector<Batch> compiled_batches;
+    /* This is made anew by each `compile`, so that its lists come from that frame's arena. */
+    std::optional<Barriers> final_barriers;
+    /* The transients of the graph that they were allocated for, and their memory; the signature says when the graph differs. */
+    std::vector<uint64_t> transient_signature;
+    std::vector<Transient> transients;
+    std::vector<VkDeviceMemory> transient_memories;
+    std::map<std::vector<uint64_t>, VkRenderPass, Key_Less> render_passes;
+    std::map<std::vector<uint64_t>, VkFramebuffer, Key_Less> framebuffers;
+};
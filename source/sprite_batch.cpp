@@ -0,0 +1,332 @@
+#include "sprite_batch.hpp"
+
+/*
+    - `std::is_sorted` [[.](https://en.cppreference.com/w/cpp/algorithm/is_sorted.html)]
+    - `std::sort` [[.](https://en.cppreference.com/w/cpp/algorithm/sort.html)]
+*/
+#include <algorithm>
+/*
+    - `std::memcpy` [[.](https://en.cppreference.com/w/cpp/string/byte/memcpy.html)]
+*/
+#include <cstring>
+
+#include "profiler.hpp"
+
+void Sprite_Batch::create(VkPhysicalDevice physical_device, VkDevice device, Deletion_Queue *p_deletion_queue, VkDescriptorSetLayout bindless_layout, uint32_t capacity, uint32_t frame_count)
+{
+    this->device = device;
+    this->p_deletion_queue = p_deletion_queue;
+    this->capacity = capacity;
+    ring.create(physical_device, device, VkDeviceSize{capacity} * sizeof(Instance), frame_count, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, 0);
+    instances.reserve(capacity);
+    keys.reserve(capacity);
+
+    VkPushConstantRange push_constant_range{
+        .stageFlags{VK_SHADER_STAGE_VERTEX_BIT},
+        .offset{0},
+        .size{sizeof(float) * 2},
+    };
+
+    /* `set = 0` is the global bindless set. */
+    VkDescriptorSetLayout set_layout{bindless_layout};
+
+    VkPipelineLayoutCreateInfo create_info{
+        .sType{VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO},
+        // .pNext{},
+        // .flags{},
+        .setLayoutCount{1},
+        .pSetLayouts{&set_layout},
+        .pushConstantRangeCount{1},
+        .pPushConstantRanges{&push_constant_range},
+    };
+
+    VkPipelineLayout layout;
+    CHECK(vkCreatePipelineLayout(device, &create_info, nullptr, &layout));
+    pipeline_layout = Unique_Pipeline_Layout{device, layout, p_deletion_queue};
+}
+
+void Sprite_Batch::destroy()
+{
+    for (auto &pipeline : pipelines) pipeline.reset();
+    pipeline_layout.reset();
+    ring.destroy(device);
+}
+
+Sprite_Batch::Pipelines Sprite_Batch::create_pipelines(VkShaderModule vert, VkShaderModule frag, VkRenderPass render_pass, VkPipelineCache pipeline_cache) const
+{
+    VkPipelineShaderStageCreateInfo stages[]{
+        {
+            .sType{VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO},
+            // .pNext{},
+            // .flags{},
+            .stage{VK_SHADER_STAGE_VERTEX_BIT},
+            .module{vert},
+            .pName{"main"},
+            // .pSpecializationInfo{},
+        },
+        {
+            .sType{VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO},
+            // .pNext{},
+            // .flags{},
+            .stage{VK_SHADER_STAGE_FRAGMENT_BIT},
+            .module{frag},
+            .pName{"main"},
+            // .pSpecializationInfo{},
+        },
+    };
+
+    VkVertexInputBindingDescription binding{
+        .binding{0},
+        .stride{sizeof(Instance)},
+        .inputRate{VK_VERTEX_INPUT_RATE_INSTANCE},
+    };
+
+    VkVertexInputAttributeDescription attributes[]{
+        {
+            .location{0},
+            .binding{0},
+            .format{VK_FORMAT_R32G32B32A32_SFLOAT},
+            .offset{offsetof(Instance, rect)},
+        },
+        {
+            .location{1},
+            .binding{0},
+            .format{VK_FORMAT_R32G32B32A32_SFLOAT},
+            .offset{offsetof(Instance, uv)},
+        },
+        {
+            .location{2},
+            .binding{0},
+            .format{VK_FORMAT_R8G8B8A8_UNORM},
+            .offset{offsetof(Instance, color)},
+        },
+        {
+            .location{3},
+            .binding{0},
+            .format{VK_FORMAT_R32G32_UINT},
+            .offset{offsetof(Instance, texture)},
+        },
+    };
+
+    VkPipelineVertexInputStateCreateInfo vertex_input_state{
+        .sType{VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO},
+        // .pNext{},
+        // .flags{},
+        .vertexBindingDescriptionCount{1},
+        .pVertexBindingDescriptions{&binding},
+        .vertexAttributeDescriptionCount{4},
+        .pVertexAttributeDescriptions{attributes},
+    };
+
+    /* Four vertices make a quad. */
+    VkPipelineInputAssemblyStateCreateInfo input_assembly_state{
+        .sType{VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO},
+        // .pNext{},
+        // .flags{},
+        .topology{VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP},
+        .primitiveRestartEnable{VK_FALSE},
+    };
+
+    VkPipelineViewportStateCreateInfo viewport_state{
+        .sType{VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO},
+        // .pNext{},
+        // .flags{},
+        .viewportCount{1},
+        // .pViewports{},
+        .scissorCount{1},
+        // .pScissors{},
+    };
+
+    /* Sprites may be mirrored with negative sizes, so neither side is culled. */
+    VkPipelineRasterizationStateCreateInfo rasterization_state{
+        .sType{VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO},
+        // .pNext{},
+        // .flags{},
+        .depthClampEnable{VK_FALSE},
+        .rasterizerDiscardEnable{VK_FALSE},
+        .polygonMode{VK_POLYGON_MODE_FILL},
+        .cullMode{VK_CULL_MODE_NONE},
+        .frontFace{VK_FRONT_FACE_CLOCKWISE},
+        .depthBiasEnable{VK_FALSE},
+        /* This is optional. */ .depthBiasConstantFactor{0.0f},
+        /* This is optional. */ .depthBiasClamp{0.0f},
+        /* This is optional. */ .depthBiasSlopeFactor{0.0f},
+        .lineWidth{1.0f},
+    };
+
+    VkPipelineMultisampleStateCreateInfo multisample_state{
+        .sType{VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO},
+        // .pNext{},
+        // .flags{},
+        .rasterizationSamples{VK_SAMPLE_COUNT_1_BIT},
+        .sampleShadingEnable{VK_FALSE},
+        /* This is optional. */ .minSampleShading{1.0f},
+        /* This is optional. */ .pSampleMask{nullptr},
+        /* This is optional. */ .alphaToCoverageEnable{VK_FALSE},
+        /* This is optional. */ .alphaToOneEnable{VK_FALSE},
+    };
+
+    /* These are indexed by `Blend`; colors are not premultiplied. */
+    VkPipelineColorBlendAttachmentState attachments[BLEND_COUNT]{
+        {
+            .blendEnable{VK_TRUE},
+            .srcColorBlendFactor{VK_BLEND_FACTOR_SRC_ALPHA},
+            .dstColorBlendFactor{VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA},
+            .colorBlendOp{VK_BLEND_OP_ADD},
+            .srcAlphaBlendFactor{VK_BLEND_FACTOR_ONE},
+            .dstAlphaBlendFactor{VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA},
+            .alphaBlendOp{VK_BLEND_OP_ADD},
+            .colorWriteMask{VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT},
+        },
+        {
+            .blendEnable{VK_TRUE},
+            .srcColorBlendFactor{VK_BLEND_FACTOR_SRC_ALPHA},
+            .dstColorBlendFactor{VK_BLEND_FACTOR_ONE},
+            .colorBlendOp{VK_BLEND_OP_ADD},
+            .srcAlphaBlendFactor{VK_BLEND_FACTOR_ZERO},
+            .dstAlphaBlendFactor{VK_BLEND_FACTOR_ONE},
+            .alphaBlendOp{VK_BLEND_OP_ADD},
+            .colorWriteMask{VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT},
+        },
+    };
+
+    VkPipelineColorBlendStateCreateInfo color_blend_states[BLEND_COUNT];
+
+    for (uint32_t i{0}; i < BLEND_COUNT; i++)
+    {
+        color_blend_states[i] = {
+            .sType{VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO},
+            // .pNext{},
+            // .flags{},
+            .logicOpEnable{VK_FALSE},
+            /* This is optional. */ .logicOp{VK_LOGIC_OP_COPY},
+            .attachmentCount{1},
+            .pAttachments{&attachments[i]},
+            /* This is optional. */ .blendConstants{},
+        };
+    }
+
+    VkDynamicState dynamic_states[]{VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+
+    VkPipelineDynamicStateCreateInfo dynamic_state{
+        .sType{VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO},
+        // .pNext{},
+        // .flags{},
+        .dynamicStateCount{static_cast<uint32_t>(std::size(dynamic_states))},
+        .pDynamicStates{dynamic_states},
+    };
+
+    VkGraphicsPipelineCreateInfo create_infos[BLEND_COUNT];
+
+    for (uint32_t i{0}; i < BLEND_COUNT; i++)
+    {
+        create_infos[i] = {
+            .sType{VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO},
+            // .pNext{},
+            // .flags{},
+            .stageCount{2},
+            .pStages{stages},
+            .pVertexInputState{&vertex_input_state},
+            .pInputAssemblyState{&input_assembly_state},
+            // .pTessellationState{},
+            .pViewportState{&viewport_state},
+            .pRasterizationState{&rasterization_state},
+            .pMultisampleState{&multisample_state},
+            /* The render pass has no depth attachment. */
+            .pDepthStencilState{nullptr},
+            .pColorBlendState{&color_blend_states[i]},
+            .pDynamicState{&dynamic_state},
+            .layout{pipeline_layout},
+            .renderPass{render_pass},
+            .subpass{0},
+            /* This is optional. */ .basePipelineHandle{VK_NULL_HANDLE},
+            /* This is optional. */ .basePipelineIndex{-1},
+        };
+    }
+
+    VkPipeline new_pipelines[BLEND_COUNT];
+    CHECK(vkCreateGraphicsPipelines(device, pipeline_cache, BLEND_COUNT, create_infos, nullptr, new_pipelines));
+    Pipelines created;
+    for (uint32_t i{0}; i < BLEND_COUNT; i++) created.blends[i] = Unique_Pipeline{device, new_pipelines[i]};
+    return created;
+}
+
+void Sprite_Batch::set_pipelines(Pipelines &&new_pipelines)
+{
+    /* Replacing these retires the old ones. */
+    for (uint32_t i{0}; i < BLEND_COUNT; i++) pipelines[i] = Unique_Pipeline{device, new_pipelines.blends[i].release(), p_deletion_queue};
+}
+
+void Sprite_Batch::begin_frame(uint32_t frame)
+{
+    ring.begin_frame(frame);
+    instances.clear();
+    keys.clear();
+}
+
+void Sprite_Batch::add(const Sprite &sprite)
+{
+    if (instances.size() == capacity)
+    {
+        dropped_count++;
+        return;
+    }
+
+    uint64_t key{uint64_t{sprite.layer} << 40 | uint64_t{static_cast<uint8_t>(sprite.blend)} << 32 | sprite.texture};
+    keys.push_back({key, static_cast<uint32_t>(instances.size())});
+
+    instances.push_back({
+        .rect{sprite.rect[0], sprite.rect[1], sprite.rect[2], sprite.rect[3]},
+        .uv{sprite.uv[0], sprite.uv[1], sprite.uv[2], sprite.uv[3]},
+        .color{sprite.color},
+        .texture{sprite.texture},
+        .sampler{sprite.sampler},
+        .padding{0},
+    });
+}
+
+/* The instances are written in sorted order, so each batch is a contiguous range of them. Sprites are usually added in an order that is sorted already, which is checked before sorting. */
+void Sprite_Batch::record(VkCommandBuffer command_buffer, VkDescriptorSet bindless_set, VkExtent2D extent)
+{
+    PROFILE_FUNCTION();
+    batch_count = 0;
+    if (instances.empty()) return;
+    if (!std::is_sorted(keys.begin(), keys.end())) std::sort(keys.begin(), keys.end());
+    Frame_Ring::Allocation allocation{ring.allocate(instances.size() * sizeof(Instance))};
+    Instance *p_instances{static_cast<Instance *>(allocation.p_data)};
+    for (size_t i{0}; i < keys.size(); i++) std::memcpy(&p_instances[i], &instances[keys[i].second], sizeof(Instance));
+
+    VkViewport viewport{
+        .x{0.0f},
+        .y{0.0f},
+        .width{static_cast<float>(extent.width)},
+        .height{static_cast<float>(extent.height)},
+        .minDepth{0.0f},
+        .maxDepth{1.0f},
+    };
+
+    VkRect2D scissor{
+        .offset{0, 0},
+        .extent{extent},
+    };
+
+    float push_constants[2]{static_cast<float>(extent.width), static_cast<float>(extent.height)};
+    vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+    vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 0, 1, &bindless_set, 0, nullptr);
+    vkCmdPushConstants(command_buffer, pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(push_constants), push_constants);
+    VkBuffer buffer{ring.buffer()};
+    vkCmdBindVertexBuffers(command_buffer, 0, 1, &buffer, &allocation.offset);
+    uint32_t first{0};
+
+    for (uint32_t i{1}; i <= keys.size(); i++)
+    {
+        /* The blend is the pipeline, and a batch ends where it changes. */
+        uint8_t blend{static_cast<uint8_t>(keys[i - 1].first >> 32)};
+        if (i < keys.size() && static_cast<uint8_t>(keys[i].first >> 32) == blend) continue;
+        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines[blend]);
+        vkCmdDraw(command_buffer, 4, i - first, 0, first);
+        batch_count++;
+        first = i;
+    }
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+/*
+    - `std::pair` [[.](https://en.cppreference.com/w/cpp/utility/pair.html)]
+*/
+#include <utility>
+/*
+    - `std::vector` [[.](https://en.cppreference.com/w/cpp/container/vector.html)]
+*/
+#include <vector>
+
+#include "bindless.hpp"
+#include "common.hpp"
+#include "deletion_queue.hpp"
+#include "frame_ring.hpp"
+
+/*
+    Screen-space quads, such as text and the panels of a dashboard, drawn with one instanced draw per run of sprites that share a pipeline. Each sprite is one instance, written straight into a persistently mapped ring with a region per frame in flight, and the four corners come from the vertex index, so nothing else is uploaded per sprite.
+
+    Sprites are sorted by layer, then by pipeline and texture, and otherwise keep the order in which they were added. Textures are bindless handles in the instance data, so only a change of pipeline starts a new draw; sprites that must overlap in order go in different layers.
+*/
+class Sprite_Batch
+{
+    public:
+    enum class Blend : uint8_t
+    {
+        ALPHA,
+        ADDITIVE,
+    };
+
+    static constexpr uint32_t BLEND_COUNT{2};
+
+    struct Sprite
+    {
+        /* `x`, `y`, `width` and `height` in pixels, from the top left of the target */
+        float rect[4];
+        /* `u0`, `v0`, `u1` and `v1` of the texture, as in an `Atlas::Region` */
+        float uv[4]{0.0f, 0.0f, 1.0f, 1.0f};
+        /* RGBA8, with red in the lowest byte; it multiplies the texture. */
+        uint32_t color{0xFFFFFFFF};
+        /* Bindless handles; a sprite without a texture is its color. */
+        uint32_t texture{Bindless::INVALID};
+        uint32_t sampler{0};
+        uint16_t layer{0};
+        Blend blend{Blend::ALPHA};
+    };
+
+    void create(VkPhysicalDevice, VkDevice, Deletion_Queue *, VkDescriptorSetLayout bindless_layout, uint32_t capacity, uint32_t frame_count);
+    void destroy();
+    /* As `create_pipelines` returns them, these go through no deletion queue, since no frame has used them yet, so dropping them destroys them at once. */
+    struct Pipelines
+    {
+        Unique_Pipeline blends[BLEND_COUNT];
+    };
+
+    /* The render pass needs one color attachment and no depth. This changes nothing, so it may run on any thread while the batch is in use. */
+    Pipelines create_pipelines(VkShaderModule vert, VkShaderModule frag, VkRenderPass, VkPipelineCache) const;
+    /* Pipelines that frames in flight may use are retired, so this can be called at any time, on the thread that owns the deletion queue. */
+    void set_pipelines(Pipelines &&);
+    /* This is called once the frame's fence has been waited on, before any sprite is added. */
+    void begin_frame(uint32_t frame);
+    /* Sprites past the capacity are dropped and counted. */
+    void add(const Sprite &);
+    /* This records inside a render pass over a target of `extent`. */
+    void record(VkCommandBuffer, VkDescriptorSet bindless_set, VkExtent2D extent);
+    size_t size() const { return instances.size(); }
+    uint32_t batches() const { return batch_count; }
+    uint64_t dropped() const { return dropped_count; }
+
+    private:
+    /* This matches the vertex input of `sprite.vert`. */
+    struct Instance
+    {
+        float rect[4];
+        float uv[4];
+        uint32_t color;
+        uint32_t texture;
+        uint32_t sampler;
+        uint32_t padding;
+    };
+
+    VkDevice device{VK_NULL_HANDLE};
+    Deletion_Queue *p_deletion_queue{nullptr};
+    uint32_t capacity{0};
+    Frame_Ring ring;
+    Unique_Pipeline_Layout pipeline_layout;
+    Unique_Pipeline pipelines[BLEND_COUNT];
+    /* These keep their capacity from frame to frame. Keys are the layer, the blend and the texture, from the top bits down, with the index of the sprite to keep the order of the rest. */
+    std::vector<Instance> instances;
+    std::vector<std::pair<uint64_t, uint32_t>> keys;
+    uint32_t batch_count{0};
+    uint64_t dropped_count{0};
+};
@@ -0,0 +1,104 @@
+#include "task_graph.hpp"
+
+/*
+    - `std::exception_ptr` [[.](https://en.cppreference.com/w/cpp/error/exception_ptr.html)]
+*/
+#include <exception>
+/*
+    - `std::runtime_error` [[.](https://en.cppreference.com/w/cpp/error/runtime_error.html)]
+*/
+#include <stdexcept>
+
+Task_Graph::Task Task_Graph::add(std::function<void()> step, const std::vector<Task> &dependencies, bool main_thread)
+{
+    Task task{static_cast<Task>(nodes.size())};
+
+    for (Task dependency : dependencies)
+    {
+        if (dependency >= task) throw std::runtime_error("A task depends on one that was added after it.\n");
+        nodes[dependency].dependents.push_back(task);
+    }
+
+    nodes.push_back({std::move(step), {}, static_cast<uint32_t>(dependencies.size()), main_thread});
+    return task;
+}
+
+void Task_Graph::run(Thread_Pool &thread_pool)
+{
+    std::mutex mutex;
+    std::condition_variable condition;
+    /* Steps that are ready for this thread */
+    std::vector<Task> main_ready;
+    /* Steps that are ready or running, wherever they are */
+    uint32_t pending{0};
+    std::exception_ptr p_exception;
+    std::vector<std::future<void>> futures;
+    std::function<void(Task)> execute;
+
+    /* This is called with `mutex` held. */
+    auto ready{[&](Task task) {
+        pending++;
+
+        if (nodes[task].main_thread)
+        {
+            main_ready.push_back(task);
+            condition.notify_all();
+        }
+        else
+        {
+            futures.push_back(thread_pool.submit([&execute, task]() { execute(task); }));
+        }
+    }};
+
+    execute = [&](Task task) {
+        std::exception_ptr p_step_exception;
+
+        try
+        {
+            nodes[task].step();
+        }
+        catch (...)
+        {
+            p_step_exception = std::current_exception();
+        }
+
+        std::lock_guard lock{mutex};
+        if (p_step_exception && !p_exception) p_exception = p_step_exception;
+
+        /* Once a step has failed, nothing new starts, so `pending` runs down to zero. */
+        if (!p_exception)
+        {
+            for (Task dependent : nodes[task].dependents)
+            {
+                if (--nodes[dependent].remaining == 0) ready(dependent);
+            }
+        }
+
+        pending--;
+        condition.notify_all();
+    };
+
+    {
+        std::lock_guard lock{mutex};
+
+        for (Task task{0}; task < nodes.size(); task++)
+        {
+            if (nodes[task].remaining == 0) ready(task);
+        }
+    }
+
+    while (true)
+    {
+        std::unique_lock lock{mutex};
+        condition.wait(lock, [&]() { return !main_ready.empty() || pending == 0; });
+        if (main_ready.empty()) break;
+        Task task{main_ready.back()};
+        main_ready.pop_back();
+        lock.unlock();
+        execute(task);
+    }
+
+    /* The last jobs may still be returning, and they refer to the locals above. Nothing is submitted anymore, so `futures` no longer changes. */
+    for (auto &future : futures) future.wait();
+    if (p_exception) std::rethrow_exception(p_exception);
+}
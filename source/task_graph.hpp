@@ -0,0 +1,37 @@
+#pragma once
+
+/*
+    - `std::function` [[.](https://en.cppreference.com/w/cpp/utility/functional/function.html)]
+*/
+#include <functional>
+/*
+    - `std::vector` [[.](https://en.cppreference.com/w/cpp/container/vector.html)]
+*/
+#include <vector>
+
+#include "thread_pool.hpp"
+
+/*
+    Steps that depend on each other, each started as soon as its dependencies are done: on the pool, or on the thread that calls `run` for steps that must stay there, such as SDL's window calls. Dependencies are added before their dependents, so the graph cannot have cycles.
+
+    If a step throws, no more steps are started, and `run` rethrows the first exception once the running ones have finished.
+*/
+class Task_Graph
+{
+    public:
+    using Task = uint32_t;
+
+    Task add(std::function<void()> step, const std::vector<Task> &dependencies = {}, bool main_thread = false);
+    void run(Thread_Pool &);
+
+    private:
+    struct Node
+    {
+        std::function<void()> step;
+        std::vector<Task> dependents;
+        uint32_t remaining;
+        bool main_thread;
+    };
+
+    std::vector<Node> nodes;
+};
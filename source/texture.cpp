@@ -0,0 +1,492 @@
+#include "texture.hpp"
+
+/*
+    - `std::sort` [[.](https://en.cppreference.com/w/cpp/algorithm/sort.html)]
+*/
+#include <algorithm>
+/*
+    - `std::log2` [[.](https://en.cppreference.com/w/cpp/numeric/math/log2.html)]
+*/
+#include <cmath>
+/*
+    - `fprintf` [[.](https://en.cppreference.com/w/cpp/io/c/fprintf.html)]
+*/
+#include <cstdio>
+/*
+    - `std::hash` [[.](https://en.cppreference.com/w/cpp/utility/hash.html)]
+*/
+#include <functional>
+
+#include "arena.hpp"
+
+void Sampler_Cache::create(VkDevice device, Bindless *p_bindless)
+{
+    this->device = device;
+    this->p_bindless = p_bindless;
+}
+
+void Sampler_Cache::destroy()
+{
+    for (const auto &[key, entry] : samplers) vkDestroySampler(device, entry.sampler, nullptr);
+    samplers.clear();
+}
+
+uint32_t Sampler_Cache::get(const Key &key)
+{
+    if (auto it{samplers.find(key)}; it != samplers.end()) return it->second.handle;
+
+    VkSamplerCreateInfo create_info{
+        .sType{VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO},
+        // .pNext{},
+        // .flags{},
+        .magFilter{key.filter},
+        .minFilter{key.filter},
+        .mipmapMode{key.mipmap_mode},
+        .addressModeU{key.address_mode},
+        .addressModeV{key.address_mode},
+        .addressModeW{key.address_mode},
+        .mipLodBias{0.0f},
+        .anisotropyEnable{VK_FALSE},
+        .maxAnisotropy{1.0f},
+        .compareEnable{VK_FALSE},
+        .compareOp{VK_COMPARE_OP_ALWAYS},
+        .minLod{0.0f},
+        /* This leaves the level range up to the image view, which is what changes as textures stream. */
+        .maxLod{1000.0f},
+        .borderColor{VK_BORDER_COLOR_FLOAT_OPAQUE_BLACK},
+        .unnormalizedCoordinates{VK_FALSE},
+    };
+
+    Entry entry;
+    CHECK(vkCreateSampler(device, &create_info, nullptr, &entry.sampler));
+    entry.handle = p_bindless->add_sampler(device, entry.sampler);
+    samplers.emplace(key, entry);
+    return entry.handle;
+}
+
+size_t Sampler_Cache::Hash::operator()(const Key &key) const
+{
+    return std::hash<uint32_t>{}(key.filter | key.mipmap_mode << 8 | key.address_mode << 16);
+}
+
+VkImageView View_Cache::get(VkDevice device, const Key &key)
+{
+    if (auto it{views.find(key)}; it != views.end()) return it->second;
+
+    VkImageViewCreateInfo create_info{
+        .sType{VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO},
+        // .pNext{},
+        // .flags{},
+        .image{key.image},
+        .viewType{VK_IMAGE_VIEW_TYPE_2D},
+        .format{key.format},
+        .components{
+            .r{VK_COMPONENT_SWIZZLE_IDENTITY},
+            .g{VK_COMPONENT_SWIZZLE_IDENTITY},
+            .b{VK_COMPONENT_SWIZZLE_IDENTITY},
+            .a{VK_COMPONENT_SWIZZLE_IDENTITY},
+        },
+        .subresourceRange{
+            .aspectMask{VK_IMAGE_ASPECT_COLOR_BIT},
+            .baseMipLevel{key.base_mip},
+            .levelCount{key.mip_count},
+            .baseArrayLayer{0},
+            .layerCount{1},
+        },
+    };
+
+    VkImageView view;
+    CHECK(vkCreateImageView(device, &create_info, nullptr, &view));
+    views.emplace(key, view);
+    return view;
+}
+
+void View_Cache::release(VkImage image, std::vector<VkImageView> &released)
+{
+    for (auto it{views.begin()}; it != views.end();)
+    {
+        if (it->first.image == image)
+        {
+            released.push_back(it->second);
+            it = views.erase(it);
+        }
+        else
+        {
+            it++;
+        }
+    }
+}
+
+void View_Cache::destroy(VkDevice device)
+{
+    for (const auto &[key, view] : views) vkDestroyImageView(device, view, nullptr);
+    views.clear();
+}
+
+size_t View_Cache::Hash::operator()(const Key &key) const
+{
+    return std::hash<VkImage>{}(key.image) ^ std::hash<uint64_t>{}(uint64_t{key.base_mip} << 32 | key.mip_count) ^ std::hash<uint32_t>{}(key.format);
+}
+
+void Texture_Streamer::create(VkPhysicalDevice physical_device, VkDevice device, Bindless *p_bindless, Thread_Pool *p_thread_pool, Deletion_Queue *p_deletion_queue, VkDeviceSize budget, uint32_t frame_count)
+{
+    this->physical_device = physical_device;
+    this->device = device;
+    this->p_bindless = p_bindless;
+    this->p_thread_pool = p_thread_pool;
+    this->p_deletion_queue = p_deletion_queue;
+    this->budget = budget;
+    staging.create(physical_device, device, STAGING_SIZE, frame_count, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 0);
+}
+
+void Texture_Streamer::destroy()
+{
+    views.destroy(device);
+
+    for (auto &texture : textures)
+    {
+        if (texture.image == VK_NULL_HANDLE) continue;
+        vkDestroyImage(device, texture.image, nullptr);
+        vkFreeMemory(device, texture.memory, nullptr);
+    }
+
+    textures.clear();
+    staging.destroy(device);
+}
+
+uint32_t Texture_Streamer::load(const std::string &path)
+{
+    uint32_t texture{static_cast<uint32_t>(textures.size())};
+    textures.push_back({.path{path}});
+    /* The first read parses the header and reads the whole mip tail. */
+    read(texture, NONE);
+    return texture;
+}
+
+void Texture_Streamer::request(uint32_t texture, float screen_pixels)
+{
+    Texture &t{textures[texture]};
+    t.last_requested = frame_number;
+    t.screen_pixels = screen_pixels;
+    if (!t.source) return;
+    float size{static_cast<float>(std::max(t.source->extent.width, t.source->extent.height))};
+    /* The level whose size is closest to, but not below, the covered area */
+    float mip{std::floor(std::log2(size / std::max(screen_pixels, 1.0f)))};
+    t.wanted_mip = std::min(static_cast<uint32_t>(std::max(mip, 0.0f)), t.tail_mip);
+}
+
+void Texture_Streamer::read(uint32_t texture, uint32_t level)
+{
+    std::string path{textures[texture].path};
+    std::optional<Ktx2> source{textures[texture].source};
+    if (level != NONE) textures[texture].reading_mip = level;
+
+    /* The worker only touches its own copies; the texture itself belongs to the main thread. */
+    p_thread_pool->submit([this, texture, level, path, source]() {
+        Result result{.texture{texture}};
+
+        try
+        {
+            std::ifstream file(path, std::ios::binary);
+            if (!file.is_open()) throw std::runtime_error("`" + path + "` could not be opened.\n");
+
+            if (level == NONE)
+            {
+                result.source = Ktx2::read_header(file, path);
+                uint32_t level_count{static_cast<uint32_t>(result.source->levels.size())};
+                result.first_level = level_count - 1;
+
+                while (result.first_level > 0)
+                {
+                    VkExtent2D extent{result.source->level_extent(result.first_level - 1)};
+                    if (extent.width > MIP_TAIL_SIZE || extent.height > MIP_TAIL_SIZE) break;
+                    result.first_level--;
+                }
+
+                for (uint32_t i{result.first_level}; i < level_count; i++) result.data.push_back(result.source->read_level(file, i));
+            }
+            else
+            {
+                result.first_level = level;
+                result.data.push_back(source->read_level(file, level));
+            }
+        }
+        catch (const std::exception &exception)
+        {
+            result.error = exception.what();
+        }
+
+        std::lock_guard lock{results_mutex};
+        results.push_back(std::move(result));
+    });
+}
+
+void Texture_Streamer::receive()
+{
+    std::vector<Result> received;
+
+    {
+        std::lock_guard lock{results_mutex};
+        received.swap(results);
+    }
+
+    for (auto &result : received)
+    {
+        Texture &t{textures[result.texture]};
+
+        if (!result.error.empty())
+        {
+            fprintf(stderr, "%s", result.error.c_str());
+            t.failed = true;
+            continue;
+        }
+
+        if (result.source)
+        {
+            VkFormatProperties format_properties;
+            vkGetPhysicalDeviceFormatProperties(physical_device, result.source->format, &format_properties);
+
+            if (!(format_properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT))
+            {
+                fprintf(stderr, "`%s` uses %s, which this device cannot sample.\n", t.path.c_str(), string_VkFormat(result.source->format));
+                t.failed = true;
+                continue;
+            }
+
+            t.source = std::move(result.source);
+            t.level_data.resize(t.source->levels.size());
+            t.tail_mip = result.first_level;
+            t.wanted_mip = t.tail_mip;
+        }
+        else
+        {
+            t.reading_mip = NONE;
+        }
+
+        for (size_t i{0}; i < result.data.size(); i++) t.level_data[result.first_level + i] = std::move(result.data[i]);
+    }
+}
+
+void Texture_Streamer::update(VkCommandBuffer command_buffer, uint32_t frame)
+{
+    frame_number++;
+    staging.begin_frame(frame);
+    receive();
+    evict(command_buffer);
+    promote(command_buffer);
+}
+
+void Texture_Streamer::evict(VkCommandBuffer command_buffer)
+{
+    if (resident <= budget) return;
+    std::pmr::vector<Texture *> candidates{Frame_Arena::resource()};
+
+    for (auto &t : textures)
+    {
+        if (t.resident_mip < t.tail_mip) candidates.push_back(&t);
+    }
+
+    /* Least recently requested first, then smallest on screen first */
+    std::sort(candidates.begin(), candidates.end(), [](const Texture *a, const Texture *b) {
+        if (a->last_requested != b->last_requested) return a->last_requested < b->last_requested;
+        return a->screen_pixels < b->screen_pixels;
+    });
+
+    /* Promotion never goes over the budget, so a demoted texture is not promoted again until something else leaves room. */
+    for (Texture *p_texture : candidates)
+    {
+        if (resident <= budget) break;
+        change_residency(command_buffer, *p_texture, p_texture->resident_mip + 1);
+    }
+}
+
+void Texture_Streamer::promote(VkCommandBuffer command_buffer)
+{
+    std::pmr::vector<Texture *> candidates{Frame_Arena::resource()};
+
+    for (auto &t : textures)
+    {
+        if (t.failed || !t.source) continue;
+        if (frame_number - t.last_requested > STALE_FRAMES) t.wanted_mip = std::max(t.wanted_mip, std::min(t.resident_mip, t.tail_mip));
+        if (t.resident_mip == NONE || t.wanted_mip < t.resident_mip) candidates.push_back(&t);
+    }
+
+    /* Most recently requested first */
+    std::sort(candidates.begin(), candidates.end(), [](const Texture *a, const Texture *b) { return a->last_requested > b->last_requested; });
+
+    for (Texture *p_texture : candidates)
+    {
+        Texture &t{*p_texture};
+        /* The tail arrives all at once; after that, one level at a time */
+        uint32_t mip{t.resident_mip == NONE ? t.tail_mip : t.resident_mip - 1};
+        uint32_t upload_end{t.resident_mip == NONE ? static_cast<uint32_t>(t.source->levels.size()) : t.resident_mip};
+        VkDeviceSize upload_size{0};
+        bool loaded{true};
+
+        for (uint32_t level{mip}; level < upload_end; level++)
+        {
+            loaded = loaded && !t.level_data[level].empty();
+            upload_size += t.source->levels[level].size;
+        }
+
+        if (!loaded)
+        {
+            if (t.reading_mip == NONE) read(static_cast<uint32_t>(p_texture - textures.data()), mip);
+            continue;
+        }
+
+        /* The tail is always allowed in, so that every texture has something to show. */
+        if (t.resident_mip != NONE && resident + upload_size > budget) continue;
+        if (!staging.fits(upload_size, upload_end - mip, t.source->block_size)) continue;
+        change_residency(command_buffer, t, mip);
+    }
+}
+
+void Texture_Streamer::change_residency(VkCommandBuffer command_buffer, Texture &t, uint32_t mip)
+{
+    const Ktx2 &source{*t.source};
+    uint32_t level_count{static_cast<uint32_t>(source.levels.size())};
+    uint32_t mip_count{level_count - mip};
+    VkExtent2D extent{source.level_extent(mip)};
+
+    VkImageCreateInfo create_info{
+        .sType{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO},
+        // .pNext{},
+        // .flags{},
+        .imageType{VK_IMAGE_TYPE_2D},
+        .format{source.format},
+        .extent{extent.width, extent.height, 1},
+        .mipLevels{mip_count},
+        .arrayLayers{1},
+        .samples{VK_SAMPLE_COUNT_1_BIT},
+        .tiling{VK_IMAGE_TILING_OPTIMAL},
+        .usage{VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT},
+        .sharingMode{VK_SHARING_MODE_EXCLUSIVE},
+        // .queueFamilyIndexCount{},
+        // .pQueueFamilyIndices{},
+        .initialLayout{VK_IMAGE_LAYOUT_UNDEFINED},
+    };
+
+    VkImage image;
+    CHECK(vkCreateImage(device, &create_info, nullptr, &image));
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(device, image, &requirements);
+
+    VkMemoryAllocateInfo allocate_info{
+        .sType{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO},
+        // .pNext{},
+        .allocationSize{requirements.size},
+        .memoryTypeIndex{find_memory_type(physical_device, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)},
+    };
+
+    VkDeviceMemory memory;
+    CHECK(vkAllocateMemory(device, &allocate_info, nullptr, &memory));
+    CHECK(vkBindImageMemory(device, image, memory, 0));
+
+    VkImageMemoryBarrier barriers[]{
+        {
+            .sType{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER},
+            // .pNext{},
+            .srcAccessMask{0},
+            .dstAccessMask{VK_ACCESS_TRANSFER_WRITE_BIT},
+            .oldLayout{VK_IMAGE_LAYOUT_UNDEFINED},
+            .newLayout{VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL},
+            .srcQueueFamilyIndex{VK_QUEUE_FAMILY_IGNORED},
+            .dstQueueFamilyIndex{VK_QUEUE_FAMILY_IGNORED},
+            .image{image},
+            .subresourceRange{VK_IMAGE_ASPECT_COLOR_BIT, 0, mip_count, 0, 1},
+        },
+        {
+            .sType{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER},
+            // .pNext{},
+            /* Earlier frames only read the old image, so this is just an execution dependency. */
+            .srcAccessMask{0},
+            .dstAccessMask{VK_ACCESS_TRANSFER_READ_BIT},
+            .oldLayout{VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+            .newLayout{VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL},
+            .srcQueueFamilyIndex{VK_QUEUE_FAMILY_IGNORED},
+            .dstQueueFamilyIndex{VK_QUEUE_FAMILY_IGNORED},
+            .image{t.image},
+            .subresourceRange{VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_REMAINING_MIP_LEVELS, 0, 1},
+        },
+    };
+
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, t.image == VK_NULL_HANDLE ? 1 : 2, barriers);
+
+    for (uint32_t level{mip}; level < level_count; level++)
+    {
+        VkExtent2D level_extent{source.level_extent(level)};
+
+        if (t.image != VK_NULL_HANDLE && level >= t.resident_mip)
+        {
+            /* This level is already on the GPU. */
+            VkImageCopy copy{
+                .srcSubresource{VK_IMAGE_ASPECT_COLOR_BIT, level - t.resident_mip, 0, 1},
+                .srcOffset{0, 0, 0},
+                .dstSubresource{VK_IMAGE_ASPECT_COLOR_BIT, level - mip, 0, 1},
+                .dstOffset{0, 0, 0},
+                .extent{level_extent.width, level_extent.height, 1},
+            };
+
+            vkCmdCopyImage(command_buffer, t.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy);
+            continue;
+        }
+
+        std::vector<char> &data{t.level_data[level]};
+        /* `bufferOffset` must be a multiple of the texel block size. */
+        Frame_Ring::Allocation allocation{staging.allocate(data.size(), source.block_size)};
+        std::memcpy(allocation.p_data, data.data(), data.size());
+        /* The data is read from disk again if this level is ever evicted and wanted back. */
+        data = {};
+
+        VkBufferImageCopy copy{
+            .bufferOffset{allocation.offset},
+            /* Tightly packed */
+            .bufferRowLength{0},
+            .bufferImageHeight{0},
+            .imageSubresource{VK_IMAGE_ASPECT_COLOR_BIT, level - mip, 0, 1},
+            .imageOffset{0, 0, 0},
+            .imageExtent{level_extent.width, level_extent.height, 1},
+        };
+
+        vkCmdCopyBufferToImage(command_buffer, staging.buffer(), image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy);
+    }
+
+    VkImageMemoryBarrier barrier{
+        .sType{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER},
+        // .pNext{},
+        .srcAccessMask{VK_ACCESS_TRANSFER_WRITE_BIT},
+        .dstAccessMask{VK_ACCESS_SHADER_READ_BIT},
+        .oldLayout{VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL},
+        .newLayout{VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+        .srcQueueFamilyIndex{VK_QUEUE_FAMILY_IGNORED},
+        .dstQueueFamilyIndex{VK_QUEUE_FAMILY_IGNORED},
+        .image{image},
+        .subresourceRange{VK_IMAGE_ASPECT_COLOR_BIT, 0, mip_count, 0, 1},
+    };
+
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    VkImageView view{views.get(device, {image, source.format, 0, mip_count})};
+    uint32_t handle{p_bindless->add_image(device, view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)};
+
+    if (t.image != VK_NULL_HANDLE)
+    {
+        std::vector<VkImageView> old_views;
+        views.release(t.image, old_views);
+
+        p_deletion_queue->push([device = device, image = t.image, memory = t.memory, old_views = std::move(old_views)] {
+            for (const auto &view : old_views) vkDestroyImageView(device, view, nullptr);
+            vkDestroyImage(device, image, nullptr);
+            vkFreeMemory(device, memory, nullptr);
+        });
+
+        p_bindless->remove_image(t.handle);
+    }
+
+    resident = resident + requirements.size - t.bytes;
+    t.image = image;
+    t.memory = memory;
+    t.bytes = requirements.size;
+    t.handle = handle;
+    t.resident_mip = mip;
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+/*
+    - `std::mutex` [[.](https://en.cppreference.com/w/cpp/thread/mutex.html)]
+*/
+#include <mutex>
+/*
+    - `std::optional` [[.](https://en.cppreference.com/w/cpp/utility/optional.html)]
+*/
+#include <optional>
+/*
+    - `std::string` [[.](https://en.cppreference.com/w/cpp/string/basic_string.html)]
+*/
+#include <string>
+/*
+    - `std::unordered_map` [[.](https://en.cppreference.com/w/cpp/container/unordered_map.html)]
+*/
+#include <unordered_map>
+/*
+    - `std::vector` [[.](https://en.cppreference.com/w/cpp/container/vector.html)]
+*/
+#include <vector>
+
+#include "bindless.hpp"
+#include "deletion_queue.hpp"
+#include "frame_ring.hpp"
+#include "ktx2.hpp"
+#include "thread_pool.hpp"
+
+/* Samplers are deduplicated by their state and registered in the bindless set once, so the same state always yields the same handle. */
+class Sampler_Cache
+{
+    public:
+    struct Key
+    {
+        VkFilter filter;
+        VkSamplerMipmapMode mipmap_mode;
+        VkSamplerAddressMode address_mode;
+        bool operator==(const Key &) const = default;
+    };
+
+    void create(VkDevice, Bindless *);
+    void destroy();
+    /* This returns a bindless sampler handle. */
+    uint32_t get(const Key &);
+
+    private:
+    struct Hash
+    {
+        size_t operator()(const Key &) const;
+    };
+
+    struct Entry
+    {
+        VkSampler sampler;
+        uint32_t handle;
+    };
+
+    VkDevice device{VK_NULL_HANDLE};
+    Bindless *p_bindless{nullptr};
+    std::unordered_map<Key, Entry, Hash> samplers;
+};
+
+/* Image views are deduplicated by the image and subresource range they cover. */
+class View_Cache
+{
+    public:
+    struct Key
+    {
+        VkImage image;
+        VkFormat format;
+        uint32_t base_mip;
+        uint32_t mip_count;
+        bool operator==(const Key &) const = default;
+    };
+
+    VkImageView get(VkDevice, const Key &);
+    /* This removes every view of the image from the cache and appends them to `views`, for the caller to destroy along with the image. */
+    void release(VkImage, std::vector<VkImageView> &views);
+    void destroy(VkDevice);
+
+    private:
+    struct Hash
+    {
+        size_t operator()(const Key &) const;
+    };
+
+    std::unordered_map<Key, VkImageView, Hash> views;
+};
+
+/*
+    Textures are read and parsed on worker threads, and only their smallest levels (the mip tail) are uploaded at first. Each frame, textures that are drawn report how many pixels they cover on screen, and the streamer promotes them one level at a time, from smallest to largest, while the resident total stays within the budget. When the budget is exceeded, the least recently drawn textures lose their largest level first.
+
+    Images are not sparse, so a residency change creates a new image with the new level range, copies the levels the two have in common on the GPU, and uploads the rest from staging. The old image goes through the `Deletion_Queue`, since frames in flight may still sample it. The bindless handle changes with the image, so `handle` must be read each frame.
+*/
+class Texture_Streamer
+{
+    public:
+    void create(VkPhysicalDevice, VkDevice, Bindless *, Thread_Pool *, Deletion_Queue *, VkDeviceSize budget, uint32_t frame_count);
+    void destroy();
+    uint32_t load(const std::string &);
+    /* `screen_pixels` is the larger dimension of the area the texture covers on screen. */
+    void request(uint32_t texture, float screen_pixels);
+    /* This must be recorded outside of a render pass, before any draw that uses these textures. */
+    void update(VkCommandBuffer, uint32_t frame);
+    /* This returns a bindless image handle, or `Bindless::INVALID` before anything is resident. */
+    uint32_t handle(uint32_t texture) const { return textures[texture].handle; }
+    VkDeviceSize resident_bytes() const { return resident; }
+
+    private:
+    static constexpr uint32_t NONE{~0u};
+    /* Levels no larger than this in either dimension are read and uploaded together with the header. */
+    static constexpr uint32_t MIP_TAIL_SIZE{128};
+    static constexpr VkDeviceSize STAGING_SIZE{32 * 1024 * 1024};
+    /* Textures that have not been requested for this many frames stop asking for more levels. */
+    static constexpr uint64_t STALE_FRAMES{120};
+
+    struct Texture
+    {
+        std::string path;
+        std::optional<Ktx2> source;
+        bool failed{false};
+        uint32_t tail_mip{NONE};
+        uint32_t resident_mip{NONE};
+        uint32_t wanted_mip{NONE};
+        uint32_t reading_mip{NONE};
+        /* This is indexed by level; a level's data is released once it has been uploaded. */
+        std::vector<std::vector<char>> level_data;
+        VkImage image{VK_NULL_HANDLE};
+        VkDeviceMemory memory{VK_NULL_HANDLE};
+        VkDeviceSize bytes{0};
+        uint32_t handle{Bindless::INVALID};
+        uint64_t last_requested{0};
+        float screen_pixels{0.0f};
+    };
+
+    /* This is what a worker thread hands back to the main thread. */
+    struct Result
+    {
+        uint32_t texture;
+        std::optional<Ktx2> source;
+        uint32_t first_level;
+        std::vector<std::vector<char>> data;
+        std::string error;
+    };
+
+    void read(uint32_t texture, uint32_t level);
+    void receive();
+    void evict(VkCommandBuffer);
+    void promote(VkCommandBuffer);
+    void change_residency(VkCommandBuffer, Texture &, uint32_t mip);
+
+    VkPhysicalDevice physical_device{VK_NULL_HANDLE};
+    VkDevice device{VK_NULL_HANDLE};
+    Bindless *p_bindless{nullptr};
+    Thread_Pool *p_thread_pool{nullptr};
+    Deletion_Queue *p_deletion_queue{nullptr};
+    VkDeviceSize budget{0};
+    VkDeviceSize resident{0};
+    Frame_Ring staging;
+    View_Cache views;
+    std::vector<Texture> textures;
+    uint64_t frame_number{0};
+    std::mutex results_mutex;
+    std::vector<Result> results;
+};
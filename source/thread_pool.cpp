@@ -0,0 +1,65 @@
+#include "thread_pool.hpp"
+
+/*
+    - `std::max` [[.](https://en.cppreference.com/w/cpp/algorithm/max.html)]
+*/
+#include <algorithm>
+
+#include "profiler.hpp"
+
+void Thread_Pool::start(uint32_t count)
+{
+    if (count == 0) count = std::max(2u, std::thread::hardware_concurrency()) - 1;
+    workers.reserve(count);
+
+    for (uint32_t i{0}; i < count; i++)
+    {
+        workers.emplace_back([this, i](std::stop_token stop_token) {
+            Profiler::name_thread("worker " + std::to_string(i));
+            work(stop_token);
+        });
+    }
+}
+
+void Thread_Pool::stop()
+{
+    for (auto &worker : workers) worker.request_stop();
+    condition.notify_all();
+    /* `std::jthread` joins when it is destroyed. */
+    workers.clear();
+}
+
+bool Thread_Pool::run_pending()
+{
+    std::function<void()> job;
+
+    {
+        std::lock_guard lock{mutex};
+        if (jobs.empty()) return false;
+        job = std::move(jobs.front());
+        jobs.pop();
+    }
+
+    PROFILE_ZONE("job");
+    job();
+    return true;
+}
+
+void Thread_Pool::work(std::stop_token stop_token)
+{
+    while (true)
+    {
+        std::function<void()> job;
+
+        {
+            std::unique_lock lock{mutex};
+            /* This wakes on a new job or on a stop request. Jobs still queued at a stop request are abandoned, which breaks their futures. */
+            if (!condition.wait(lock, stop_token, [this]() { return !jobs.empty(); })) return;
+            job = std::move(jobs.front());
+            jobs.pop();
+        }
+
+        PROFILE_ZONE("job");
+        job();
+    }
+}
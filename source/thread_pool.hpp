@@ -0,0 +1,91 @@
+#pragma once
+
+/*
+    - `std::chrono::microseconds` [[.](https://en.cppreference.com/w/cpp/chrono/duration.html)]
+*/
+#include <chrono>
+/*
+    - `std::condition_variable` [[.](https://en.cppreference.com/w/cpp/thread/condition_variable.html)]
+*/
+#include <condition_variable>
+/*
+    - `std::function` [[.](https://en.cppreference.com/w/cpp/utility/functional/function.html)]
+*/
+#include <functional>
+/*
+    - `std::future` [[.](https://en.cppreference.com/w/cpp/thread/future.html)]
+    - `std::packaged_task` [[.](https://en.cppreference.com/w/cpp/thread/packaged_task.html)]
+*/
+#include <future>
+/*
+    - `std::shared_ptr` [[.](https://en.cppreference.com/w/cpp/memory/shared_ptr.html)]
+*/
+#include <memory>
+/*
+    - `std::mutex` [[.](https://en.cppreference.com/w/cpp/thread/mutex.html)]
+*/
+#include <mutex>
+/*
+    - `std::queue` [[.](https://en.cppreference.com/w/cpp/container/queue.html)]
+*/
+#include <queue>
+/*
+    - `std::jthread` [[.](https://en.cppreference.com/w/cpp/thread/jthread.html)]
+*/
+#include <thread>
+/*
+    - `std::invoke_result_t` [[.](https://en.cppreference.com/w/cpp/types/result_of.html)]
+*/
+#include <type_traits>
+/*
+    - `std::vector` [[.](https://en.cppreference.com/w/cpp/container/vector.html)]
+*/
+#include <vector>
+
+/* A fixed set of worker threads that run submitted jobs in submission order. Exceptions thrown by a job are stored in its future. */
+class Thread_Pool
+{
+    public:
+    /* A count of zero uses one thread per hardware thread, minus one for the main thread. */
+    void start(uint32_t count = 0);
+    void stop();
+    uint32_t size() const { return static_cast<uint32_t>(workers.size()); }
+
+    template <typename F>
+    std::future<std::invoke_result_t<F>> submit(F &&job)
+    {
+        /* `std::function` must be copyable, so the task is shared. */
+        auto p_task{std::make_shared<std::packaged_task<std::invoke_result_t<F>()>>(std::forward<F>(job))};
+        std::future<std::invoke_result_t<F>> future{p_task->get_future()};
+
+        {
+            std::lock_guard lock{mutex};
+            jobs.emplace([p_task]() { (*p_task)(); });
+        }
+
+        condition.notify_one();
+        return future;
+    }
+
+    /* This runs queued jobs while it waits, so a job can wait on jobs that it submits without every worker waiting at once. */
+    template <typename T>
+    void wait(const std::future<T> &future)
+    {
+        while (future.wait_for(std::chrono::seconds{0}) != std::future_status::ready)
+        {
+            /* The job being waited on is running elsewhere, and may take a while. */
+            if (!run_pending()) future.wait_for(std::chrono::microseconds{100});
+        }
+    }
+
+    /* This runs one queued job on the calling thread, and returns `false` if there were none. */
+    bool run_pending();
+
+    private:
+    void work(std::stop_token);
+
+    std::vector<std::jthread> workers;
+    std::queue<std::function<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable_any condition;
+};